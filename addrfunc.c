@@ -439,6 +439,43 @@ af_is_supported_local_ifa(const struct ifaddrs *ifa, int ip_ver, unsigned int if
 	return (1);
 }
 
+/*
+ * Return hash of address part of sockaddr sa. Port is not included, so all packets from one host
+ * have same hash. FNV-1a hash function is used.
+ */
+uint32_t
+af_sa_hash(const struct sockaddr *sa)
+{
+	const unsigned char *addr;
+	size_t addr_len;
+	size_t i;
+	uint32_t hash;
+
+	switch (sa->sa_family) {
+	case AF_INET:
+		addr = (const unsigned char *)&((const struct sockaddr_in *)sa)->sin_addr;
+		addr_len = sizeof(struct in_addr);
+		break;
+	case AF_INET6:
+		addr = (const unsigned char *)&((const struct sockaddr_in6 *)sa)->sin6_addr;
+		addr_len = sizeof(struct in6_addr);
+		break;
+	default:
+		DEBUG_PRINTF("Internal program error");
+		errx(1, "Internal program error");
+		/* NOTREACHED */
+	}
+
+	hash = 2166136261U;
+
+	for (i = 0; i < addr_len; i++) {
+		hash ^= addr[i];
+		hash *= 16777619U;
+	}
+
+	return (hash);
+}
+
 /*
  * Return length of sockaddr structure.
  */
@@ -66,6 +66,7 @@ extern int		 af_is_sa_mcast(const struct sockaddr *addr);
 extern int		 af_is_supported_local_ifa(const struct ifaddrs *ifa, int ip_ver,
     unsigned int if_flags);
 
+extern uint32_t		 af_sa_hash(const struct sockaddr *sa);
 extern socklen_t	 af_sa_len(const struct sockaddr *sa);
 extern uint16_t		 af_sa_port(const struct sockaddr *addr);
 extern void		 af_sa_set_port(struct sockaddr *addr, uint16_t port);
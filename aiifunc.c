@@ -95,6 +95,41 @@ aii_list_ai_to_sa(struct aii_list *aii_list, int ip_ver)
 	}
 }
 
+/*
+ * Convert collector_addr_s with port_s to ai_item collector_addr. Address must be of ip_ver
+ * (4 or 6) version. Function fails with error if address can't be resolved.
+ */
+void
+aii_collector_to_ai(int ip_ver, struct ai_item *collector_addr, const char *collector_addr_s,
+    const char *port_s)
+{
+	struct addrinfo *ai_res, *ai_i;
+
+	collector_addr->host_name = strdup(collector_addr_s);
+	if (collector_addr->host_name == NULL) {
+		errx(1, "Can't alloc memory");
+	}
+
+	ai_res = af_host_to_ai(collector_addr_s, port_s, ip_ver);
+
+	for (ai_i = ai_res; ai_i != NULL; ai_i = ai_i->ai_next) {
+		if (af_ai_supported_ipv(ai_i) == ip_ver) {
+			memcpy(&collector_addr->sas, ai_i->ai_addr, ai_i->ai_addrlen);
+			break;
+		}
+	}
+
+	if (ai_i == NULL) {
+		errx(1, "Can't find IPv%d address of collector %s", ip_ver, collector_addr_s);
+	}
+
+	freeaddrinfo(ai_res);
+
+	if (af_is_sa_mcast(AF_CAST_SA(&collector_addr->sas))) {
+		errx(1, "Given address %s is not valid unicast address", collector_addr_s);
+	}
+}
+
 /*
  * Tries to find local address in aii_list with given ip_ver. if_flags may be set to bit mask with
  * IFF_MULTICAST and/or IFF_BROADCAST and only network interface with that flags will be accepted.
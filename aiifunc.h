@@ -58,6 +58,9 @@ extern void		 aii_list_free(struct aii_list *aii_list);
 
 extern void		 aii_list_ai_to_sa(struct aii_list *aii_list, int ip_ver);
 
+extern void		 aii_collector_to_ai(int ip_ver, struct ai_item *collector_addr,
+    const char *collector_addr_s, const char *port_s);
+
 extern int		 aii_find_local(const struct aii_list *aii_list, int *ip_ver,
     struct ifaddrs **ifa_list, struct ifaddrs **ifa_local, struct ai_item **ai_item,
     unsigned int if_flags);
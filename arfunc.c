@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+ * FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Author: agent <agent@local>
+ */
+
+#include <sys/types.h>
+
+#include <sys/mman.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "arfunc.h"
+#include "logging.h"
+
+/*
+ * Size of chunk header rounded up to AR_ALIGN
+ */
+#define AR_CHUNK_HDR_SIZE	((sizeof(struct ar_chunk) + AR_ALIGN - 1) & ~(AR_ALIGN - 1))
+
+static struct ar_chunk	*ar_chunk_alloc(size_t size);
+
+/*
+ * Allocate new chunk with at least size usable bytes. Chunk is zeroed, so all its pages are
+ * faulted now and not later when items are used. Big chunks are aligned to AR_HUGEPAGE_SIZE and
+ * advised to be backed by huge pages.
+ * Function returns pointer to chunk or NULL on fail.
+ */
+static struct ar_chunk *
+ar_chunk_alloc(size_t size)
+{
+	struct ar_chunk *chunk;
+	size_t alloc_size;
+	size_t alignment;
+	void *mem;
+
+	alloc_size = AR_CHUNK_HDR_SIZE + size;
+	alignment = AR_ALIGN;
+
+	if (alloc_size >= AR_HUGEPAGE_SIZE) {
+		alloc_size = (alloc_size + AR_HUGEPAGE_SIZE - 1) & ~((size_t)AR_HUGEPAGE_SIZE - 1);
+		alignment = AR_HUGEPAGE_SIZE;
+	}
+
+	if (posix_memalign(&mem, alignment, alloc_size) != 0) {
+		return (NULL);
+	}
+
+#ifdef MADV_HUGEPAGE
+	if (alignment == AR_HUGEPAGE_SIZE && madvise(mem, alloc_size, MADV_HUGEPAGE) == -1) {
+		DEBUG_PRINTF("madvise MADV_HUGEPAGE failed");
+	}
+#endif
+
+	memset(mem, 0, alloc_size);
+
+	chunk = (struct ar_chunk *)mem;
+	chunk->size = alloc_size - AR_CHUNK_HDR_SIZE;
+	chunk->used = 0;
+
+	DEBUG2_PRINTF("Allocated arena chunk with size %zu", chunk->size);
+
+	return (chunk);
+}
+
+/*
+ * Allocate size bytes from arena. Returned memory is zeroed and aligned to AR_ALIGN.
+ * Function returns pointer to allocated memory or NULL on fail.
+ */
+void *
+ar_alloc(struct ar_arena *arena, size_t size)
+{
+	struct ar_chunk *chunk;
+	void *res;
+
+	size = (size + AR_ALIGN - 1) & ~((size_t)AR_ALIGN - 1);
+
+	chunk = arena->chunks;
+
+	if (chunk == NULL || chunk->size - chunk->used < size) {
+		chunk = ar_chunk_alloc(size > arena->chunk_size ? size : arena->chunk_size);
+		if (chunk == NULL) {
+			return (NULL);
+		}
+
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+	}
+
+	res = (char *)chunk + AR_CHUNK_HDR_SIZE + chunk->used;
+	chunk->used += size;
+
+	return (res);
+}
+
+/*
+ * Initialize arena. size_hint is expected number of bytes which will be allocated from arena.
+ * It's used as size of chunk (but at least AR_MIN_CHUNK_SIZE), so expected items fit to one
+ * chunk. No memory is allocated until first ar_alloc call.
+ */
+void
+ar_arena_create(struct ar_arena *arena, size_t size_hint)
+{
+
+	memset(arena, 0, sizeof(*arena));
+
+	arena->chunk_size = (size_hint > AR_MIN_CHUNK_SIZE ? size_hint : AR_MIN_CHUNK_SIZE);
+}
+
+/*
+ * Free arena and all items allocated from it.
+ */
+void
+ar_arena_free(struct ar_arena *arena)
+{
+	struct ar_chunk *chunk;
+	struct ar_chunk *chunk_next;
+
+	for (chunk = arena->chunks; chunk != NULL; chunk = chunk_next) {
+		chunk_next = chunk->next;
+		free(chunk);
+	}
+
+	arena->chunks = NULL;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+ * FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Author: agent <agent@local>
+ */
+
+#ifndef _ARFUNC_H_
+#define _ARFUNC_H_
+
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Alignment of every item allocated from arena (size of cache line)
+ */
+#define AR_ALIGN		64
+
+/*
+ * Minimal size of one chunk of arena
+ */
+#define AR_MIN_CHUNK_SIZE	(64 * 1024)
+
+/*
+ * Size of huge page. Chunks of at least this size are aligned to it and backed by huge pages
+ * (if supported by OS)
+ */
+#define AR_HUGEPAGE_SIZE	(2 * 1024 * 1024)
+
+/*
+ * Structures definition
+ */
+
+/*
+ * One chunk of arena. Chunk header is stored at beginning of allocated memory and items follow
+ * it. size is usable size of chunk (without header) and used is number of already allocated bytes.
+ */
+struct ar_chunk {
+	struct ar_chunk	*next;
+	size_t		size;
+	size_t		used;
+};
+
+/*
+ * Arena. Items are allocated sequentially from list of chunks, so items allocated together lie
+ * next to each other in memory. Items are never freed one by one, whole arena is freed at once.
+ * chunk_size is size of newly allocated chunk.
+ */
+struct ar_arena {
+	struct ar_chunk	*chunks;
+	size_t		chunk_size;
+};
+
+/*
+ * Prototypes
+ */
+extern void	*ar_alloc(struct ar_arena *arena, size_t size);
+
+extern void	 ar_arena_create(struct ar_arena *arena, size_t size_hint);
+
+extern void	 ar_arena_free(struct ar_arena *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ARFUNC_H_ */
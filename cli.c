@@ -27,8 +27,10 @@
 
 #include <err.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "addrfunc.h"
@@ -36,84 +38,164 @@
 #include "cli.h"
 #include "cliprint.h"
 #include "logging.h"
+#include "rsfunc.h"
+
+/*
+ * Function prototypes
+ */
+static int	cli_parse_profile(struct prof_item *prof, char *prof_s);
+
+static int	cli_parse_rt_opts(struct rt_opts *rt_opts, char *rt_opts_s);
+
+static int	cli_parse_stack(struct omping_stack *stack, int argc, char * const argv[],
+    int ip_ver, const char *port_s, const char *mcast_addr_s,
+    enum sf_transport_method transport_method, unsigned int ifa_flags, int dual_stack);
 
 /*
  * Parse command line.
  * argc and argv are passed from main function. instance is omping instance. Instance will be filled
- * with following items. local_ifname will be allocated and filled by name
- * of local ethernet interface. ip_ver will be filled by forced ip version or will
- * be 0. mcast_addr will be filled by requested mcast address or will be NULL. Port will be filled
- * by requested port (string value) or will be NULL. aii_list will be initialized and requested
- * hostnames will be stored there. ttl is pointer where user set TTL or default TTL will be stored.
- * single_addr is boolean set if only one remote address is entered. quiet is flag for quiet mode.
+ * with following items. stacks are filled by cli_parse_stack (one stack, or IPv4 and IPv6 stack
+ * if both -4 and -6 options are entered) and no_stacks is set to number of stacks. ttl is pointer
+ * where user set TTL or default TTL will be stored. quiet is flag for quiet mode.
  * cont_stat is flag for enable continuous statistic. timeout_time is number of miliseconds after
  * which client exits regardless to number of received/sent packets. wait_for_finish_time is number
  * of miliseconds to wait before exit to allow other nodes not to screw up final statistics.
  * dup_buf_items is number of items which should be stored in duplicate packet detection buffer.
  * Default is MIN_DUP_BUF_ITEMS for intervals > 1, or DUP_BUF_SECS value divided by ping interval
  * in seconds or 0, which is used for disabling duplicate detection. rate_limit_time is maximum
- * time between two received packets. sndbuf_size is size of socket buffer to allocate for sending
- * packets. rcvbuf_size is size of socket buffer to allocate for receiving packets. Both
- * sndbuf_size and rcvbuf_size are set to 0 if user doesn't supply option. send_count_queries is by
+ * time in ns between two received packets and rate_limit_burst is number of packets which may
+ * arrive sooner (GCRA_BURST by default). rate_limit_aggr_time is maximum time in ns between two
+ * received packets from all clients together or 0 (default) if aggregate limit is disabled.
+ * sndbuf_size is size of socket buffer to allocate for sending packets. rcvbuf_size is size of
+ * socket buffer to allocate for receiving packets. Both sndbuf_size and rcvbuf_size are set to 0
+ * if user doesn't supply option. send_count_queries is by
  * default set to 0, but may be overwritten by user and it means that after sending that number of
  * queries, client is put to stop state. auto_exit is boolean variable which is enabled by default
  * and can be disabled by -E option. If auto_exit is enabled, loop will end if every client is in
- * STOP state.
+ * STOP state. fast_start is boolean variable which enables init message retransmissions with
+ * exponential backoff. warmup_time is length of warm-up phase in ms, WARMUP_AUTO for automatic
+ * steady state detection or 0 (default) if warm-up phase is disabled. collector_addr is address of
+ * collector where stats reports are sent (host_name is NULL if reports are disabled) and
+ * export_file is name of file where collector exports matrix (or NULL). mp_flows is number of
+ * flows (source ports) queries are rotated over in multipath mode (1 by default, which disables
+ * multipath mode). tclasses is array of no_tclasses traffic classes (DSCP shifted to upper 6 bits)
+ * probed concurrently (no_tclasses is 0 by default). Every traffic class is one flow.
+ * scan_concurrency is maximum number of remote hosts with outstanding init message in scan mode
+ * (remote version display with bounded concurrency) or 0 if scan mode is disabled. rt_opts are
+ * real-time mode options (see cli_parse_rt_opts). efficient is boolean variable which enables
+ * efficiency mode (one wakeup per interval, timer slack and batched receiving of messages).
+ * stats_thread is boolean variable which enables processing of answers (statistics and printing)
+ * in separate stats thread. Transport backend is selected by rs_backend_set (socket backend is
+ * used by default) and backend_stats is boolean variable which is set if backend was selected
+ * explicitly (statistics of backend are then displayed). txtime_clock is clock used for departure
+ * times of queries in txtime mode (scheduled transmission by fq or etf qdisc) or -1 (default) if
+ * txtime mode is disabled. pacer_rate is rate of egress pacer in bytes per second or 0 (default)
+ * if egress pacing is disabled. profiles is array of no_profiles test profiles (see
+ * cli_parse_profile) running together with main regime (no_profiles is 0 by default).
  */
 int
 cli_parse(int argc, char * const argv[], struct omping_instance *instance)
 {
-	struct ai_item *ai_item;
-	struct ifaddrs *ifa_list, *ifa_local;
+	char *collector_addr_s;
 	char *ep;
 	char *mcast_addr_s;
+	char *tclass_s;
 	const char *port_s;
 	double numd;
 	int ch;
+	int dual_stack;
 	int force;
-	int no_ai;
+	int i;
+	int ip_ver;
+	int ip_ver_mask;
 	int num;
-	int res;
+	int rate_limit_burst_set;
 	int rate_limit_time_set;
+	int scan;
+	int scan_concurrency;
 	int show_ver;
 	int wait_for_finish_time_set;
 	unsigned int ifa_flags;
 
 	instance->auto_exit = 1;
+	instance->backend_stats = 0;
+	collector_addr_s = NULL;
 	instance->cont_stat = 0;
 	instance->dup_buf_items = MIN_DUP_BUF_ITEMS;
-	instance->ip_ver = 0;
-	instance->local_ifname = NULL;
+	instance->efficient = 0;
+	instance->export_file = NULL;
+	instance->fast_start = 0;
+	ip_ver_mask = 0;
 	mcast_addr_s = NULL;
+	instance->mp_flows = 1;
+	instance->no_profiles = 0;
+	instance->no_tclasses = 0;
 	instance->op_mode = OMPING_OP_MODE_NORMAL;
+	instance->pacer_rate = 0;
 	instance->quiet = 0;
 	instance->send_count_queries = 0;
 	instance->sndbuf_size = 0;
-	instance->single_addr = 0;
+	instance->rate_limit_aggr_time = 0;
+	instance->rate_limit_burst = GCRA_BURST;
 	instance->rate_limit_time = 0;
 	instance->rcvbuf_size = 0;
+	memset(&instance->rt_opts, 0, sizeof(instance->rt_opts));
+	instance->rt_opts.cpu = -1;
+	instance->scan_concurrency = 0;
+	instance->stats_thread = 0;
 	instance->timeout_time = 0;
 	instance->ttl = DEFAULT_TTL;
 	instance->transport_method = SF_TM_ASM;
+	instance->txtime_clock = -1;
 	instance->wait_time = DEFAULT_WAIT_TIME;
 	instance->wait_for_finish_time = 0;
+	instance->warmup_time = 0;
 
 	force = 0;
 	ifa_flags = IFF_MULTICAST;
 	port_s = DEFAULT_PORT_S;
+	rate_limit_burst_set = 0;
 	rate_limit_time_set = 0;
+	scan = 0;
+	scan_concurrency = 0;
 	show_ver = 0;
 	wait_for_finish_time_set = 0;
 
 	logging_set_verbose(0);
 
-	while ((ch = getopt(argc, argv, "46CDEFqVvc:i:M:m:O:p:R:r:S:T:t:w:")) != -1) {
+	while ((ch = getopt(argc, argv,
+	    "46CDEeFfkqVvA:B:b:c:g:i:J:L:M:m:n:O:o:P:p:Q:R:r:S:T:t:W:w:X:x:")) != -1) {
 		switch (ch) {
 		case '4':
-			instance->ip_ver = 4;
+			ip_ver_mask |= 1;
 			break;
 		case '6':
-			instance->ip_ver = 6;
+			ip_ver_mask |= 2;
+			break;
+		case 'A':
+			numd = strtod(optarg, &ep);
+			if (numd < 0 || *ep != '\0' || (numd > 0 && numd < 0.001)) {
+				warnx("illegal number, -A argument -- %s", optarg);
+				goto error_usage_exit;
+			}
+			instance->rate_limit_aggr_time =
+			    (numd > 0 ? (uint64_t)(1000000000.0 / numd) : 0);
+			break;
+		case 'B':
+			num = strtol(optarg, &ep, 10);
+			if (num < 0 || num > INT16_MAX || *ep != '\0') {
+				warnx("illegal number, -B argument -- %s", optarg);
+				goto error_usage_exit;
+			}
+			instance->rate_limit_burst = num;
+			rate_limit_burst_set = 1;
+			break;
+		case 'b':
+			if (rs_backend_set(optarg) == -1) {
+				warnx("illegal parameter, -b argument -- %s", optarg);
+				goto error_usage_exit;
+			}
+			instance->backend_stats = 1;
 			break;
 		case 'C':
 			instance->cont_stat++;
@@ -124,9 +206,18 @@ cli_parse(int argc, char * const argv[], struct omping_instance *instance)
 		case 'E':
 			instance->auto_exit = 0;
 			break;
+		case 'e':
+			instance->efficient = 1;
+			break;
 		case 'F':
 			force++;
 			break;
+		case 'f':
+			instance->fast_start = 1;
+			break;
+		case 'k':
+			instance->stats_thread = 1;
+			break;
 		case 'q':
 			instance->quiet++;
 			break;
@@ -144,6 +235,14 @@ cli_parse(int argc, char * const argv[], struct omping_instance *instance)
 			}
 			instance->send_count_queries= (uint64_t)numd;
 			break;
+		case 'g':
+			numd = strtod(optarg, &ep);
+			if (numd < 0.001 || *ep != '\0' || numd > 100000) {
+				warnx("illegal number, -g argument -- %s", optarg);
+				goto error_usage_exit;
+			}
+			instance->pacer_rate = (uint64_t)(numd * 1000000.0 / 8.0);
+			break;
 		case 'i':
 			numd = strtod(optarg, &ep);
 			if (numd < 0 || *ep != '\0' || numd * 1000 > INT32_MAX) {
@@ -152,6 +251,34 @@ cli_parse(int argc, char * const argv[], struct omping_instance *instance)
 			}
 			instance->wait_time = (int)(numd * 1000.0);
 			break;
+		case 'J':
+			if (instance->no_profiles >= PROF_MAX) {
+				warnx("illegal parameter, -J can be set at most %d times",
+				    PROF_MAX);
+				goto error_usage_exit;
+			}
+
+			if (cli_parse_profile(&instance->profiles[instance->no_profiles],
+			    optarg) == -1) {
+				goto error_usage_exit;
+			}
+
+			for (i = 0; i < instance->no_profiles; i++) {
+				if (strcmp(instance->profiles[i].name,
+				    instance->profiles[instance->no_profiles].name) == 0) {
+					warnx("illegal parameter, -J profile %s is set twice",
+					    instance->profiles[i].name);
+					goto error_usage_exit;
+				}
+			}
+
+			instance->no_profiles++;
+			break;
+		case 'L':
+			if (cli_parse_rt_opts(&instance->rt_opts, optarg) == -1) {
+				goto error_usage_exit;
+			}
+			break;
 		case 'M':
 			if (strcmp(optarg, "asm") == 0) {
 				instance->transport_method = SF_TM_ASM;
@@ -170,25 +297,67 @@ cli_parse(int argc, char * const argv[], struct omping_instance *instance)
 		case 'm':
 			mcast_addr_s = optarg;
 			break;
+		case 'n':
+			num = strtol(optarg, &ep, 10);
+			if (num <= 0 || num > SCAN_MAX_CONCURRENCY || *ep != '\0') {
+				warnx("illegal number, -n argument -- %s", optarg);
+				goto error_usage_exit;
+			}
+			scan_concurrency = num;
+			break;
 		case 'O':
+			scan = 0;
+
 			if (strcmp(optarg, "normal") == 0) {
 				instance->op_mode = OMPING_OP_MODE_NORMAL;
-			/*
-			 * Temporarily disabled
-			 *
 			} else if (strcmp(optarg, "server") == 0) {
-				*op_mode = OMPING_OP_MODE_SERVER;
-			*/
+				instance->op_mode = OMPING_OP_MODE_SERVER;
 			} else if (strcmp(optarg, "client") == 0) {
 				instance->op_mode = OMPING_OP_MODE_CLIENT;
+			} else if (strcmp(optarg, "collector") == 0) {
+				instance->op_mode = OMPING_OP_MODE_COLLECTOR;
+			} else if (strcmp(optarg, "scan") == 0) {
+				instance->op_mode = OMPING_OP_MODE_SHOW_VERSION;
+				scan = 1;
 			} else {
 				warnx("illegal parameter, -O argument -- %s", optarg);
 				goto error_usage_exit;
 			}
 			break;
+		case 'o':
+			instance->export_file = optarg;
+			break;
+		case 'P':
+			num = strtol(optarg, &ep, 10);
+			if (num <= 0 || num > MP_MAX_FLOWS || *ep != '\0') {
+				warnx("illegal number, -P argument -- %s", optarg);
+				goto error_usage_exit;
+			}
+			instance->mp_flows = num;
+			break;
 		case 'p':
 			port_s = optarg;
 			break;
+		case 'Q':
+			instance->no_tclasses = 0;
+
+			for (tclass_s = strtok(optarg, ","); tclass_s != NULL;
+			    tclass_s = strtok(NULL, ",")) {
+				num = strtol(tclass_s, &ep, 10);
+				if (num < 0 || num > 63 || *ep != '\0' ||
+				    instance->no_tclasses >= MP_MAX_FLOWS) {
+					warnx("illegal number, -Q argument -- %s", tclass_s);
+					goto error_usage_exit;
+				}
+
+				instance->tclasses[instance->no_tclasses++] = num << 2;
+			}
+
+			if (instance->no_tclasses == 0) {
+				warnx("illegal parameter, -Q argument is empty");
+				goto error_usage_exit;
+			}
+			break;
 		case 'R':
 			numd = strtod(optarg, &ep);
 			if (numd < MIN_RCVBUF_SIZE || *ep != '\0' || numd > INT32_MAX) {
@@ -203,7 +372,7 @@ cli_parse(int argc, char * const argv[], struct omping_instance *instance)
 				warnx("illegal number, -r argument -- %s", optarg);
 				goto error_usage_exit;
 			}
-			instance->rate_limit_time = (int)(numd * 1000.0);
+			instance->rate_limit_time = (uint64_t)(numd * 1000000000.0);
 			rate_limit_time_set = 1;
 			break;
 		case 'S':
@@ -230,6 +399,19 @@ cli_parse(int argc, char * const argv[], struct omping_instance *instance)
 			}
 			instance->timeout_time = (int)(numd * 1000.0);
 			break;
+		case 'W':
+			if (strcmp(optarg, "auto") == 0) {
+				instance->warmup_time = WARMUP_AUTO;
+				break;
+			}
+
+			numd = strtod(optarg, &ep);
+			if (numd < 0 || *ep != '\0' || numd * 1000 > INT32_MAX) {
+				warnx("illegal number, -W argument -- %s", optarg);
+				goto error_usage_exit;
+			}
+			instance->warmup_time = (int)(numd * 1000.0);
+			break;
 		case 'w':
 			numd = strtod(optarg, &ep);
 			if ((numd < 0 && numd != -1) || *ep != '\0' || numd * 1000 > INT32_MAX) {
@@ -239,6 +421,21 @@ cli_parse(int argc, char * const argv[], struct omping_instance *instance)
 			wait_for_finish_time_set = 1;
 			instance->wait_for_finish_time = (int)(numd * 1000.0);
 			break;
+		case 'X':
+			collector_addr_s = optarg;
+			break;
+		case 'x':
+			if (strcmp(optarg, "fq") == 0) {
+				instance->txtime_clock = CLOCK_MONOTONIC;
+#ifdef CLOCK_TAI
+			} else if (strcmp(optarg, "etf") == 0) {
+				instance->txtime_clock = CLOCK_TAI;
+#endif
+			} else {
+				warnx("illegal parameter, -x argument -- %s", optarg);
+				goto error_usage_exit;
+			}
+			break;
 		case '?':
 			goto error_usage_exit;
 			/* NOTREACHED */
@@ -267,6 +464,58 @@ cli_parse(int argc, char * const argv[], struct omping_instance *instance)
 		instance->op_mode = OMPING_OP_MODE_SHOW_VERSION;
 	}
 
+	if (scan) {
+		instance->scan_concurrency = (scan_concurrency > 0 ? scan_concurrency :
+		    SCAN_DEF_CONCURRENCY);
+	} else if (scan_concurrency > 0) {
+		warnx("concurrency can be set only in scan op_mode");
+		goto error_usage_exit;
+	}
+
+	if (instance->op_mode == OMPING_OP_MODE_COLLECTOR && collector_addr_s != NULL) {
+		warnx("collector address can't be set in collector op_mode");
+		goto error_usage_exit;
+	}
+
+	if (instance->op_mode != OMPING_OP_MODE_COLLECTOR && instance->export_file != NULL) {
+		warnx("export file can be set only in collector op_mode");
+		goto error_usage_exit;
+	}
+
+	if (instance->pacer_rate > 0 && instance->txtime_clock != -1) {
+		warnx("egress pacing and scheduled transmission can't be set together");
+		goto error_usage_exit;
+	}
+
+	if (instance->no_profiles > 0 &&
+	    (instance->pacer_rate > 0 || instance->txtime_clock != -1)) {
+		warnx("test profiles can't be set together with egress pacing or scheduled "
+		    "transmission");
+		goto error_usage_exit;
+	}
+
+	if (instance->no_tclasses > 0) {
+		if (instance->mp_flows > 1) {
+			warnx("multipath flows and traffic classes can't be set together");
+			goto error_usage_exit;
+		}
+
+		/*
+		 * Every traffic class is one flow and query of every class is sent in every
+		 * interval, so count is number of queries per class
+		 */
+		instance->mp_flows = instance->no_tclasses;
+		instance->send_count_queries *= instance->no_tclasses;
+	}
+
+	if ((instance->mp_flows > 1 || instance->no_tclasses > 0) &&
+	    instance->op_mode != OMPING_OP_MODE_NORMAL &&
+	    instance->op_mode != OMPING_OP_MODE_CLIENT) {
+		warnx("multipath flows and traffic classes can be set only in normal and client "
+		    "op_mode");
+		goto error_usage_exit;
+	}
+
 	if (force < 1) {
 		if (instance->wait_time < DEFAULT_WAIT_TIME) {
 			warnx("illegal nmber, -i argument %u ms < %u ms. Use -F to force.",
@@ -274,6 +523,15 @@ cli_parse(int argc, char * const argv[], struct omping_instance *instance)
 			goto error_usage_exit;
 		}
 
+		for (i = 0; i < instance->no_profiles; i++) {
+			if (instance->profiles[i].interval < DEFAULT_WAIT_TIME) {
+				warnx("illegal number, -J argument %s interval %u ms < %u ms. "
+				    "Use -F to force.", instance->profiles[i].name,
+				    instance->profiles[i].interval, DEFAULT_WAIT_TIME);
+				goto error_usage_exit;
+			}
+		}
+
 		if (instance->ttl < DEFAULT_TTL) {
 			warnx("illegal nmber, -t argument %u < %u. Use -F to force.",
 			    instance->ttl, DEFAULT_TTL);
@@ -289,14 +547,88 @@ cli_parse(int argc, char * const argv[], struct omping_instance *instance)
 		}
 	}
 
+	if (instance->efficient) {
+		if (instance->wait_time == 0) {
+			warnx("efficiency mode can't be used with zero interval");
+			goto error_usage_exit;
+		}
+
+		if (instance->fast_start || scan) {
+			warnx("efficiency mode is mutually exclusive with fast start and scan "
+			    "op_mode");
+			goto error_usage_exit;
+		}
+
+		if (instance->rt_opts.spin) {
+			warnx("efficiency mode is mutually exclusive with spin real-time option");
+			goto error_usage_exit;
+		}
+	}
+
+	if (instance->no_profiles > 0 && instance->op_mode != OMPING_OP_MODE_NORMAL &&
+	    instance->op_mode != OMPING_OP_MODE_CLIENT) {
+		warnx("test profiles can be set only in normal and client op_mode");
+		goto error_usage_exit;
+	}
+
+	if (instance->stats_thread && instance->op_mode != OMPING_OP_MODE_NORMAL &&
+	    instance->op_mode != OMPING_OP_MODE_CLIENT) {
+		warnx("stats thread can be used only in normal and client op_mode");
+		goto error_usage_exit;
+	}
+
+	switch (ip_ver_mask) {
+	case 1:
+		ip_ver = 4;
+		break;
+	case 2:
+		ip_ver = 6;
+		break;
+	default:
+		ip_ver = 0;
+		break;
+	}
+
+	dual_stack = (ip_ver_mask == 3);
+
+	if (dual_stack) {
+		if (instance->op_mode != OMPING_OP_MODE_NORMAL &&
+		    instance->op_mode != OMPING_OP_MODE_CLIENT) {
+			warnx("dual-stack can be used only in normal and client op_mode");
+			goto error_usage_exit;
+		}
+
+		if (mcast_addr_s != NULL) {
+			warnx("multicast address can't be set in dual-stack mode");
+			goto error_usage_exit;
+		}
+
+		/*
+		 * Every class has unicast and multicast socket in both stacks, plus default
+		 * unicast and multicast socket of every stack
+		 */
+		if (instance->no_tclasses > 0 &&
+		    2 * 2 * (instance->no_tclasses + 1) > RS_MAX_POLL_SOCKS) {
+			warnx("at most %d traffic classes can be used in dual-stack mode",
+			    RS_MAX_POLL_SOCKS / 4 - 1);
+			goto error_usage_exit;
+		}
+
+		if (instance->transport_method == SF_TM_IPBC) {
+			warnx("illegal transport method, -M argument ipbc can't be used in "
+			    "dual-stack mode");
+			goto error_usage_exit;
+		}
+	}
+
 	if (instance->transport_method == SF_TM_IPBC) {
-		if (instance->ip_ver == 6) {
+		if (ip_ver == 6) {
 			warnx("illegal transport method, -M argument ipbc is mutually exclusive "
 			    "with -6 option");
 			goto error_usage_exit;
 		}
 
-		instance->ip_ver = 4;
+		ip_ver = 4;
 	}
 
 	/*
@@ -323,23 +655,248 @@ cli_parse(int argc, char * const argv[], struct omping_instance *instance)
 	}
 
 	if (!rate_limit_time_set) {
-		instance->rate_limit_time = instance->wait_time;
+		instance->rate_limit_time = (uint64_t)instance->wait_time * 1000000;
+
+	}
+
+	if (instance->no_profiles > 0) {
+		/*
+		 * Other nodes send queries of same profiles, so default rate limit must allow
+		 * queries of main regime and all profiles together (and rounds of all profiles at
+		 * once)
+		 */
+		numd = (instance->no_tclasses > 0 ? instance->no_tclasses : 1) * 1000.0;
+		numd = (instance->wait_time > 0 ? numd / instance->wait_time : 0);
+		num = 0;
+
+		for (i = 0; i < instance->no_profiles; i++) {
+			numd += instance->profiles[i].burst * 1000.0 /
+			    instance->profiles[i].interval;
+			num += instance->profiles[i].burst;
+		}
+
+		if (!rate_limit_time_set && instance->rate_limit_time > 0) {
+			instance->rate_limit_time = (uint64_t)(1000000000.0 / numd);
+		}
+
+		if (!rate_limit_burst_set) {
+			instance->rate_limit_burst += num;
+		}
+	}
+
+	instance->no_stacks = (dual_stack ? 2 : 1);
+
+	for (i = 0; i < instance->no_stacks; i++) {
+		if (dual_stack) {
+			ip_ver = (i == 0 ? 4 : 6);
+		}
+
+		if (cli_parse_stack(&instance->stacks[i], argc, argv, ip_ver, port_s, mcast_addr_s,
+		    instance->transport_method, ifa_flags, dual_stack) == -1) {
+			goto error_usage_exit;
+		}
+	}
+
+	if (collector_addr_s != NULL) {
+		aii_collector_to_ai(instance->stacks[0].ip_ver, &instance->collector_addr,
+		    collector_addr_s, port_s);
+	}
+
+	return (0);
+
+error_usage_exit:
+	cliprint_usage();
+	exit(1);
+	/* NOTREACHED */
+	return (-1);
+}
+
+/*
+ * Parse test profile. prof_s is profile name followed by colon and comma separated list of options
+ * (string is modified). Supported options are interval=s (time between rounds of queries, 1 s by
+ * default), burst=n (number of queries sent to every remote host in one round, 1 by default),
+ * count=n (maximum number of queries sent to one remote host in one run), size=bytes (minimal size
+ * of query), dscp=n (DSCP of queries and answers), offset=s (start of first run), duration=s
+ * (length of run) and period=s (time between starts of runs). Times are in seconds. Profile
+ * without duration runs all the time and profile without period runs only once. Parsed profile
+ * is stored in prof.
+ * Function returns 0 on success, otherwise -1 (and error is already displayed).
+ */
+static int
+cli_parse_profile(struct prof_item *prof, char *prof_s)
+{
+	char *ep;
+	char *opt_s;
+	char *val_s;
+	double numd;
+
+	memset(prof, 0, sizeof(*prof));
+	prof->burst = 1;
+	prof->interval = DEFAULT_WAIT_TIME;
+	prof->tclass = -1;
+
+	opt_s = strchr(prof_s, ':');
+	if (opt_s != NULL) {
+		*opt_s++ = '\0';
+	}
+
+	if (*prof_s == '\0' || strlen(prof_s) >= PROF_NAME_LEN) {
+		warnx("illegal parameter, -J argument name -- %s", prof_s);
+
+		return (-1);
+	}
+
+	strcpy(prof->name, prof_s);
+
+	for (opt_s = (opt_s != NULL ? strtok(opt_s, ",") : NULL); opt_s != NULL;
+	    opt_s = strtok(NULL, ",")) {
+		val_s = strchr(opt_s, '=');
+		if (val_s == NULL) {
+			warnx("illegal parameter, -J argument -- %s", opt_s);
+
+			return (-1);
+		}
+
+		*val_s++ = '\0';
+
+		numd = strtod(val_s, &ep);
+		if (*val_s == '\0' || *ep != '\0' || numd < 0 || numd * 1000 > INT32_MAX) {
+			warnx("illegal number, -J argument %s -- %s", opt_s, val_s);
+
+			return (-1);
+		}
 
+		if (strcmp(opt_s, "interval") == 0 && numd >= 0.001) {
+			prof->interval = (int)(numd * 1000.0);
+		} else if (strcmp(opt_s, "burst") == 0 && numd >= 1 && numd <= PROF_MAX_BURST) {
+			prof->burst = (int)numd;
+		} else if (strcmp(opt_s, "count") == 0 && numd >= 1) {
+			prof->count = (uint64_t)numd;
+		} else if (strcmp(opt_s, "size") == 0 && numd <= PROF_MAX_SIZE) {
+			prof->size = (int)numd;
+		} else if (strcmp(opt_s, "dscp") == 0 && numd <= 63) {
+			prof->tclass = (int)numd << 2;
+		} else if (strcmp(opt_s, "offset") == 0) {
+			prof->offset = (int)(numd * 1000.0);
+		} else if (strcmp(opt_s, "duration") == 0 && numd >= 0.001) {
+			prof->duration = (int)(numd * 1000.0);
+		} else if (strcmp(opt_s, "period") == 0 && numd >= 0.001) {
+			prof->period = (int)(numd * 1000.0);
+		} else {
+			warnx("illegal parameter, -J argument %s -- %s", opt_s, val_s);
+
+			return (-1);
+		}
 	}
 
-	TAILQ_INIT(&instance->remote_addrs);
+	if (prof->period > 0 && (prof->duration == 0 || prof->duration > prof->period)) {
+		warnx("illegal parameter, -J argument %s duration must be set and not bigger then "
+		    "period", prof->name);
+
+		return (-1);
+	}
+
+	return (0);
+}
+
+/*
+ * Parse real-time options. rt_opts_s is comma separated list of options (string is modified).
+ * Supported options are cpu=N (pin process to CPU N), fifo[=prio] (use SCHED_FIFO scheduler with
+ * priority prio, RT_DEF_FIFO_PRIO by default), mlock (lock memory), busypoll=us (enable busy
+ * polling of sockets for us microseconds) and spin (spin on sockets instead of sleeping in poll).
+ * Parsed options are stored in rt_opts.
+ * Function returns 0 on success, otherwise -1 (and error is already displayed).
+ */
+static int
+cli_parse_rt_opts(struct rt_opts *rt_opts, char *rt_opts_s)
+{
+	char *ep;
+	char *opt_s;
+	char *val_s;
+	int num;
+
+	for (opt_s = strtok(rt_opts_s, ","); opt_s != NULL; opt_s = strtok(NULL, ",")) {
+		num = 0;
+
+		val_s = strchr(opt_s, '=');
+		if (val_s != NULL) {
+			*val_s++ = '\0';
+
+			num = strtol(val_s, &ep, 10);
+			if (*val_s == '\0' || *ep != '\0' || num < 0) {
+				warnx("illegal number, -L argument %s -- %s", opt_s, val_s);
+
+				return (-1);
+			}
+		}
 
-	no_ai = aii_parse_remote_addrs(&instance->remote_addrs, argc, argv, port_s,
-	    instance->ip_ver);
+		if (strcmp(opt_s, "cpu") == 0 && val_s != NULL) {
+			rt_opts->cpu = num;
+		} else if (strcmp(opt_s, "fifo") == 0) {
+			if (val_s == NULL) {
+				num = RT_DEF_FIFO_PRIO;
+			}
+
+			if (num < RT_MIN_FIFO_PRIO || num > RT_MAX_FIFO_PRIO) {
+				warnx("illegal number, -L argument fifo -- %d", num);
+
+				return (-1);
+			}
+
+			rt_opts->fifo_prio = num;
+		} else if (strcmp(opt_s, "mlock") == 0 && val_s == NULL) {
+			rt_opts->mlock = 1;
+		} else if (strcmp(opt_s, "busypoll") == 0 && val_s != NULL && num > 0) {
+			rt_opts->busy_poll = num;
+		} else if (strcmp(opt_s, "spin") == 0 && val_s == NULL) {
+			rt_opts->spin = 1;
+		} else {
+			warnx("illegal parameter, -L argument -- %s", opt_s);
+
+			return (-1);
+		}
+	}
+
+	rt_opts->enabled = 1;
+
+	return (0);
+}
+
+/*
+ * Parse remote addresses (argc items of argv array) and fill one stack of omping instance. ip_ver
+ * is forced IP version (4 or 6) or 0 for automatic detection. port_s is port, mcast_addr_s is
+ * requested multicast address (or NULL for default one), transport_method is used transport method
+ * and ifa_flags are required flags of local interface. If dual_stack is set, every remote address
+ * host name is suffixed by IP version, so both stacks of same host can be distinguished.
+ * Following items of stack are filled. ip_ver is used IP version, remote_addrs contains remote
+ * addresses (without local one), local_addr is local address and local_ifname is name of local
+ * interface. single_addr is boolean set if only one remote address is entered. mcast_addr is
+ * multicast (or broadcast) address and port is port from mcast_addr.
+ * Function returns 0 on success, otherwise -1 (and error is already displayed).
+ */
+static int
+cli_parse_stack(struct omping_stack *stack, int argc, char * const argv[], int ip_ver,
+    const char *port_s, const char *mcast_addr_s, enum sf_transport_method transport_method,
+    unsigned int ifa_flags, int dual_stack)
+{
+	struct ai_item *ai_item;
+	struct ifaddrs *ifa_list, *ifa_local;
+	char *hn;
+	size_t hn_len;
+	int no_ai;
+	int res;
+
+	TAILQ_INIT(&stack->remote_addrs);
+
+	no_ai = aii_parse_remote_addrs(&stack->remote_addrs, argc, argv, port_s, ip_ver);
 	if (no_ai < 1) {
 		warnx("at least one remote addresses should be specified");
-		goto error_usage_exit;
+		return (-1);
 	}
 
-	instance->ip_ver = aii_return_ip_ver(&instance->remote_addrs, instance->ip_ver,
-	    mcast_addr_s, port_s);
+	stack->ip_ver = aii_return_ip_ver(&stack->remote_addrs, ip_ver, mcast_addr_s, port_s);
 
-	if (aii_find_local(&instance->remote_addrs, &instance->ip_ver, &ifa_list, &ifa_local,
+	if (aii_find_local(&stack->remote_addrs, &stack->ip_ver, &ifa_list, &ifa_local,
 	    &ai_item, ifa_flags) < 0) {
 		errx(1, "Can't find local address in arguments");
 	}
@@ -347,39 +904,56 @@ cli_parse(int argc, char * const argv[], struct omping_instance *instance)
 	/*
 	 * Change aii_list to struct of sockaddr_storage(s)
 	 */
-	aii_list_ai_to_sa(&instance->remote_addrs, instance->ip_ver);
+	aii_list_ai_to_sa(&stack->remote_addrs, stack->ip_ver);
 
 	/*
 	 * Find local addr and copy that. Also remove that from list
 	 */
-	aii_ifa_local_to_ai(&instance->remote_addrs, ai_item, ifa_local, instance->ip_ver,
-	    &instance->local_addr, &instance->single_addr);
+	aii_ifa_local_to_ai(&stack->remote_addrs, ai_item, ifa_local, stack->ip_ver,
+	    &stack->local_addr, &stack->single_addr);
+
+	if (dual_stack) {
+		TAILQ_FOREACH(ai_item, &stack->remote_addrs, entries) {
+			hn_len = strlen(ai_item->host_name) + 4;
+
+			hn = (char *)malloc(hn_len);
+			if (hn == NULL) {
+				errx(1, "Can't alloc memory");
+			}
+
+			snprintf(hn, hn_len, "%s/v%d", ai_item->host_name, stack->ip_ver);
+			free(ai_item->host_name);
+			ai_item->host_name = hn;
+		}
+	}
 
 	/*
 	 * Store local ifname
 	 */
-	instance->local_ifname = strdup(ifa_local->ifa_name);
-	if (instance->local_ifname == NULL) {
+	stack->local_ifname = strdup(ifa_local->ifa_name);
+	if (stack->local_ifname == NULL) {
 		errx(1, "Can't alloc memory");
 	}
 
-	switch (instance->transport_method) {
+	switch (transport_method) {
 	case SF_TM_ASM:
 	case SF_TM_SSM:
 		/*
 		 * Convert mcast addr to something useful
 		 */
-		aii_mcast_to_ai(instance->ip_ver, &instance->mcast_addr, mcast_addr_s, port_s);
+		aii_mcast_to_ai(stack->ip_ver, &stack->mcast_addr, mcast_addr_s, port_s);
 		break;
 	case SF_TM_IPBC:
 		/*
 		 * Convert broadcast addr to something useful
 		 */
-		res = aii_ipbc_to_ai(&instance->mcast_addr, mcast_addr_s, port_s, ifa_local);
+		res = aii_ipbc_to_ai(&stack->mcast_addr, mcast_addr_s, port_s, ifa_local);
 		if (res == -1) {
 			warnx("illegal broadcast address, -M argument doesn't match with local"
 			    " broadcast address");
-			goto error_usage_exit;
+			freeifaddrs(ifa_list);
+
+			return (-1);
 		}
 		break;
 	}
@@ -387,15 +961,9 @@ cli_parse(int argc, char * const argv[], struct omping_instance *instance)
 	/*
 	 * Assign port from mcast_addr
 	 */
-	instance->port = af_sa_port(AF_CAST_SA(&instance->mcast_addr.sas));
+	stack->port = af_sa_port(AF_CAST_SA(&stack->mcast_addr.sas));
 
 	freeifaddrs(ifa_list);
 
 	return (0);
-
-error_usage_exit:
-	cliprint_usage();
-	exit(1);
-	/* NOTREACHED */
-	return (-1);
 }
@@ -30,16 +30,48 @@
 #include "logging.h"
 #include "omping.h"
 
+/*
+ * Display number of query messages which were not answered because of rate limit. no_client_rl
+ * is number of queries limited by per client rate limit and no_aggr_rl is number of queries
+ * limited by aggregate rate limit.
+ */
+void
+cliprint_answer_rl_stats(uint64_t no_client_rl, uint64_t no_aggr_rl)
+{
+
+	printf("queries rate limited per client/aggregate = %"PRIu64"/%"PRIu64"\n", no_client_rl,
+	    no_aggr_rl);
+}
+
+/*
+ * Print statistics of transport backend. name is name of backend, no_msgs is number of messages
+ * received by backend and recv_time is time in ms between first and last received message.
+ */
+void
+cliprint_backend_stats(const char *name, uint64_t no_msgs, double recv_time)
+{
+
+	printf("transport backend %s: %"PRIu64" messages received", name, no_msgs);
+
+	if (recv_time > 0) {
+		printf(" (%.0f pps)", no_msgs / (recv_time / 1000.0));
+	}
+
+	printf("\n");
+}
+
 /*
  * Print status of client with host_name (maximum length of host_name_len). transport_method is
  * transport method to be used, mcast_addr is current multicast address to be used by client.
- * remote_addr is address of client and state is current state of client.
+ * remote_addr is address of client and state is current state of client. est_time is time in ms
+ * which took to establish session with client. It's displayed only for RH_CS_QUERY state and
+ * if it's not negative.
  */
 void
 cliprint_client_state(const char *host_name, int host_name_len,
     enum sf_transport_method transport_method, const struct sockaddr_storage *mcast_addr,
     const struct sockaddr_storage *remote_addr, enum rh_client_state state,
-    enum rh_client_stop_reason stop_reason)
+    enum rh_client_stop_reason stop_reason, double est_time)
 {
 	char mcast_addr_str[INET6_ADDRSTRLEN];
 	char rh_addr_str[INET6_ADDRSTRLEN];
@@ -73,6 +105,10 @@ cliprint_client_state(const char *host_name, int host_name_len,
 			printf("joined (S,G) = (*, %s), pinging", mcast_addr_str);
 			break;
 		}
+
+		if (est_time >= 0) {
+			printf(" (established in %.3fms)", est_time);
+		}
 		break;
 	case RH_CS_STOP:
 		switch (stop_reason) {
@@ -92,6 +128,9 @@ cliprint_client_state(const char *host_name, int host_name_len,
 		case RH_CSR_REMOTE_VERSION_RECEIVED:
 			printf("remote version received");
 			break;
+		case RH_CSR_NO_RESPONSE:
+			printf("response message not received");
+			break;
 		}
 		break;
 	}
@@ -99,44 +138,188 @@ cliprint_client_state(const char *host_name, int host_name_len,
 }
 
 /*
- * Print final remote versions. remote_hosts is list with all remote hosts and host_name_len is
- * maximal length of host name in list.
+ * Print collector matrix. One line is printed for every reporter and peer pair with known stats.
+ * Loss is computed from number of queries sent by reporter and answers received from peer.
+ * After matrix, result of multicast loss correlation is printed for every node with classified
+ * loss (see struct col_node).
  */
 void
-cliprint_final_remote_version(const struct rh_list *remote_hosts, int host_name_len)
+cliprint_collector_matrix(const struct col_matrix *matrix)
 {
-	struct rh_item *rh_item;
-	struct rh_item_ci *ci;
-	size_t i;
-	unsigned char ch;
-
+	char peer_str[INET6_ADDRSTRLEN];
+	char rep_str[INET6_ADDRSTRLEN];
+	const struct col_entry *entry;
+	const struct col_node *node;
+	uint32_t i, j;
+	int k;
+
+	printf("\ncollector matrix: %"PRIu32" nodes, %"PRIu64" reports", matrix->no_nodes,
+	    matrix->no_reports);
+	if (matrix->no_bad_reports > 0) {
+		printf(", %"PRIu64" malformed", matrix->no_bad_reports);
+	}
 	printf("\n");
 
-	TAILQ_FOREACH(rh_item, remote_hosts, entries) {
-			ci = &rh_item->client_info;
+	for (i = 0; i < matrix->no_nodes; i++) {
+		node = &matrix->nodes[i];
+		af_sa_to_str(AF_CAST_SA(&node->addr), rep_str);
 
-			printf("%-*s : ", host_name_len, rh_item->addr->host_name);
+		for (j = 0; j < node->row_size; j++) {
+			entry = &node->row[j];
+			if (!entry->isset) {
+				continue;
+			}
 
-			if (ci->server_info_len == 0) {
-				printf("response message not received\n");
-			} else {
-				for (i = 0; i < ci->server_info_len; i++) {
-					ch = ci->server_info[i];
+			af_sa_to_str(AF_CAST_SA(&matrix->nodes[j].addr), peer_str);
 
-				if (ch >= ' ' && ch < 0x7f && ch != '\\') {
-					fputc(ch, stdout);
-				} else {
-					if (ch == '\\') {
-						printf("\\\\");
-					} else {
-						printf("\\x%02X", ch);
-					}
-				}
-			}
+			printf("%s -> %s : xmt = %"PRIu32, rep_str, peer_str, entry->stats.no_sent);
 
+			for (k = 0; k < 2; k++) {
+				printf(", %5scast rcv/%%loss/avg = %"PRIu32"/%d%%/%.3f",
+				    (k == 0 ? "uni" : "multi"), entry->stats.no_received[k],
+				    util_packet_loss_percent(entry->stats.no_sent,
+				    entry->stats.no_received[k]),
+				    entry->stats.avg_rtt_us[k] / 1000.0);
+			}
 			printf("\n");
 		}
 	}
+
+	for (i = 0; i < matrix->no_nodes; i++) {
+		node = &matrix->nodes[i];
+
+		if (node->no_loss_shared == 0 && node->no_loss_partial == 0 &&
+		    node->no_loss_edge == 0 && node->no_loss_unattributed == 0) {
+			continue;
+		}
+
+		af_sa_to_str(AF_CAST_SA(&node->addr), rep_str);
+
+		printf("%s : multicast loss as sender shared/partial = %"PRIu64"/%"PRIu64
+		    ", as receiver edge = %"PRIu64", unattributed = %"PRIu64"\n", rep_str,
+		    node->no_loss_shared, node->no_loss_partial, node->no_loss_edge,
+		    node->no_loss_unattributed);
+	}
+}
+
+/*
+ * Print efficiency statistics. no_wakeups is number of wakeups of main loop, run_time is time in
+ * ms omping was running, user_time and sys_time are CPU time in ms spent in user and system mode.
+ */
+void
+cliprint_eff_stats(uint64_t no_wakeups, double run_time, double user_time, double sys_time)
+{
+
+	if (run_time <= 0) {
+		run_time = 1;
+	}
+
+	printf("efficiency: %"PRIu64" wakeups (%.3f/s), cpu user/sys = %.3f/%.3f ms (%.4f%%) in "
+	    "%.3f s\n", no_wakeups, no_wakeups / (run_time / 1000.0), user_time, sys_time,
+	    (user_time + sys_time) / run_time * 100.0, run_time / 1000.0);
+}
+
+/*
+ * Print final statistics of multipath flows of rh_item for packets of cast_index type (unicast =
+ * 0, multicast/broadcast = 1). host_name_len is maximal length of host name and cast_str is string
+ * representation of cast type. Flow whose loss is at least MP_LOSS_DIFF_PCT percentage points
+ * bigger or whose average RTT is MP_RTT_DIFF_PCT percent (and at least MP_RTT_DIFF_MIN_NS)
+ * bigger then values of all flows together is highlighted, because its path (or treatment of its
+ * traffic class) probably differs. Flow with traffic class is displayed by its DSCP value.
+ */
+void
+cliprint_final_flow_stats(const struct rh_item *rh_item, int host_name_len, int cast_index,
+    const char *cast_str)
+{
+	const struct rh_item_ci *ci;
+	const struct rh_item_flow *flow;
+	double avg_rtt;
+	double flow_loss;
+	double loss;
+	double rtt_sum;
+	int i;
+	uint64_t no_rtt;
+	uint64_t received;
+	uint64_t sent;
+
+	ci = &rh_item->client_info;
+
+	rtt_sum = 0;
+	no_rtt = 0;
+	received = 0;
+	sent = 0;
+
+	for (i = 0; i < ci->no_flows; i++) {
+		flow = &ci->flows[i];
+
+		rtt_sum += flow->avg_rtt[cast_index] * flow->no_rtt[cast_index];
+		no_rtt += flow->no_rtt[cast_index];
+		received += flow->no_received[cast_index];
+		sent += flow->no_sent;
+	}
+
+	avg_rtt = (no_rtt > 0 ? rtt_sum / no_rtt : 0);
+	loss = (sent > 0 ? 100.0 - (100.0 * received / sent) : 0);
+
+	for (i = 0; i < ci->no_flows; i++) {
+		flow = &ci->flows[i];
+
+		if (flow->no_sent == 0) {
+			continue;
+		}
+
+		flow_loss = 100.0 - (100.0 * flow->no_received[cast_index] / flow->no_sent);
+
+		printf("%-*s : ", host_name_len, rh_item->addr->host_name);
+		printf("%5scast, ", cast_str);
+		if (flow->tclass >= 0) {
+			printf("dscp %2d", flow->tclass >> 2);
+		} else {
+			printf("flow %2d", i);
+		}
+
+		printf(" xmt/rcv/%%loss = %"PRIu64"/%"PRIu64"/%d%%", flow->no_sent,
+		    flow->no_received[cast_index],
+		    util_packet_loss_percent(flow->no_sent, flow->no_received[cast_index]));
+
+		if (flow->no_rtt[cast_index] > 0) {
+			printf(", avg/std-dev = %.3f/%.3f", flow->avg_rtt[cast_index] / UTIL_NSINMS,
+			    util_ov_std_dev(flow->m2_rtt[cast_index], flow->no_rtt[cast_index]) /
+			    UTIL_NSINMS);
+		}
+
+		if (flow->no_sent >= MP_MIN_SENT) {
+			if (flow_loss - loss >= MP_LOSS_DIFF_PCT) {
+				printf(" (loss differs)");
+			}
+
+			if (flow->no_rtt[cast_index] > 0 &&
+			    flow->avg_rtt[cast_index] - avg_rtt >= MP_RTT_DIFF_MIN_NS &&
+			    flow->avg_rtt[cast_index] >=
+			    avg_rtt * (1.0 + MP_RTT_DIFF_PCT / 100.0)) {
+				printf(" (rtt differs)");
+			}
+		}
+
+		printf("\n");
+	}
+}
+
+/*
+ * Print final remote versions. remote_hosts is list with all remote hosts and host_name_len is
+ * maximal length of host name in list.
+ */
+void
+cliprint_final_remote_version(const struct rh_list *remote_hosts, int host_name_len)
+{
+	struct rh_item *rh_item;
+
+	printf("\n");
+
+	TAILQ_FOREACH(rh_item, remote_hosts, entries) {
+		cliprint_remote_version(rh_item->addr->host_name, host_name_len,
+		    rh_item->client_info.server_info, rh_item->client_info.server_info_len);
+	}
 }
 
 /*
@@ -149,13 +332,18 @@ cliprint_final_stats(const struct rh_list *remote_hosts, int host_name_len,
     enum sf_transport_method transport_method)
 {
 	const char *cast_str;
+	const struct rh_cast_stats *cs;
 	struct rh_item *rh_item;
 	struct rh_item_ci *ci;
+	struct rh_item_ss *ss;
+	struct rh_item_wu *wu;
 	enum sf_cast_type cast_type;
 	double avg_rtt;
 	int i;
 	int loss;
 	int loss_adj;
+	uint64_t fwd_expected;
+	uint64_t fwd_received;
 	uint64_t received;
 	uint64_t sent;
 
@@ -185,28 +373,34 @@ cliprint_final_stats(const struct rh_list *remote_hosts, int host_name_len,
 
 			cast_str = sf_cast_type_to_str(cast_type);
 			ci = &rh_item->client_info;
+			cs = &ci->cast_stats[i];
 
-			received = ci->no_received[i];
+			received = cs->no_received;
 			sent = ci->no_sent;
 
 			printf("%-*s : ", host_name_len, rh_item->addr->host_name);
 
 			if (received == 0 && i == 0) {
-				printf("response message never received\n");
+				printf("response message never received");
+				if (ci->no_unreach > 0) {
+					printf(" (unreachable, %"PRIu64" ICMP errors)",
+					    ci->no_unreach);
+				}
+				printf("\n");
 				break;
 			}
 
 			if (i != 0) {
-				loss_adj = util_packet_loss_percent(sent - ci->first_mcast_seq + 1,
-				    received);
+				loss_adj = util_packet_loss_percent(rh_ci_answerable(ci,
+				    sent - ci->first_mcast_seq + 1), received);
 			}
 
-			loss = util_packet_loss_percent(sent, received);
+			loss = util_packet_loss_percent(rh_ci_answerable(ci, sent), received);
 
-			if (received == 0) {
+			if (cs->no_rtt == 0) {
 				avg_rtt = 0;
 			} else {
-				avg_rtt = ci->avg_rtt[i] / UTIL_NSINMS;
+				avg_rtt = cs->avg_rtt / UTIL_NSINMS;
 			}
 
 			printf("%5scast, ", cast_str);
@@ -214,8 +408,8 @@ cliprint_final_stats(const struct rh_list *remote_hosts, int host_name_len,
 			printf("xmt/rcv/%%loss = ");
 			printf("%"PRIu64"/%"PRIu64, sent, received);
 
-			if (ci->no_dups[i] > 0) {
-				printf("+%"PRIu64, ci->no_dups[i]);
+			if (cs->no_dups > 0) {
+				printf("+%"PRIu64, cs->no_dups);
 			}
 
 			printf("/%d%%", loss);
@@ -223,11 +417,65 @@ cliprint_final_stats(const struct rh_list *remote_hosts, int host_name_len,
 				printf(" (seq>=%"PRIu32" %d%%)", ci->first_mcast_seq, loss_adj);
 			}
 
+			if (ci->no_throttled > 0) {
+				printf(", throttled = %"PRIu64, ci->no_throttled);
+			}
+
 			printf(", min/avg/max/std-dev = ");
-			printf("%.3f/%.3f/%.3f/%.3f", ci->rtt_min[i] / UTIL_NSINMS, avg_rtt,
-			    ci->rtt_max[i] / UTIL_NSINMS,
-			    util_ov_std_dev(ci->m2_rtt[i], ci->no_received[i]) / UTIL_NSINMS);
+			printf("%.3f/%.3f/%.3f/%.3f", cs->rtt_min / UTIL_NSINMS, avg_rtt,
+			    cs->rtt_max / UTIL_NSINMS,
+			    util_ov_std_dev(cs->m2_rtt, cs->no_rtt) / UTIL_NSINMS);
+			if (i == 0 && ci->no_unreach > 0) {
+				printf(", unreachable = %"PRIu64, ci->no_unreach);
+			}
 			printf("\n");
+
+			if (ci->no_flows > 1) {
+				cliprint_final_flow_stats(rh_item, host_name_len, i, cast_str);
+			}
+
+			ss = &ci->srv_stats;
+			if (ss->isset) {
+				printf("%-*s : ", host_name_len, rh_item->addr->host_name);
+				printf("%5scast, ", cast_str);
+
+				if (i == 0) {
+					fwd_expected = ss->fwd_expected_base;
+					fwd_received = ss->fwd_received_base + ss->ses.no_received;
+
+					if (ss->ses.no_received > 0) {
+						fwd_expected += (uint32_t)(ss->ses.max_seq -
+						    ss->ses.first_seq) + 1;
+					}
+
+					printf("fwd xmt/rcv/%%loss = %"PRIu64"/%"PRIu64"/%d%%, ",
+					    fwd_expected, fwd_received,
+					    util_packet_loss_percent(fwd_expected, fwd_received));
+				}
+
+				printf("rev xmt/rcv/%%loss = %"PRIu64"/%"PRIu64"/%d%%",
+				    ss->rev_answered[i], ss->rev_received[i],
+				    util_packet_loss_percent(ss->rev_answered[i],
+				    ss->rev_received[i]));
+
+				if (i == 0) {
+					printf(", fwd jitter = %.3fms",
+					    ss->ses.jitter_us / 1000.0);
+				}
+				printf("\n");
+			}
+
+			wu = &ci->warmup[i];
+			if (wu->no_received > 0) {
+				printf("%-*s : ", host_name_len, rh_item->addr->host_name);
+				printf("%5scast, ", cast_str);
+				printf("warm-up rcv = %"PRIu64, wu->no_received);
+				printf(", min/avg/max/std-dev = ");
+				printf("%.3f/%.3f/%.3f/%.3f", wu->rtt_min / UTIL_NSINMS,
+				    wu->avg_rtt / UTIL_NSINMS, wu->rtt_max / UTIL_NSINMS,
+				    util_ov_std_dev(wu->m2_rtt, wu->no_received) / UTIL_NSINMS);
+				printf("\n");
+			}
 		}
 	}
 }
@@ -242,6 +490,29 @@ cliprint_nl(void)
 	printf("\n");
 }
 
+/*
+ * Print statistics of egress pacer. no_bytes is number of sent bytes (including IP and UDP
+ * headers), run_time is time in ms omping was running, no_deferred is number of queries which
+ * waited for tokens of pacer (instead of waiting in queue of link), delay_sum and delay_max are
+ * sum and maximum of their waiting times in ns and no_skipped is number of queries which were not
+ * sent because queue of remote host was full.
+ */
+void
+cliprint_pacer_stats(uint64_t no_bytes, double run_time, uint64_t no_deferred, uint64_t delay_sum,
+    uint64_t delay_max, uint64_t no_skipped)
+{
+
+	if (run_time <= 0) {
+		run_time = 1;
+	}
+
+	printf("egress pacer: %"PRIu64" bytes sent (%.3f Mbit/s), %"PRIu64" queries held back from "
+	    "link queue (avg %.3f ms, max %.3f ms), %"PRIu64" skipped\n", no_bytes,
+	    no_bytes * 8 / (run_time * 1000.0), no_deferred,
+	    (no_deferred > 0 ? delay_sum / (double)no_deferred / UTIL_NSINMS : 0),
+	    delay_max / UTIL_NSINMS, no_skipped);
+}
+
 /*
  * Print packet statistics. host_name is remote host name with maximal host_name_len length. seq is
  * sequence number of packet, is_dup is boolean with information if packet is duplicate or not,
@@ -293,6 +564,184 @@ cliprint_packet_stats(const char *host_name, int host_name_len, uint32_t seq, in
 	printf("\n");
 }
 
+/*
+ * Print final statistics of test profiles. remote_hosts is list of remote hosts with statistics
+ * of profiles, host_name_len is maximal length of host name and profiles is array of no_profiles
+ * profiles. transport_method is used transport method. Remote hosts which were not sent any query
+ * of profile are skipped.
+ */
+void
+cliprint_profile_stats(const struct rh_list *remote_hosts, int host_name_len,
+    const struct prof_item *profiles, int no_profiles, enum sf_transport_method transport_method)
+{
+	const struct rh_item_prof *ps;
+	struct rh_item *rh_item;
+	enum sf_cast_type cast_type;
+	int i, j;
+
+	for (i = 0; i < no_profiles; i++) {
+		printf("profile %s, %"PRIu64" runs\n", profiles[i].name, profiles[i].no_runs);
+
+		TAILQ_FOREACH(rh_item, remote_hosts, entries) {
+			ps = &rh_item->client_info.profiles[i];
+
+			if (ps->no_sent == 0) {
+				continue;
+			}
+
+			for (j = 0; j < 2; j++) {
+				if (j == 0) {
+					cast_type = SF_CT_UNI;
+				} else {
+					cast_type = (transport_method == SF_TM_IPBC ? SF_CT_BROAD :
+					    SF_CT_MULTI);
+				}
+
+				printf("%-*s : ", host_name_len, rh_item->addr->host_name);
+
+				if (ps->no_received[j] == 0 && j == 0) {
+					printf("response message never received\n");
+					break;
+				}
+
+				printf("%5scast, ", sf_cast_type_to_str(cast_type));
+				printf("xmt/rcv/%%loss = %"PRIu64"/%"PRIu64"/%d%%", ps->no_sent,
+				    ps->no_received[j],
+				    util_packet_loss_percent(ps->no_sent, ps->no_received[j]));
+				printf(", min/avg/max/std-dev = ");
+				printf("%.3f/%.3f/%.3f/%.3f\n", ps->rtt_min[j] / UTIL_NSINMS,
+				    ps->avg_rtt[j] / UTIL_NSINMS, ps->rtt_max[j] / UTIL_NSINMS,
+				    util_ov_std_dev(ps->m2_rtt[j], ps->no_received[j]) /
+				    UTIL_NSINMS);
+			}
+		}
+	}
+}
+
+/*
+ * Print remote version. host_name is remote host name with maximal host_name_len length.
+ * server_info is server information with server_info_len length received from remote host.
+ * server_info_len 0 means that response was not received. Non printable characters are escaped.
+ */
+void
+cliprint_remote_version(const char *host_name, int host_name_len, const char *server_info,
+    size_t server_info_len)
+{
+	size_t i;
+	unsigned char ch;
+
+	printf("%-*s : ", host_name_len, host_name);
+
+	if (server_info_len == 0) {
+		printf("response message not received\n");
+
+		return ;
+	}
+
+	for (i = 0; i < server_info_len; i++) {
+		ch = server_info[i];
+
+		if (ch >= ' ' && ch < 0x7f && ch != '\\') {
+			fputc(ch, stdout);
+		} else {
+			if (ch == '\\') {
+				printf("\\\\");
+			} else {
+				printf("\\x%02X", ch);
+			}
+		}
+	}
+
+	printf("\n");
+
+	/*
+	 * Versions are streamed as they arrive, so make them visible also if output is not terminal
+	 */
+	fflush(stdout);
+}
+
+/*
+ * Print self-jitter statistics of real-time mode. stats are collected statistics.
+ */
+void
+cliprint_rt_stats(const struct rt_stats *stats)
+{
+
+	if (stats->no_samples == 0) {
+		printf("self-jitter: no packet received\n");
+
+		return ;
+	}
+
+	printf("self-jitter: wakeup delay avg/max/std-dev = %.3f/%.3f/%.3f us (%"PRIu64
+	    " packets)\n", stats->avg_delay / 1000.0, stats->max_delay / 1000.0,
+	    util_ov_std_dev(stats->m2_delay, stats->no_samples) / 1000.0, stats->no_samples);
+}
+
+/*
+ * Print summary of scan. remote_hosts is list with all remote hosts and scan_time is time in ms
+ * spent by scanning.
+ */
+void
+cliprint_scan_summary(const struct rh_list *remote_hosts, double scan_time)
+{
+	struct rh_item *rh_item;
+	unsigned int no_hosts;
+	unsigned int no_responded;
+
+	no_hosts = no_responded = 0;
+
+	TAILQ_FOREACH(rh_item, remote_hosts, entries) {
+		no_hosts++;
+
+		if (rh_item->client_info.server_info_len > 0) {
+			no_responded++;
+		}
+	}
+
+	printf("\n%u hosts scanned in %.3fms, %u responded, %u not responded\n", no_hosts,
+	    scan_time, no_responded, no_hosts - no_responded);
+}
+
+/*
+ * Display memory used by server info table (state of all clients in server op_mode). table is
+ * server info table.
+ */
+void
+cliprint_si_table_mem(const struct rh_si_table *table)
+{
+	size_t mem_size;
+
+	mem_size = rh_si_table_mem_size(table);
+
+	printf("server state: %u clients, %zu bytes (%.1f bytes/client)\n", table->no_items,
+	    mem_size, (table->no_items > 0 ? (double)mem_size / table->no_items : 0.0));
+}
+
+/*
+ * Display statistics of stats ring. ring is ring used to pass answers to stats thread. Number of
+ * processed records is number of records (answers and control records) consumed by stats thread.
+ */
+void
+cliprint_stats_ring(const struct ring *ring)
+{
+
+	printf("stats thread: %"PRIu64" records processed, %"PRIu64" dropped by full ring (%u "
+	    "records)\n", __atomic_load_n(&ring->tail.val, __ATOMIC_ACQUIRE), ring->no_overflows,
+	    ring->size);
+}
+
+/*
+ * Display statistics of stop messages rate limit. stop_rl is rate limit table of stop messages.
+ */
+void
+cliprint_stop_rl_stats(const struct rl_table *stop_rl)
+{
+
+	printf("stop messages sent/rate limited = %"PRIu64"/%"PRIu64"\n", stop_rl->no_passed,
+	    stop_rl->no_limited);
+}
+
 /*
  * Display application ussage
  */
@@ -300,10 +749,13 @@ void
 cliprint_usage(void)
 {
 
-	printf("usage: %s [-46CDEFqVv] [-c count] [-i interval] [-M transport_method]\n",
+	printf("usage: %s [-46CDEeFfkqVv] [-A aggr_rate] [-B burst] [-b backend]\n",
 	    PROGRAM_NAME);
-	printf("%14s[-m mcast_addr] [-O op_mode] [-p port] [-R rcvbuf] [-r rate_limit]\n", "");
-	printf("%14s[-S sndbuf] [-T timeout] [-t ttl] [-w wait_time] remote_addr...\n", "");
+	printf("%14s[-c count] [-g egress_rate] [-i interval] [-J profile] [-L rt_opts]\n", "");
+	printf("%14s[-M transport_method] [-m mcast_addr] [-n concurrency] [-O op_mode]\n", "");
+	printf("%14s[-o export_file] [-P flows] [-p port] [-Q dscp_list] [-R rcvbuf]\n", "");
+	printf("%14s[-r rate_limit] [-S sndbuf] [-T timeout] [-t ttl] [-W warmup]\n", "");
+	printf("%14s[-w wait_time] [-X collector_addr] [-x qdisc] remote_addr...\n", "");
 }
 
 /*
@@ -21,17 +21,34 @@
 #ifndef _CLIPRINT_H_
 #define _CLIPRINT_H_
 
+#include "colfunc.h"
+#include "proffunc.h"
 #include "rhfunc.h"
+#include "ringfunc.h"
+#include "rlfunc.h"
+#include "rtfunc.h"
 #include "sockfunc.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+extern void	cliprint_answer_rl_stats(uint64_t no_client_rl, uint64_t no_aggr_rl);
+
+extern void	cliprint_backend_stats(const char *name, uint64_t no_msgs, double recv_time);
+
 extern void	cliprint_client_state(const char *host_name, int host_name_len,
     enum sf_transport_method transport_method, const struct sockaddr_storage *mcast_addr,
     const struct sockaddr_storage *remote_addr, enum rh_client_state state,
-    enum rh_client_stop_reason stop_reason);
+    enum rh_client_stop_reason stop_reason, double est_time);
+
+extern void	cliprint_collector_matrix(const struct col_matrix *matrix);
+
+extern void	cliprint_eff_stats(uint64_t no_wakeups, double run_time, double user_time,
+    double sys_time);
+
+extern void	cliprint_final_flow_stats(const struct rh_item *rh_item, int host_name_len,
+    int cast_index, const char *cast_str);
 
 extern void	cliprint_final_remote_version(const struct rh_list *remote_hosts,
     int host_name_len);
@@ -41,10 +58,30 @@ extern void	cliprint_final_stats(const struct rh_list *remote_hosts, int host_na
 
 extern void	cliprint_nl(void);
 
+extern void	cliprint_pacer_stats(uint64_t no_bytes, double run_time, uint64_t no_deferred,
+    uint64_t delay_sum, uint64_t delay_max, uint64_t no_skipped);
+
 extern void	cliprint_packet_stats(const char *host_name, int host_name_len, uint32_t seq,
     int is_dup, size_t msg_len, int dist_set, uint8_t dist, int rtt_set, double rtt,
     double avg_rtt, int loss, enum sf_cast_type cast_type, int cont_stat);
 
+extern void	cliprint_profile_stats(const struct rh_list *remote_hosts, int host_name_len,
+    const struct prof_item *profiles, int no_profiles,
+    enum sf_transport_method transport_method);
+
+extern void	cliprint_remote_version(const char *host_name, int host_name_len,
+    const char *server_info, size_t server_info_len);
+
+extern void	cliprint_rt_stats(const struct rt_stats *stats);
+
+extern void	cliprint_scan_summary(const struct rh_list *remote_hosts, double scan_time);
+
+extern void	cliprint_si_table_mem(const struct rh_si_table *table);
+
+extern void	cliprint_stats_ring(const struct ring *ring);
+
+extern void	cliprint_stop_rl_stats(const struct rl_table *stop_rl);
+
 extern void	cliprint_usage(void);
 extern void	cliprint_version(void);
 
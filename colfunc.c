@@ -0,0 +1,539 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+ * FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Author: agent <agent@local>
+ */
+
+#include <sys/types.h>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include <err.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "addrfunc.h"
+#include "colfunc.h"
+#include "logging.h"
+#include "tlv.h"
+
+/*
+ * Initial size of hash table and nodes array
+ */
+#define COL_INITIAL_SIZE	64
+
+static int	col_matrix_hash_find(const struct col_matrix *matrix,
+    const struct sockaddr_storage *addr, uint32_t *slot);
+
+static void	col_matrix_hash_grow(struct col_matrix *matrix);
+
+static void	col_matrix_loss_add(struct col_matrix *matrix, uint32_t sender_id,
+    uint32_t receiver_id, uint32_t seq);
+
+static void	col_matrix_loss_classify(struct col_matrix *matrix, uint32_t sender_id,
+    struct col_loss_event *event);
+
+static uint32_t	col_matrix_loss_covering(const struct col_matrix *matrix, uint32_t sender_id,
+    uint32_t seq, int *complete);
+
+static void	col_matrix_loss_process(struct col_matrix *matrix, uint32_t receiver_id,
+    uint32_t sender_id, const struct tlv_loss_runs *loss_runs);
+
+static int64_t	col_matrix_node_id(struct col_matrix *matrix,
+    const struct sockaddr_storage *addr);
+
+/*
+ * Create empty collector matrix.
+ */
+void
+col_matrix_create(struct col_matrix *matrix)
+{
+
+	memset(matrix, 0, sizeof(*matrix));
+
+	matrix->hash_size = COL_INITIAL_SIZE;
+	matrix->hash_table = (uint32_t *)calloc(matrix->hash_size, sizeof(uint32_t));
+	if (matrix->hash_table == NULL) {
+		errx(1, "Can't alloc memory");
+	}
+}
+
+/*
+ * Export matrix to stream f in CSV format. One line is printed for every reporter and peer pair
+ * with known stats. Function returns 0 on success, otherwise -1 and errno is set.
+ */
+int
+col_matrix_export(const struct col_matrix *matrix, FILE *f)
+{
+	char peer_str[INET6_ADDRSTRLEN];
+	char rep_str[INET6_ADDRSTRLEN];
+	const struct col_entry *entry;
+	const struct col_node *node;
+	uint32_t i, j;
+	int k, l;
+
+	fprintf(f, "reporter,peer,sent,ucast_received,mcast_received,ucast_avg_rtt_us,"
+	    "mcast_avg_rtt_us");
+
+	for (k = 0; k < 2; k++) {
+		for (l = 0; l < TLV_RTT_HIST_BUCKETS; l++) {
+			fprintf(f, ",%s_hist_%d", (k == 0 ? "ucast" : "mcast"), l);
+		}
+	}
+	fprintf(f, "\n");
+
+	for (i = 0; i < matrix->no_nodes; i++) {
+		node = &matrix->nodes[i];
+		af_sa_to_str(AF_CAST_SA(&node->addr), rep_str);
+
+		for (j = 0; j < node->row_size; j++) {
+			entry = &node->row[j];
+			if (!entry->isset) {
+				continue;
+			}
+
+			af_sa_to_str(AF_CAST_SA(&matrix->nodes[j].addr), peer_str);
+
+			fprintf(f, "%s,%s,%"PRIu32",%"PRIu32",%"PRIu32",%"PRIu32",%"PRIu32, rep_str,
+			    peer_str, entry->stats.no_sent, entry->stats.no_received[0],
+			    entry->stats.no_received[1], entry->stats.avg_rtt_us[0],
+			    entry->stats.avg_rtt_us[1]);
+
+			for (k = 0; k < 2; k++) {
+				for (l = 0; l < TLV_RTT_HIST_BUCKETS; l++) {
+					fprintf(f, ",%"PRIu16, entry->stats.rtt_hist[k][l]);
+				}
+			}
+			fprintf(f, "\n");
+		}
+	}
+
+	if (fflush(f) != 0 || ferror(f)) {
+		return (-1);
+	}
+
+	return (0);
+}
+
+/*
+ * Free memory allocated by collector matrix.
+ */
+void
+col_matrix_free(struct col_matrix *matrix)
+{
+	uint32_t i;
+
+	for (i = 0; i < matrix->no_nodes; i++) {
+		free(matrix->nodes[i].row);
+		free(matrix->nodes[i].loss_events);
+	}
+
+	free(matrix->nodes);
+	free(matrix->hash_table);
+
+	memset(matrix, 0, sizeof(*matrix));
+}
+
+/*
+ * Find slot of hash table for address addr. Slot (either one containing addr or first empty one)
+ * is stored in slot. Function returns 1 if address was found, otherwise 0.
+ */
+static int
+col_matrix_hash_find(const struct col_matrix *matrix, const struct sockaddr_storage *addr,
+    uint32_t *slot)
+{
+	uint32_t node_id;
+	uint32_t i;
+
+	i = af_sa_hash(AF_CAST_SA(addr)) & (matrix->hash_size - 1);
+
+	while ((node_id = matrix->hash_table[i]) != 0) {
+		if (af_sockaddr_eq(AF_CAST_SA(&matrix->nodes[node_id - 1].addr),
+		    AF_CAST_SA(addr))) {
+			*slot = i;
+
+			return (1);
+		}
+
+		i = (i + 1) & (matrix->hash_size - 1);
+	}
+
+	*slot = i;
+
+	return (0);
+}
+
+/*
+ * Double size of hash table and rehash all nodes.
+ */
+static void
+col_matrix_hash_grow(struct col_matrix *matrix)
+{
+	uint32_t slot;
+	uint32_t i;
+
+	free(matrix->hash_table);
+
+	matrix->hash_size *= 2;
+	matrix->hash_table = (uint32_t *)calloc(matrix->hash_size, sizeof(uint32_t));
+	if (matrix->hash_table == NULL) {
+		errx(1, "Can't alloc memory");
+	}
+
+	for (i = 0; i < matrix->no_nodes; i++) {
+		col_matrix_hash_find(matrix, &matrix->nodes[i].addr, &slot);
+		matrix->hash_table[slot] = i + 1;
+	}
+}
+
+/*
+ * Add loss of multicast packet seq of sender sender_id reported by receiver receiver_id. Older
+ * event occupying same slot of window is classified first.
+ */
+static void
+col_matrix_loss_add(struct col_matrix *matrix, uint32_t sender_id, uint32_t receiver_id,
+    uint32_t seq)
+{
+	struct col_loss_event *event;
+	struct col_node *sender;
+
+	sender = &matrix->nodes[sender_id];
+
+	if (sender->loss_events == NULL) {
+		sender->loss_events = (struct col_loss_event *)calloc(COL_LOSS_WINDOW,
+		    sizeof(struct col_loss_event));
+		if (sender->loss_events == NULL) {
+			errx(1, "Can't alloc memory");
+		}
+	}
+
+	event = &sender->loss_events[seq & (COL_LOSS_WINDOW - 1)];
+
+	if (event->isset && event->seq != seq) {
+		col_matrix_loss_classify(matrix, sender_id, event);
+	}
+
+	if (!event->isset) {
+		event->seq = seq;
+		event->receiver_id = receiver_id;
+		event->no_receivers = 1;
+		event->isset = 1;
+	} else if (event->no_receivers < UINT16_MAX) {
+		event->no_receivers++;
+	}
+}
+
+/*
+ * Classify loss event of sender sender_id (see struct col_node) and remove it from window.
+ */
+static void
+col_matrix_loss_classify(struct col_matrix *matrix, uint32_t sender_id,
+    struct col_loss_event *event)
+{
+	struct col_node *sender;
+	uint32_t covering;
+	int complete;
+
+	sender = &matrix->nodes[sender_id];
+	covering = col_matrix_loss_covering(matrix, sender_id, event->seq, &complete);
+
+	if (event->no_receivers >= 2) {
+		if (event->no_receivers * 2 >= covering) {
+			sender->no_loss_shared++;
+		} else {
+			sender->no_loss_partial++;
+		}
+	} else if (covering >= 2) {
+		matrix->nodes[event->receiver_id].no_loss_edge++;
+	} else {
+		sender->no_loss_unattributed++;
+	}
+
+	event->isset = 0;
+}
+
+/*
+ * Return number of receivers which reported range of multicast sequence numbers of sender_id
+ * containing seq. complete is set to 1 if every receiver of sender already reported range
+ * containing seq (or newer), otherwise 0.
+ */
+static uint32_t
+col_matrix_loss_covering(const struct col_matrix *matrix, uint32_t sender_id, uint32_t seq,
+    int *complete)
+{
+	const struct col_entry *entry;
+	const struct col_node *node;
+	uint32_t covering;
+	uint32_t i;
+
+	covering = 0;
+	*complete = 1;
+
+	for (i = 0; i < matrix->no_nodes; i++) {
+		node = &matrix->nodes[i];
+
+		if (i == sender_id || node->row_size <= sender_id) {
+			continue;
+		}
+
+		entry = &node->row[sender_id];
+		if (!entry->loss_isset) {
+			continue;
+		}
+
+		if ((uint32_t)(seq - entry->loss_first_seq) <
+		    (uint32_t)(entry->loss_end_seq - entry->loss_first_seq)) {
+			covering++;
+		} else if ((int32_t)(entry->loss_end_seq - seq) <= 0) {
+			*complete = 0;
+		}
+	}
+
+	return (covering);
+}
+
+/*
+ * Classify loss events in window of all senders. If force is not set, only events already
+ * reported by all receivers are classified.
+ */
+void
+col_matrix_loss_flush(struct col_matrix *matrix, int force)
+{
+	struct col_loss_event *event;
+	uint32_t i, j;
+	int complete;
+
+	for (i = 0; i < matrix->no_nodes; i++) {
+		if (matrix->nodes[i].loss_events == NULL) {
+			continue;
+		}
+
+		for (j = 0; j < COL_LOSS_WINDOW; j++) {
+			event = &matrix->nodes[i].loss_events[j];
+			if (!event->isset) {
+				continue;
+			}
+
+			if (!force) {
+				col_matrix_loss_covering(matrix, i, event->seq, &complete);
+				if (!complete) {
+					continue;
+				}
+			}
+
+			col_matrix_loss_classify(matrix, i, event);
+		}
+	}
+}
+
+/*
+ * Process loss runs loss_runs of multicast packets of sender sender_id reported by receiver
+ * receiver_id. Covered range of receiver is extended and lost packets are added to window of
+ * sender. Only last COL_LOSS_WINDOW packets of every run are correlated, rest is unattributed.
+ */
+static void
+col_matrix_loss_process(struct col_matrix *matrix, uint32_t receiver_id, uint32_t sender_id,
+    const struct tlv_loss_runs *loss_runs)
+{
+	struct col_entry *entry;
+	struct col_node *sender;
+	uint32_t len;
+	uint32_t seq;
+	int i;
+
+	entry = &matrix->nodes[receiver_id].row[sender_id];
+
+	if (!entry->loss_isset || entry->loss_end_seq != loss_runs->first_seq) {
+		entry->loss_first_seq = loss_runs->first_seq;
+	}
+	entry->loss_end_seq = loss_runs->end_seq;
+	entry->loss_isset = 1;
+
+	sender = &matrix->nodes[sender_id];
+	sender->no_loss_unattributed += loss_runs->no_overflow;
+
+	for (i = 0; i < loss_runs->no_runs; i++) {
+		seq = loss_runs->runs[i].seq;
+		len = loss_runs->runs[i].len;
+
+		if (len > COL_LOSS_WINDOW) {
+			sender->no_loss_unattributed += len - COL_LOSS_WINDOW;
+			seq += len - COL_LOSS_WINDOW;
+			len = COL_LOSS_WINDOW;
+		}
+
+		for (; len > 0; len--, seq++) {
+			col_matrix_loss_add(matrix, sender_id, receiver_id, seq);
+		}
+	}
+}
+
+/*
+ * Return node id of node with address addr (port is ignored). If node doesn't exist, it's
+ * created. Function returns node id, or -1 if matrix is full (COL_MAX_NODES).
+ */
+static int64_t
+col_matrix_node_id(struct col_matrix *matrix, const struct sockaddr_storage *addr)
+{
+	struct sockaddr_storage key;
+	struct col_node *node;
+	uint32_t slot;
+
+	memcpy(&key, addr, sizeof(key));
+	af_sa_set_port(AF_CAST_SA(&key), 0);
+
+	if (col_matrix_hash_find(matrix, &key, &slot)) {
+		return (matrix->hash_table[slot] - 1);
+	}
+
+	if (matrix->no_nodes >= COL_MAX_NODES) {
+		return (-1);
+	}
+
+	if (matrix->no_nodes == matrix->nodes_size) {
+		matrix->nodes_size = (matrix->nodes_size == 0 ? COL_INITIAL_SIZE :
+		    matrix->nodes_size * 2);
+
+		matrix->nodes = (struct col_node *)realloc(matrix->nodes,
+		    sizeof(struct col_node) * matrix->nodes_size);
+		if (matrix->nodes == NULL) {
+			errx(1, "Can't alloc memory");
+		}
+	}
+
+	node = &matrix->nodes[matrix->no_nodes];
+	memset(node, 0, sizeof(*node));
+	memcpy(&node->addr, &key, sizeof(key));
+
+	matrix->hash_table[slot] = ++matrix->no_nodes;
+
+	/*
+	 * Keep load factor under 50 %
+	 */
+	if (matrix->no_nodes * 2 > matrix->hash_size) {
+		col_matrix_hash_grow(matrix);
+	}
+
+	return (matrix->no_nodes - 1);
+}
+
+/*
+ * Process stats report message msg with msg_len length received from address from at time
+ * rp_timestamp. Every peer summary in message updates one cell of row of reporter. Rows are
+ * updated incrementally, so report doesn't need to contain all peers.
+ * Function returns number of processed peer summaries, or -1 if message is malformed.
+ */
+int
+col_matrix_process_report(struct col_matrix *matrix, const char *msg, size_t msg_len,
+    const struct sockaddr_storage *from, struct timeval rp_timestamp)
+{
+	struct tlv_peer_summary peer_summary;
+	struct tlv_loss_runs loss_runs;
+	struct tlv_iterator tlv_iter;
+	struct col_entry *entry;
+	struct col_node *node;
+	int64_t peer_id;
+	int64_t rep_id;
+	uint32_t new_size;
+	int no_processed;
+
+	rep_id = col_matrix_node_id(matrix, from);
+	if (rep_id == -1) {
+		DEBUG_PRINTF("Collector matrix is full. Ignoring report");
+
+		return (0);
+	}
+
+	no_processed = 0;
+
+	tlv_iter_init(msg, msg_len, &tlv_iter);
+
+	peer_id = -1;
+
+	while (tlv_iter_next(&tlv_iter) == 0) {
+		if (tlv_iter_get_type(&tlv_iter) == TLV_OPT_TYPE_LOSS_RUNS) {
+			/*
+			 * Loss runs belongs to preceding peer summary
+			 */
+			if (peer_id == -1 || peer_id == rep_id) {
+				continue;
+			}
+
+			if (tlv_iter_loss_runs(&tlv_iter, &loss_runs) == -1) {
+				matrix->no_bad_reports++;
+
+				return (-1);
+			}
+
+			col_matrix_loss_process(matrix, rep_id, peer_id, &loss_runs);
+			continue;
+		}
+
+		if (tlv_iter_get_type(&tlv_iter) != TLV_OPT_TYPE_PEER_SUMMARY) {
+			continue;
+		}
+
+		if (tlv_iter_peer_summary(&tlv_iter, &peer_summary) == -1) {
+			matrix->no_bad_reports++;
+
+			return (-1);
+		}
+
+		peer_id = col_matrix_node_id(matrix, &peer_summary.addr);
+		if (peer_id == -1) {
+			continue;
+		}
+
+		/*
+		 * nodes array may be reallocated by col_matrix_node_id
+		 */
+		node = &matrix->nodes[rep_id];
+
+		if (peer_id >= node->row_size) {
+			new_size = (node->row_size == 0 ? COL_INITIAL_SIZE : node->row_size);
+			while (new_size <= peer_id) {
+				new_size *= 2;
+			}
+
+			node->row = (struct col_entry *)realloc(node->row,
+			    sizeof(struct col_entry) * new_size);
+			if (node->row == NULL) {
+				errx(1, "Can't alloc memory");
+			}
+
+			memset(node->row + node->row_size, 0,
+			    sizeof(struct col_entry) * (new_size - node->row_size));
+			node->row_size = new_size;
+		}
+
+		entry = &node->row[peer_id];
+		memcpy(&entry->stats, &peer_summary.stats, sizeof(entry->stats));
+		entry->isset = 1;
+
+		no_processed++;
+	}
+
+	node = &matrix->nodes[rep_id];
+	node->last_report_ts = rp_timestamp;
+	node->no_reports++;
+	matrix->no_reports++;
+
+	return (no_processed);
+}
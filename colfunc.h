@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+ * FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Author: agent <agent@local>
+ */
+
+#ifndef _COLFUNC_H_
+#define _COLFUNC_H_
+
+#include <sys/types.h>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "tlv.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Maximum number of nodes in matrix. Peers reported after this limit is reached are ignored, so
+ * memory used by collector is bounded.
+ */
+#define COL_MAX_NODES		16384
+
+/*
+ * Number of multicast sequence numbers of one sender kept for loss correlation (must be power
+ * of two). Loss event is classified when all receivers reported range containing it or when it's
+ * overwritten by event with sequence number COL_LOSS_WINDOW higher.
+ */
+#define COL_LOSS_WINDOW		1024
+
+/*
+ * One cell of matrix. Stats of peer as seen by reporter. loss_first_seq and loss_end_seq is range
+ * of multicast sequence numbers of peer covered by loss reports of reporter.
+ */
+struct col_entry {
+	struct tlv_peer_stats	stats;
+	uint32_t		loss_end_seq;
+	uint32_t		loss_first_seq;
+	uint8_t			isset;
+	uint8_t			loss_isset;
+};
+
+/*
+ * Multicast packet of sender (seq) lost by no_receivers receivers. receiver_id is id of first
+ * receiver which reported loss.
+ */
+struct col_loss_event {
+	uint32_t		receiver_id;
+	uint32_t		seq;
+	uint16_t		no_receivers;
+	uint8_t			isset;
+};
+
+/*
+ * Node of matrix. Node is identified by address (without port) and it's both reporter (row)
+ * and peer (column). Row is indexed by node id of peer and grows on demand. loss_events is window
+ * of not yet classified multicast loss events of node as sender (allocated on first loss).
+ * Multicast packet lost by majority of receivers is counted in no_loss_shared of sender, packet
+ * lost by two or more receivers but minority in no_loss_partial of sender and packet lost by only
+ * one of more receivers in no_loss_edge of receiver. Loss which can't be classified (only one
+ * receiver, or too many lost packets) is counted in no_loss_unattributed of sender.
+ */
+struct col_node {
+	struct sockaddr_storage	addr;
+	struct timeval		last_report_ts;
+	struct col_entry	*row;
+	struct col_loss_event	*loss_events;
+	uint64_t		no_loss_edge;
+	uint64_t		no_loss_partial;
+	uint64_t		no_loss_shared;
+	uint64_t		no_loss_unattributed;
+	uint64_t		no_reports;
+	uint32_t		row_size;
+};
+
+/*
+ * Collector N x N matrix. Nodes are stored in array indexed by node id. Hash table (open
+ * addressing, size is power of two) maps node address to node id + 1 (0 is empty slot).
+ */
+struct col_matrix {
+	struct col_node		*nodes;
+	uint32_t		*hash_table;
+	uint64_t		no_bad_reports;
+	uint64_t		no_reports;
+	uint32_t		hash_size;
+	uint32_t		no_nodes;
+	uint32_t		nodes_size;
+};
+
+extern void	col_matrix_create(struct col_matrix *matrix);
+
+extern int	col_matrix_export(const struct col_matrix *matrix, FILE *f);
+
+extern void	col_matrix_free(struct col_matrix *matrix);
+
+extern void	col_matrix_loss_flush(struct col_matrix *matrix, int force);
+
+extern int	col_matrix_process_report(struct col_matrix *matrix, const char *msg,
+    size_t msg_len, const struct sockaddr_storage *from, struct timeval rp_timestamp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _COLFUNC_H_ */
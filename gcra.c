@@ -28,11 +28,32 @@
 #include "util.h"
 
 /*
- * item is gcra_item to be initialized. Interval is interval in ms in which packet
+ * Test if packet arriving at time now (in ns) is conforming to item.
+ * Returns 0 if packet is non conforming, otherwise 1. Item is not changed.
+ */
+static int
+gcra_conforms(const struct gcra_item *item, uint64_t now)
+{
+
+	return (!(item->tat >= item->tau && now < item->tat - item->tau));
+}
+
+/*
+ * Update theoretical arrival time of item by conforming packet arriving at time now (in ns).
+ */
+static void
+gcra_update(struct gcra_item *item, uint64_t now)
+{
+
+	item->tat = ((now > item->tat) ? now : item->tat) + item->interval;
+}
+
+/*
+ * item is gcra_item to be initialized. Interval is interval in ns in which packet
  * will arrive (max), and burst is number of packets which may arrive sooner.
  */
 void
-gcra_init(struct gcra_item *item, unsigned int interval, unsigned int burst)
+gcra_init(struct gcra_item *item, uint64_t interval, unsigned int burst)
 {
 
 	memset(item, 0, sizeof(*item));
@@ -49,15 +70,44 @@ gcra_init(struct gcra_item *item, unsigned int interval, unsigned int burst)
 int
 gcra_rl(struct gcra_item *item, struct timeval tv)
 {
-	uint64_t tv_u64;
+	uint64_t now;
 
-	tv_u64 = util_tv_to_ms(tv);
+	now = util_tv_to_ns(tv);
 
-	if (item->tat >= item->tau && tv_u64 < item->tat - item->tau) {
+	if (!gcra_conforms(item, now)) {
 		return (0);
-	} else {
-		item->tat = ((tv_u64 > item->tat) ? tv_u64 : item->tat) + item->interval;
+	}
+
+	gcra_update(item, now);
 
-		return (1);
+	return (1);
+}
+
+/*
+ * Hierarchical rate limit. item is gcra item of one flow, aggr is gcra item shared by all flows
+ * and tv is time of packet arrival. Packet is conforming only if it conforms to both items and
+ * only conforming packet updates them, so packets limited by one level don't consume capacity
+ * of other level.
+ * Returns 1 if packet is conforming, 0 if packet is non conforming to item and -1 if packet is
+ * conforming to item but non conforming to aggr.
+ */
+int
+gcra_rl_hier(struct gcra_item *item, struct gcra_item *aggr, struct timeval tv)
+{
+	uint64_t now;
+
+	now = util_tv_to_ns(tv);
+
+	if (!gcra_conforms(item, now)) {
+		return (0);
+	}
+
+	if (!gcra_conforms(aggr, now)) {
+		return (-1);
 	}
+
+	gcra_update(item, now);
+	gcra_update(aggr, now);
+
+	return (1);
 }
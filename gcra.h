@@ -29,19 +29,22 @@ extern "C" {
  * Structures definition
  */
 struct gcra_item {
+	uint64_t interval;
 	uint64_t tat;
-	unsigned int interval;
-	unsigned int tau;
+	uint64_t tau;
 };
 
 /*
  * Prototypes
  */
-extern void		gcra_init(struct gcra_item *item, unsigned int interval,
+extern void		gcra_init(struct gcra_item *item, uint64_t interval,
     unsigned int burst);
 
 extern int		gcra_rl(struct gcra_item *item, struct timeval tv);
 
+extern int		gcra_rl_hier(struct gcra_item *item, struct gcra_item *aggr,
+    struct timeval tv);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+ * FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Author: agent <agent@local>
+ */
+
+#include <sys/types.h>
+
+#include <inttypes.h>
+#include <string.h>
+
+#include "lbfunc.h"
+
+static void	lb_add_lost(struct lb_item *lb, uint32_t seq, uint32_t count);
+
+static void	lb_reset(struct lb_item *lb, uint32_t seq);
+
+/*
+ * Add count lost packets starting with seq to pending runs of lb. Packets which don't fit into
+ * runs are counted in no_overflow.
+ */
+static void
+lb_add_lost(struct lb_item *lb, uint32_t seq, uint32_t count)
+{
+	struct tlv_loss_run *run;
+	uint32_t len;
+
+	lb->no_lost += count;
+
+	while (count > 0) {
+		run = NULL;
+
+		if (lb->pending.no_runs > 0) {
+			run = &lb->pending.runs[lb->pending.no_runs - 1];
+
+			if (run->seq + run->len != seq || run->len == UINT16_MAX) {
+				run = NULL;
+			}
+		}
+
+		if (run == NULL) {
+			if (lb->pending.no_runs >= TLV_LOSS_MAX_RUNS) {
+				if ((uint32_t)lb->pending.no_overflow + count > UINT16_MAX) {
+					lb->pending.no_overflow = UINT16_MAX;
+				} else {
+					lb->pending.no_overflow += count;
+				}
+
+				return ;
+			}
+
+			run = &lb->pending.runs[lb->pending.no_runs++];
+			run->seq = seq;
+			run->len = 0;
+		}
+
+		len = UINT16_MAX - run->len;
+		if (len > count) {
+			len = count;
+		}
+
+		run->len += len;
+		seq += len;
+		count -= len;
+	}
+}
+
+/*
+ * Mark pending range of lb as reported. Next report starts with first not finalized packet.
+ */
+void
+lb_reported(struct lb_item *lb)
+{
+
+	lb->pending.first_seq = lb->pending.end_seq;
+	lb->pending.no_runs = 0;
+	lb->pending.no_overflow = 0;
+}
+
+/*
+ * Restart tracking of lb with first received packet seq. Pending (not reported) data are
+ * discarded.
+ */
+static void
+lb_reset(struct lb_item *lb, uint32_t seq)
+{
+
+	memset(&lb->pending, 0, sizeof(lb->pending));
+	lb->pending.first_seq = lb->pending.end_seq = seq;
+	lb->max_seq = seq;
+	lb->window = 1;
+	lb->isset = 1;
+}
+
+/*
+ * Update loss bitmap lb with received packet with sequence number seq. Packets falling out of
+ * window are finalized and lost ones are added to pending runs.
+ */
+void
+lb_update(struct lb_item *lb, uint32_t seq)
+{
+	uint32_t diff;
+	uint32_t new_end;
+
+	if (!lb->isset) {
+		lb_reset(lb, seq);
+
+		return ;
+	}
+
+	diff = seq - lb->max_seq;
+
+	if ((int32_t)diff <= 0) {
+		diff = lb->max_seq - seq;
+
+		if (diff < LB_WINDOW) {
+			/*
+			 * Reordered (or duplicate) packet still in window
+			 */
+			lb->window |= ((uint64_t)1 << diff);
+		} else if (diff > LB_MAX_JUMP) {
+			lb_reset(lb, seq);
+		}
+
+		return ;
+	}
+
+	if (diff > LB_MAX_JUMP) {
+		lb_reset(lb, seq);
+
+		return ;
+	}
+
+	/*
+	 * Finalize packets which are going to fall out of window
+	 */
+	new_end = seq - (LB_WINDOW - 1);
+
+	while ((int32_t)(new_end - lb->pending.end_seq) > 0) {
+		if ((int32_t)(lb->pending.end_seq - lb->max_seq) > 0) {
+			/*
+			 * Rest of packets (bigger then max_seq) were never received
+			 */
+			lb_add_lost(lb, lb->pending.end_seq, new_end - lb->pending.end_seq);
+			lb->pending.end_seq = new_end;
+			break;
+		}
+
+		if (!(lb->window & ((uint64_t)1 << (lb->max_seq - lb->pending.end_seq)))) {
+			lb_add_lost(lb, lb->pending.end_seq, 1);
+		}
+
+		lb->pending.end_seq++;
+	}
+
+	if (diff >= LB_WINDOW) {
+		lb->window = 1;
+	} else {
+		lb->window = (lb->window << diff) | 1;
+	}
+
+	lb->max_seq = seq;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+ * FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Author: agent <agent@local>
+ */
+
+#ifndef _LBFUNC_H_
+#define _LBFUNC_H_
+
+#include <sys/types.h>
+
+#include <inttypes.h>
+
+#include "tlv.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Size of receive window in packets. Packet is finalized (and counted as lost if not received)
+ * when packet with sequence number LB_WINDOW higher is received, so this is also maximum
+ * tolerated reordering.
+ */
+#define LB_WINDOW		64
+
+/*
+ * Sequence number jump (in any direction) after which tracking is restarted (sender restart)
+ */
+#define LB_MAX_JUMP		65536
+
+/*
+ * Loss bitmap of one sender. window bit i is set if packet max_seq - i was received. pending
+ * contains finalized range (first_seq is first not reported sequence number and end_seq is first
+ * not finalized) with runs of lost packets.
+ */
+struct lb_item {
+	struct tlv_loss_runs	pending;
+	uint64_t		no_lost;
+	uint64_t		window;
+	uint32_t		max_seq;
+	int			isset;
+};
+
+extern void	lb_reported(struct lb_item *lb);
+
+extern void	lb_update(struct lb_item *lb, uint32_t seq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LBFUNC_H_ */
@@ -32,17 +32,24 @@
  * Create answer message from query message. orig_msg is pointer to buffer with query message
  * with orig_msg_len length (only used bytes, not buffer size). new_msg is pointer to buffer where
  * to store result message. new_msg_len is size of buffer. ttl is value of TTL option. server_tstamp
- * is boolean variable and if set, server timestamp option is added to message.
+ * is boolean variable and if set, server timestamp option is added to message. throttled is number
+ * of queries from client which were not answered because of rate limit and throttled_seq is
+ * sequence number of last such query. If throttled is 0, Throttled option is not added.
+ * server_stats is pointer to server side statistics of client to add or NULL. mcast_seq is
+ * multicast sequence number of sender. If mcast_seq is 0, Multicast Sequence Number option is not
+ * added.
  *
  * All options from original messages are copied without changing order. Only exceptions are Server
- * Info, Multicast Prefix, Session ID, TTL and Server Timestamp, which are not copied.
+ * Info, Multicast Prefix, Session ID, TTL, Server Timestamp, Throttled, Server Statistics and
+ * Multicast Sequence Number, which are not copied.
  *
  * Returned value is size of new message or 0 on fail (mostly because msg_len
  * is smaller then needed). If success, new message is always at least 1 bytes long.
  */
 size_t
 msg_answer_create(const char *orig_msg, size_t orig_msg_len, char *new_msg, size_t new_msg_len,
-    uint8_t ttl, int server_tstamp)
+    uint8_t ttl, int server_tstamp, uint32_t throttled, uint32_t throttled_seq,
+    const struct tlv_server_stats *server_stats, uint32_t mcast_seq)
 {
 	struct tlv_iterator tlv_iter;
 	enum tlv_opt_type opt_type;
@@ -61,7 +68,10 @@ msg_answer_create(const char *orig_msg, size_t orig_msg_len, char *new_msg, size
 		    opt_type != TLV_OPT_TYPE_MCAST_PREFIX &&
 		    opt_type != TLV_OPT_TYPE_SES_ID &&
 		    opt_type != TLV_OPT_TYPE_TTL &&
-		    opt_type != TLV_OPT_TYPE_SERVER_TSTAMP) {
+		    opt_type != TLV_OPT_TYPE_SERVER_TSTAMP &&
+		    opt_type != TLV_OPT_TYPE_THROTTLED &&
+		    opt_type != TLV_OPT_TYPE_SERVER_STATS &&
+		    opt_type != TLV_OPT_TYPE_MCAST_SEQ) {
 			tlv_iter_item_copy(&tlv_iter, new_msg, new_msg_len, &pos);
 		}
 	}
@@ -74,6 +84,21 @@ msg_answer_create(const char *orig_msg, size_t orig_msg_len, char *new_msg, size
 			goto small_buf_err;
 	}
 
+	if (throttled > 0) {
+		if (tlv_add_throttled(new_msg, new_msg_len, &pos, throttled, throttled_seq) == -1)
+			goto small_buf_err;
+	}
+
+	if (server_stats != NULL) {
+		if (tlv_add_server_stats(new_msg, new_msg_len, &pos, server_stats) == -1)
+			goto small_buf_err;
+	}
+
+	if (mcast_seq != 0) {
+		if (tlv_add_mcast_seq(new_msg, new_msg_len, &pos, mcast_seq) == -1)
+			goto small_buf_err;
+	}
+
 	return (pos);
 
 small_buf_err:
@@ -89,6 +114,7 @@ msg_decode(const char *msg, size_t msg_len, struct msg_decoded *decoded)
 	char debug_str[128];
 	struct tlv_iterator tlv_iter;
 	size_t pos;
+	uint32_t ss_u32[5];
 	uint32_t u32, u32_2;
 	uint16_t tlv_len;
 	uint16_t u16;
@@ -231,6 +257,30 @@ msg_decode(const char *msg, size_t msg_len, struct msg_decoded *decoded)
 				DEBUG2_PRINTF("%slen != 1", debug_str);
 			}
 			break;
+		case TLV_OPT_TYPE_TRAFFIC_CLASS:
+			if (tlv_len == 1) {
+				memcpy(&u8, tlv_iter_get_data(&tlv_iter), sizeof(u8));
+
+				decoded->traffic_class = u8;
+				decoded->traffic_class_isset = 1;
+
+				DEBUG2_PRINTF("%s%u", debug_str, u8);
+			} else {
+				DEBUG2_PRINTF("%slen != 1", debug_str);
+			}
+			break;
+		case TLV_OPT_TYPE_PROFILE:
+			if (tlv_len >= 1) {
+				memcpy(&u8, tlv_iter_get_data(&tlv_iter), sizeof(u8));
+
+				decoded->profile = u8;
+				decoded->profile_isset = 1;
+
+				DEBUG2_PRINTF("%s%u", debug_str, u8);
+			} else {
+				DEBUG2_PRINTF("%slen < 1", debug_str);
+			}
+			break;
 		case TLV_OPT_TYPE_MCAST_PREFIX:
 			if (tlv_len > 2) {
 				memcpy(&u16, tlv_iter_get_data(&tlv_iter), sizeof(u16));
@@ -275,6 +325,57 @@ msg_decode(const char *msg, size_t msg_len, struct msg_decoded *decoded)
 				DEBUG2_PRINTF("%slen != 8", debug_str);
 			}
 			break;
+		case TLV_OPT_TYPE_MCAST_SEQ:
+			if (tlv_len == 4) {
+				memcpy(&u32, tlv_iter_get_data(&tlv_iter), sizeof(u32));
+				u32 = ntohl(u32);
+				decoded->mcast_seq = u32;
+				decoded->mcast_seq_isset = 1;
+
+				DEBUG2_PRINTF("%s%u", debug_str, u32);
+			} else {
+				DEBUG2_PRINTF("%slen != 4", debug_str);
+			}
+			break;
+		case TLV_OPT_TYPE_THROTTLED:
+			if (tlv_len == 8) {
+				memcpy(&u32, tlv_iter_get_data(&tlv_iter), sizeof(u32));
+				u32 = ntohl(u32);
+				decoded->throttled = u32;
+
+				memcpy(&u32_2, tlv_iter_get_data(&tlv_iter) + sizeof(u32),
+				    sizeof(u32_2));
+				u32_2 = ntohl(u32_2);
+				decoded->throttled_seq = u32_2;
+
+				decoded->throttled_isset = 1;
+
+				DEBUG2_PRINTF("%s%u (last seq %u)", debug_str, u32, u32_2);
+			} else {
+				DEBUG2_PRINTF("%slen != 8", debug_str);
+			}
+			break;
+		case TLV_OPT_TYPE_SERVER_STATS:
+			if (tlv_len == 5 * sizeof(uint32_t)) {
+				for (pos = 0; pos < 5; pos++) {
+					memcpy(&u32, tlv_iter_get_data(&tlv_iter) +
+					    pos * sizeof(u32), sizeof(u32));
+					ss_u32[pos] = ntohl(u32);
+				}
+
+				decoded->server_stats.no_received = ss_u32[0];
+				decoded->server_stats.no_answered = ss_u32[1];
+				decoded->server_stats.first_seq = ss_u32[2];
+				decoded->server_stats.max_seq = ss_u32[3];
+				decoded->server_stats.jitter_us = ss_u32[4];
+				decoded->server_stats_isset = 1;
+
+				DEBUG2_PRINTF("%s%u/%u (%u-%u) %u", debug_str, ss_u32[0],
+				    ss_u32[1], ss_u32[2], ss_u32[3], ss_u32[4]);
+			} else {
+				DEBUG2_PRINTF("%slen != 20", debug_str);
+			}
+			break;
 		default:
 			DEBUG2_PRINTF("%s", debug_str);
 			break;
@@ -360,7 +461,11 @@ small_buf_err:
  * Create query message. msg is pointer to buffer where to store result message. msg_len is size
  * of buffer. mcast_addr is required multicast group address. server_tstamp is boolean to decide if
  * to include Option request option with server time stamp. client_id is Client ID with length
- * client_id_len. session_id with session_id_len is similar, but for Session ID.
+ * client_id_len. session_id with session_id_len is similar, but for Session ID. traffic_class is
+ * traffic class requested for answers or -1 if Traffic Class option is not added. profile is
+ * number of test profile of query or -1 if Profile option is not added. Profile option is padded,
+ * so message has at least size bytes. client_tstamp is client time stamp to store in message or
+ * NULL for actual time.
  *
  * Returned value is size of new message or 0 on fail (mostly because msg_len
  * is smaller then needed). If success, new message is always at least 1 bytes long.
@@ -368,8 +473,10 @@ small_buf_err:
 size_t
 msg_query_create(char *msg, size_t msg_len, const struct sockaddr_storage *mcast_addr,
     uint32_t seq_num, int server_tstamp, const char *client_id, size_t client_id_len,
-    const char *session_id, size_t session_id_len)
+    const char *session_id, size_t session_id_len, int traffic_class, int profile, size_t size,
+    const struct timeval *client_tstamp)
 {
+	size_t pad_len;
 	size_t pos;
 	uint16_t u16;
 
@@ -390,7 +497,7 @@ msg_query_create(char *msg, size_t msg_len, const struct sockaddr_storage *mcast
 	if (tlv_add_seq_num(msg, msg_len, &pos, seq_num) == -1)
 		goto small_buf_err;
 
-	if (tlv_add_client_tstamp(msg, msg_len, &pos) == -1)
+	if (tlv_add_client_tstamp(msg, msg_len, &pos, client_tstamp) == -1)
 		goto small_buf_err;
 
 	if (tlv_add_mcast_grp(msg, msg_len, &pos, mcast_addr) == -1)
@@ -406,6 +513,71 @@ msg_query_create(char *msg, size_t msg_len, const struct sockaddr_storage *mcast
 	if (tlv_add(msg, msg_len, &pos, TLV_OPT_TYPE_SES_ID, session_id_len, session_id) == -1)
 		goto small_buf_err;
 
+	if (traffic_class >= 0) {
+		if (tlv_add_traffic_class(msg, msg_len, &pos, (uint8_t)traffic_class) == -1)
+			goto small_buf_err;
+	}
+
+	if (profile >= 0) {
+		/*
+		 * Profile option has 4 bytes of header and 1 byte of profile number
+		 */
+		pad_len = (size > pos + 5 ? size - pos - 5 : 0);
+
+		if (tlv_add_profile(msg, msg_len, &pos, (uint8_t)profile, pad_len) == -1)
+			goto small_buf_err;
+	}
+
+	return (pos);
+
+small_buf_err:
+	return (0);
+}
+
+/*
+ * Create stats report message. msg is pointer to buffer where to store result message. msg_len is
+ * size of buffer and it also limits size of report. peer_summaries is array of no_peer_summaries
+ * summaries to add. Summaries (together with loss runs if set) are added in order until message
+ * is full. Number of added summaries
+ * is stored in no_added.
+ *
+ * Returned value is size of new message or 0 on fail (mostly because msg_len
+ * is smaller then needed). If success, new message is always at least 1 bytes long.
+ */
+size_t
+msg_report_create(char *msg, size_t msg_len, const struct tlv_peer_summary *peer_summaries,
+    size_t no_peer_summaries, size_t *no_added)
+{
+	size_t old_pos;
+	size_t pos;
+	size_t i;
+
+	pos = 0;
+	*no_added = 0;
+
+	msg[pos++] = (unsigned char)MSG_TYPE_REPORT;
+
+	if (tlv_add_version(msg, msg_len, &pos) == -1)
+		goto small_buf_err;
+
+	for (i = 0; i < no_peer_summaries; i++) {
+		old_pos = pos;
+
+		if (tlv_add_peer_summary(msg, msg_len, &pos, &peer_summaries[i]) == -1)
+			break;
+
+		/*
+		 * Loss runs always follows peer summary it belongs to
+		 */
+		if (peer_summaries[i].loss_isset &&
+		    tlv_add_loss_runs(msg, msg_len, &pos, &peer_summaries[i].loss) == -1) {
+			pos = old_pos;
+			break;
+		}
+
+		(*no_added)++;
+	}
+
 	return (pos);
 
 small_buf_err:
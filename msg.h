@@ -26,6 +26,8 @@
 #include <sys/socket.h>
 #include <sys/time.h>
 
+#include "tlv.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -37,34 +39,47 @@ enum msg_type {
 	MSG_TYPE_RESPONSE	= 'S',
 	MSG_TYPE_QUERY		= 'Q',
 	MSG_TYPE_ANSWER		= 'A',
+	MSG_TYPE_REPORT		= 'R',
 };
 
 struct msg_decoded {
 	struct timeval	 client_tstamp;
 	struct timeval	 server_tstamp;
+	struct tlv_server_stats server_stats;
 	enum msg_type	 msg_type;
 	size_t		 client_id_len;
 	size_t		 mcast_grp_len;
 	size_t		 opt_request_len;
 	size_t		 server_info_len;
 	size_t		 ses_id_len;
+	uint32_t	 mcast_seq;
 	uint32_t	 seq_num;
+	uint32_t	 throttled;
+	uint32_t	 throttled_seq;
 	int		 client_tstamp_isset;
 	int		 mcast_prefix_isset;
+	int		 mcast_seq_isset;
+	int		 profile_isset;
 	int		 request_opt_server_info;
 	int		 request_opt_server_tstamp;
 	int		 seq_num_isset;
+	int		 server_stats_isset;
 	int		 server_tstamp_isset;
+	int		 throttled_isset;
+	int		 traffic_class_isset;
 	const char	*client_id;
 	const char	*mcast_grp;
 	const char	*server_info;
 	const char	*ses_id;
+	uint8_t		 profile;
+	uint8_t		 traffic_class;
 	uint8_t		 ttl;
 	uint8_t		 version;
 };
 
 extern size_t	msg_answer_create(const char *orig_msg, size_t orig_msg_len, char *new_msg,
-    size_t new_msg_len, uint8_t ttl, int server_tstamp);
+    size_t new_msg_len, uint8_t ttl, int server_tstamp, uint32_t throttled,
+    uint32_t throttled_seq, const struct tlv_server_stats *server_stats, uint32_t mcast_seq);
 
 extern void	msg_decode(const char *msg, size_t msg_len, struct msg_decoded *decoded);
 
@@ -76,7 +91,11 @@ extern size_t	msg_init_create(char *msg, size_t msg_len, int req_si,
 
 extern size_t	msg_query_create(char *msg, size_t msg_len,
     const struct sockaddr_storage *mcast_addr, uint32_t seq_num, int server_tstamp,
-    const char *client_id, size_t client_id_len, const char *session_id, size_t session_id_len);
+    const char *client_id, size_t client_id_len, const char *session_id, size_t session_id_len,
+    int traffic_class, int profile, size_t size, const struct timeval *client_tstamp);
+
+extern size_t	msg_report_create(char *msg, size_t msg_len,
+    const struct tlv_peer_summary *peer_summaries, size_t no_peer_summaries, size_t *no_added);
 
 extern size_t	msg_response_create(char *msg, size_t msg_len,
     const struct msg_decoded *msg_decoded, int mcast_grp, int mcast_prefix,
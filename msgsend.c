@@ -40,39 +40,42 @@
  * Send answer message. ucast_socket is socket used to send message, mcast_addr is used multicast
  * address, orig_msg is received query message with orig_msg_len, decoded is decoded message,
  * to is sockaddr_storage address of destination, ttl is set TTL and answer_type can specify what
- * type of response to send.
+ * type of response to send. throttled, throttled_seq, server_stats and mcast_seq are passed to
+ * msg_answer_create. If query contains Traffic Class option, answers are sent with that traffic
+ * class. Both answers are sent by one rs_send_msgs call.
  * Function returns 0 on sucess, otherwise same error as rs_sendto or -4 if message cannot be
  * created (usually due to small message buffer)
  */
 int
 ms_answer(int ucast_socket, const struct sockaddr_storage *mcast_addr, const char *orig_msg,
     size_t orig_msg_len, const struct msg_decoded *decoded, const struct sockaddr_storage *to,
-    uint8_t ttl, enum ms_answer_type answer_type)
+    uint8_t ttl, enum ms_answer_type answer_type, uint32_t throttled, uint32_t throttled_seq,
+    const struct tlv_server_stats *server_stats, uint32_t mcast_seq)
 {
 	char addr_str[INET6_ADDRSTRLEN];
 	char new_msg[MAX_MSG_SIZE];
+	struct rs_send_msg send_msgs[2];
 	struct sockaddr_storage to_mcast;
 	size_t new_msg_len;
-	ssize_t sent;
+	int i;
+	int no_msgs;
+	int sent;
 
 	new_msg_len = msg_answer_create(orig_msg, orig_msg_len, new_msg, sizeof(new_msg),
-	    ttl, decoded->request_opt_server_tstamp);
+	    ttl, decoded->request_opt_server_tstamp, throttled, throttled_seq, server_stats,
+	    mcast_seq);
 
 	if (new_msg_len == 0) {
 		return (-4);
 	}
 
+	no_msgs = 0;
+
 	if (answer_type == MS_ANSWER_UCAST || answer_type == MS_ANSWER_BOTH) {
 		af_sa_to_str(AF_CAST_SA(to), addr_str);
 		DEBUG_PRINTF("Sending unicast answer msg to %s", addr_str);
 
-		msg_update_server_tstamp(new_msg, new_msg_len);
-
-		sent = rs_sendto(ucast_socket, new_msg, new_msg_len, to);
-
-		if (sent < 0) {
-			return (sent);
-		}
+		send_msgs[no_msgs++].to = to;
 	}
 
 	if (answer_type == MS_ANSWER_MCAST || answer_type == MS_ANSWER_BOTH) {
@@ -81,13 +84,25 @@ ms_answer(int ucast_socket, const struct sockaddr_storage *mcast_addr, const cha
 		af_sa_to_str(AF_CAST_SA(&to_mcast), addr_str);
 		DEBUG_PRINTF("Sending multicast answer msg to %s", addr_str);
 
-		msg_update_server_tstamp(new_msg, new_msg_len);
+		send_msgs[no_msgs++].to = &to_mcast;
+	}
 
-		sent = rs_sendto(ucast_socket, new_msg, new_msg_len, &to_mcast);
+	for (i = 0; i < no_msgs; i++) {
+		send_msgs[i].msg = new_msg;
+		send_msgs[i].msg_len = new_msg_len;
+		send_msgs[i].tclass = (decoded->traffic_class_isset ? decoded->traffic_class : -1);
+		send_msgs[i].txtime = 0;
+	}
+
+	/*
+	 * Unicast and multicast answer are same message, so both are sent by one batch
+	 */
+	msg_update_server_tstamp(new_msg, new_msg_len);
 
-		if (sent < 0) {
-			return (sent);
-		}
+	sent = rs_send_msgs(ucast_socket, send_msgs, no_msgs);
+
+	if (sent < 0) {
+		return (sent);
 	}
 
 	return (0);
@@ -127,14 +142,20 @@ ms_init(int ucast_socket, const struct sockaddr_storage *remote_addr,
  * Send query message. ucast_socket is socket used to send message, remote_addr is address of host
  * to send message, mcast_addr is used multicast address, client_id is client id string with
  * CLIENTID_LEN length, ses_id is Session ID string with ses_id_len length. seq_num is sequential
- * number to set in packet.
+ * number to set in packet. traffic_class is traffic class requested for answers or -1. profile is
+ * number of test profile of query (or -1) and size is minimal size of query of profile. Socket is
+ * shared by all profiles, so query of profile is sent with its traffic class passed as ancillary
+ * data (see rs_sendto_tclass). tstamp is client time stamp stored in message (NULL for actual
+ * time) and txtime is departure time passed to rs_sendto_txtime (0 if message is sent
+ * immediately).
  * Function returns 0 on success, otherwise same error as rs_sendto or -4 if message cannot be
  * created (usually due to small message buffer)
  */
 int
 ms_query(int ucast_socket, const struct sockaddr_storage *remote_addr,
     const struct sockaddr_storage *mcast_addr, uint32_t seq_num, const char *client_id,
-    const char *ses_id, size_t ses_id_len)
+    const char *ses_id, size_t ses_id_len, int traffic_class, int profile, size_t size,
+    const struct timeval *tstamp, uint64_t txtime)
 {
 	char addr_str[INET6_ADDRSTRLEN];
 	char msg[MAX_MSG_SIZE];
@@ -145,13 +166,52 @@ ms_query(int ucast_socket, const struct sockaddr_storage *remote_addr,
 	DEBUG_PRINTF("Sending query msg to %s", addr_str);
 
 	msg_len = msg_query_create(msg, sizeof(msg), mcast_addr, seq_num, 0, client_id,
-	    CLIENTID_LEN, ses_id, SESSIONID_LEN);
+	    CLIENTID_LEN, ses_id, SESSIONID_LEN, traffic_class, profile, size, tstamp);
 
 	if (msg_len == 0) {
 		return (-4);
 	}
 
-	sent = rs_sendto(ucast_socket, msg, msg_len, remote_addr);
+	if (profile >= 0) {
+		sent = rs_sendto_tclass(ucast_socket, msg, msg_len, remote_addr, traffic_class);
+	} else {
+		sent = rs_sendto_txtime(ucast_socket, msg, msg_len, remote_addr, txtime);
+	}
+
+	return (sent);
+}
+
+/*
+ * Send stats report message. ucast_socket is socket used to send message, to is address of
+ * collector. peer_summaries is array of no_peer_summaries summaries to send and max_size is
+ * maximum size of message. Number of summaries which fit into message is stored in no_added.
+ * Function returns 0 on success, otherwise same error as rs_sendto or -4 if message cannot be
+ * created (usually due to small message buffer)
+ */
+int
+ms_report(int ucast_socket, const struct sockaddr_storage *to,
+    const struct tlv_peer_summary *peer_summaries, size_t no_peer_summaries, size_t max_size,
+    size_t *no_added)
+{
+	char addr_str[INET6_ADDRSTRLEN];
+	char msg[MAX_MSG_SIZE];
+	size_t msg_len;
+	ssize_t sent;
+
+	af_sa_to_str(AF_CAST_SA(to), addr_str);
+	DEBUG_PRINTF("Sending report msg to %s", addr_str);
+
+	if (max_size > sizeof(msg)) {
+		max_size = sizeof(msg);
+	}
+
+	msg_len = msg_report_create(msg, max_size, peer_summaries, no_peer_summaries, no_added);
+
+	if (msg_len == 0) {
+		return (-4);
+	}
+
+	sent = rs_sendto(ucast_socket, msg, msg_len, to);
 
 	return (sent);
 }
@@ -24,6 +24,7 @@
 #include <sys/types.h>
 
 #include <sys/socket.h>
+#include <sys/time.h>
 
 #include <net/if.h>
 #include <netinet/in.h>
@@ -41,14 +42,21 @@ enum ms_answer_type {
 
 extern int	ms_answer(int ucast_socket, const struct sockaddr_storage *mcast_addr,
     const char *orig_msg, size_t orig_msg_len, const struct msg_decoded *decoded,
-    const struct sockaddr_storage *to, uint8_t ttl, enum ms_answer_type answer_type);
+    const struct sockaddr_storage *to, uint8_t ttl, enum ms_answer_type answer_type,
+    uint32_t throttled, uint32_t throttled_seq, const struct tlv_server_stats *server_stats,
+    uint32_t mcast_seq);
 
 extern int	ms_init(int ucast_socket, const struct sockaddr_storage *remote_addr,
     const struct sockaddr_storage *mcast_addr, const char *client_id, int req_si);
 
 extern int	ms_query(int ucast_socket, const struct sockaddr_storage *remote_addr,
     const struct sockaddr_storage *mcast_addr, uint32_t seq_num, const char *client_id,
-    const char *ses_id, size_t ses_id_len);
+    const char *ses_id, size_t ses_id_len, int traffic_class, int profile, size_t size,
+    const struct timeval *tstamp, uint64_t txtime);
+
+extern int	ms_report(int ucast_socket, const struct sockaddr_storage *to,
+    const struct tlv_peer_summary *peer_summaries, size_t no_peer_summaries, size_t max_size,
+    size_t *no_added);
 
 extern int	ms_response(int ucast_socket, const struct sockaddr_storage *mcast_addr,
     const struct msg_decoded *decoded, const struct sockaddr_storage *to, int mcast_grp,
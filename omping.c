@@ -20,11 +20,18 @@
 
 #include <sys/types.h>
 
+#include <sys/resource.h>
+
 #include <inttypes.h>
 #include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "addrfunc.h"
 #include "aiifunc.h"
@@ -32,12 +39,15 @@
 #include "cliprint.h"
 #include "clisig.h"
 #include "clistate.h"
+#include "colfunc.h"
 #include "logging.h"
 #include "msg.h"
 #include "msgsend.h"
 #include "omping.h"
 #include "rhfunc.h"
+#include "ringfunc.h"
 #include "rsfunc.h"
+#include "sfset.h"
 #include "sockfunc.h"
 #include "tlv.h"
 #include "util.h"
@@ -50,15 +60,31 @@ static int	omping_check_msg_common(const struct msg_decoded *msg_decoded);
 static void	omping_client_move_to_stop(struct omping_instance *instance,
     struct rh_item *ri, enum rh_client_stop_reason stop_reason);
 
+static int	omping_client_send_res_process(struct rh_item_ci *ci, int send_res);
+
+static int	omping_client_unreach_remaining(const struct rh_item_ci *ci,
+    struct timeval cur_time);
+
+static void	omping_collector_print(struct omping_instance *instance, int final);
+
+static void	omping_eff_apply(struct omping_instance *instance);
+
 static void	omping_instance_create(struct omping_instance *instance, int argc,
     char *argv[]);
 
 static void	omping_instance_free(struct omping_instance *instance);
 
+static void	omping_mp_sockets_create(struct omping_instance *instance);
+
+static void	omping_pacer_apply(struct omping_instance *instance);
+
+static void	omping_pacer_enqueue(struct omping_instance *instance, struct rh_item *ri,
+    struct timeval cur_time);
+
 static int	omping_poll_receive_loop(struct omping_instance *instance, int timeout_time);
 
 static int	omping_poll_timeout(struct omping_instance *instance, struct timeval *old_tstamp,
-    int timeout_time);
+    int timeout_time, int max_poll_timeout, int *sock_events);
 
 static int	omping_process_msg(struct omping_instance *instance, const char *msg,
     size_t msg_len, const struct sockaddr_storage *from, uint8_t ttl, enum sf_cast_type cast_type,
@@ -68,6 +94,11 @@ static int	omping_process_answer_msg(struct omping_instance *instance, const cha
     size_t msg_len, const struct msg_decoded *msg_decoded, const struct sockaddr_storage *from,
     uint8_t ttl, enum sf_cast_type cast_type, struct timeval rp_timestamp);
 
+static void	omping_process_answer_rec(struct omping_instance *instance,
+    const struct omping_answer_rec *rec);
+
+static int	omping_process_err_queue(struct omping_instance *instance, int sock);
+
 static int	omping_process_init_msg(struct omping_instance *instance, const char *msg,
     size_t msg_len, const struct msg_decoded *msg_decoded, const struct sockaddr_storage *from,
     struct timeval rp_timestamp);
@@ -76,17 +107,74 @@ static int	omping_process_query_msg(struct omping_instance *instance, const char
     size_t msg_len, const struct msg_decoded *msg_decoded, const struct sockaddr_storage *from,
     struct timeval rp_timestamp);
 
+static int	omping_process_received_msg(struct omping_instance *instance, int sock_index,
+    const char *msg, size_t msg_len, const struct sockaddr_storage *from, uint8_t ttl,
+    struct timeval rp_timestamp);
+
 static int	omping_process_response_msg(struct omping_instance *instance, const char *msg,
     size_t msg_len, const struct msg_decoded *msg_decoded, const struct sockaddr_storage *from);
 
+static int	omping_receive_msgs(struct omping_instance *instance, int sock_index);
+
+static void	omping_recv_msgs_alloc(struct omping_instance *instance);
+
+static void	omping_remote_version_print(struct omping_instance *instance);
+
+static int	omping_report_send(struct omping_instance *instance);
+
+static void	omping_report_snapshot(struct omping_instance *instance);
+
+static void	omping_rt_apply(struct omping_instance *instance);
+
 static int	omping_send_client_query(struct omping_instance *instance, struct rh_item *ri,
-    int increase);
+    int increase, const struct timeval *tstamp, uint64_t txtime);
+
+static int	omping_send_client_init(struct omping_instance *instance, struct rh_item *ri,
+    struct timeval cur_time);
+
+static int	omping_send_client_inits(struct omping_instance *instance, int *next_timeout);
 
 static int	omping_send_client_msgs(struct omping_instance *instance);
 
+static int	omping_send_client_paced(struct omping_instance *instance, struct timeval cur_time,
+    int *next_timeout);
+
+static int	omping_send_client_sched(struct omping_instance *instance, struct rh_item *ri,
+    struct timeval cur_time, uint64_t now_ns);
+
+static int	omping_send_profile_query(struct omping_instance *instance, struct rh_item *ri,
+    int profile);
+
+static int	omping_send_profiles(struct omping_instance *instance, struct timeval cur_time,
+    int *next_timeout);
+
 static void	omping_send_receive_loop(struct omping_instance *instance, int timeout_time,
     int final_stats, int allow_auto_exit);
 
+static int	omping_send_report(struct omping_instance *instance);
+
+static int	omping_send_scan_inits(struct omping_instance *instance, int *next_timeout);
+
+static int	omping_send_stop(struct omping_instance *instance,
+    const struct msg_decoded *msg_decoded, const struct sockaddr_storage *from,
+    struct timeval rp_timestamp);
+
+static struct rh_item_si	*omping_si_find(struct omping_instance *instance,
+    const struct sockaddr_storage *sas);
+
+static struct omping_stack	*omping_stack_by_addr(struct omping_instance *instance,
+    const struct sockaddr_storage *sas);
+
+static void	omping_stats_sync(struct omping_instance *instance);
+
+static void	*omping_stats_thread(void *arg);
+
+static void	omping_stats_thread_start(struct omping_instance *instance);
+
+static void	omping_stats_thread_stop(struct omping_instance *instance);
+
+static void	omping_txtime_apply(struct omping_instance *instance);
+
 /*
  * Functions implementation
  */
@@ -98,6 +186,7 @@ int
 main(int argc, char *argv[])
 {
 	struct omping_instance instance;
+	struct rusage rusage;
 	int allow_auto_exit;
 	int final_stats;
 	int wait_for_finish_time;
@@ -106,7 +195,12 @@ main(int argc, char *argv[])
 
 	clisig_register_handlers();
 
-	if (instance.op_mode == OMPING_OP_MODE_SERVER) {
+	if (instance.op_mode == OMPING_OP_MODE_SERVER && instance.quiet < 2) {
+		cliprint_si_table_mem(&instance.si_table);
+	}
+
+	if (instance.op_mode == OMPING_OP_MODE_SERVER ||
+	    instance.op_mode == OMPING_OP_MODE_COLLECTOR) {
 		final_stats = allow_auto_exit = 0;
 	} else {
 		final_stats = allow_auto_exit = 1;
@@ -114,12 +208,17 @@ main(int argc, char *argv[])
 
 	omping_send_receive_loop(&instance, instance.timeout_time, final_stats, allow_auto_exit);
 
-	if (!instance.single_addr && instance.wait_for_finish_time != 0 &&
-	    instance.op_mode != OMPING_OP_MODE_CLIENT) {
+	/*
+	 * Scan mode answers other nodes by stop message during whole scan, so it doesn't wait
+	 */
+	if (!instance.stacks[0].single_addr && instance.wait_for_finish_time != 0 &&
+	    instance.op_mode != OMPING_OP_MODE_CLIENT &&
+	    instance.op_mode != OMPING_OP_MODE_COLLECTOR && instance.scan_concurrency == 0) {
 		clistate_cancel_exit();
 
 		DEBUG_PRINTF("Moving all clients to stop state and server to finishing state");
 		rh_list_put_to_finish_state(&instance.remote_hosts, RH_LFS_BOTH);
+		rh_si_table_put_to_finish_state(&instance.si_table);
 
 		if (instance.wait_for_finish_time == -1) {
 			wait_for_finish_time = 0;
@@ -133,6 +232,49 @@ main(int argc, char *argv[])
 		omping_send_receive_loop(&instance, wait_for_finish_time, 0, 0);
 	}
 
+	if (instance.op_mode == OMPING_OP_MODE_COLLECTOR) {
+		omping_collector_print(&instance, 1);
+	}
+
+	if (instance.quiet < 2 && instance.stop_rl.no_limited > 0) {
+		cliprint_stop_rl_stats(&instance.stop_rl);
+	}
+
+	if (instance.quiet < 2 && (instance.no_client_rl > 0 || instance.no_aggr_rl > 0)) {
+		cliprint_answer_rl_stats(instance.no_client_rl, instance.no_aggr_rl);
+	}
+
+	if (instance.quiet < 2 && instance.rt_opts.enabled) {
+		cliprint_rt_stats(&instance.rt_stats);
+	}
+
+	if (instance.quiet < 2 && instance.efficient) {
+		if (getrusage(RUSAGE_SELF, &rusage) == -1) {
+			err(1, "Can't get resource usage");
+		}
+
+		cliprint_eff_stats(instance.no_wakeups,
+		    util_time_double_absdiff(instance.start_ts, util_get_time()),
+		    rusage.ru_utime.tv_sec * 1000.0 + rusage.ru_utime.tv_usec / 1000.0,
+		    rusage.ru_stime.tv_sec * 1000.0 + rusage.ru_stime.tv_usec / 1000.0);
+	}
+
+	if (instance.quiet < 2 && instance.stats_thread) {
+		cliprint_stats_ring(&instance.stats_ring);
+	}
+
+	if (instance.quiet < 2 && instance.backend_stats) {
+		cliprint_backend_stats(rs_backend_name(), instance.backend_no_msgs,
+		    util_time_double_absdiff(instance.backend_first_ts, instance.backend_last_ts));
+	}
+
+	if (instance.quiet < 2 && instance.pacer_rate > 0) {
+		cliprint_pacer_stats(instance.pacer.no_bytes,
+		    util_time_double_absdiff(instance.start_ts, util_get_time()),
+		    instance.no_pacer_deferred, instance.pacer_delay_sum, instance.pacer_delay_max,
+		    instance.no_pacer_skipped);
+	}
+
 	omping_instance_free(&instance);
 
 	return 0;
@@ -145,7 +287,8 @@ static int
 omping_check_msg_common(const struct msg_decoded *msg_decoded)
 {
 	if (msg_decoded->msg_type != MSG_TYPE_INIT && msg_decoded->msg_type != MSG_TYPE_RESPONSE &&
-	    msg_decoded->msg_type != MSG_TYPE_QUERY && msg_decoded->msg_type != MSG_TYPE_ANSWER) {
+	    msg_decoded->msg_type != MSG_TYPE_QUERY && msg_decoded->msg_type != MSG_TYPE_ANSWER &&
+	    msg_decoded->msg_type != MSG_TYPE_REPORT) {
 		DEBUG_PRINTF("Unknown type %c (0x%X) of message", msg_decoded->msg_type,
 		    msg_decoded->msg_type);
 
@@ -173,10 +316,131 @@ omping_client_move_to_stop(struct omping_instance *instance, struct rh_item *ri,
 	instance->rh_no_active--;
 
 	if (instance->quiet < 2) {
-		cliprint_client_state(ri->addr->host_name, instance->hn_max_len,
-		    instance->transport_method, NULL, &ri->addr->sas,
-		    RH_CS_STOP, stop_reason);
+		if (instance->scan_concurrency > 0 &&
+		    (stop_reason == RH_CSR_REMOTE_VERSION_RECEIVED ||
+		    stop_reason == RH_CSR_NO_RESPONSE)) {
+			/*
+			 * Scan mode streams result of every host as soon as it's known
+			 */
+			cliprint_remote_version(ri->addr->host_name, instance->hn_max_len,
+			    ri->client_info.server_info, ri->client_info.server_info_len);
+		} else {
+			cliprint_client_state(ri->addr->host_name, instance->hn_max_len,
+			    instance->transport_method, NULL, &ri->addr->sas,
+			    RH_CS_STOP, stop_reason, -1);
+		}
+	}
+}
+
+/*
+ * Process result of sending of client message. ci is client info of remote host to which message
+ * was sent and send_res is value returned by one of ms_* functions.
+ * Function returns 0 on success, or -2 on EINTR.
+ */
+static int
+omping_client_send_res_process(struct rh_item_ci *ci, int send_res)
+{
+
+	switch (send_res) {
+	case -1:
+		err(2, "Cannot send message");
+		/* NOTREACHED */
+		break;
+	case -2:
+		return (-2);
+		/* NOTREACHED */
+		break;
+	case -3:
+		warn("Send message error");
+		ci->no_err_msgs++;
+		break;
+	case -4:
+		DEBUG_PRINTF("Cannot send message. Buffer too small");
+		break;
+	}
+
+	return (0);
+}
+
+/*
+ * Return remaining time of unreachable backoff of client. ci is client info of remote host and
+ * cur_time is current time.
+ * Function returns number of ms until next message can be sent to remote host, or 0 if remote
+ * host is not backed off.
+ */
+static int
+omping_client_unreach_remaining(const struct rh_item_ci *ci, struct timeval cur_time)
+{
+	uint64_t elapsed;
+
+	if (ci->unreach_backoff == 0) {
+		return (0);
+	}
+
+	elapsed = util_time_absdiff(ci->unreach_ts, cur_time);
+	if (elapsed >= (uint64_t)ci->unreach_backoff) {
+		return (0);
+	}
+
+	return (ci->unreach_backoff - elapsed);
+}
+
+/*
+ * Print collector matrix (unless quiet mode is high enough) and export it to export file (if set).
+ * instance is omping instance in collector mode. final is boolean flag set on exit. If set, all
+ * pending multicast loss events are classified, otherwise only ones reported by all receivers.
+ */
+static void
+omping_collector_print(struct omping_instance *instance, int final)
+{
+	FILE *f;
+
+	col_matrix_loss_flush(&instance->collector, final);
+
+	if (instance->quiet < 2) {
+		cliprint_collector_matrix(&instance->collector);
+	}
+
+	if (instance->export_file != NULL) {
+		f = fopen(instance->export_file, "w");
+		if (f == NULL) {
+			warn("Can't open export file %s", instance->export_file);
+
+			return ;
+		}
+
+		if (col_matrix_export(&instance->collector, f) == -1) {
+			warn("Can't export matrix to %s", instance->export_file);
+		}
+
+		fclose(f);
+	}
+}
+
+/*
+ * Apply efficiency mode settings. Timer slack is set (if supported), so kernel can coalesce
+ * wakeups of omping with wakeups of other processes.
+ */
+static void
+omping_eff_apply(struct omping_instance *instance)
+{
+	uint64_t slack;
+
+	slack = (uint64_t)(instance->wait_time * UTIL_NSINMS / EFF_TIMER_SLACK_DIV);
+	if (slack < EFF_MIN_TIMER_SLACK) {
+		slack = EFF_MIN_TIMER_SLACK;
+	}
+
+	if (rt_set_timer_slack(slack) == -1) {
+		/*
+		 * Timer slack is only tuning, so efficiency mode continues without it
+		 */
+		warn("Can't set timer slack");
+
+		return ;
 	}
+
+	VERBOSE_PRINTF("Timer slack set to %"PRIu64" ns", slack);
 }
 
 /*
@@ -186,58 +450,201 @@ omping_client_move_to_stop(struct omping_instance *instance, struct rh_item *ri,
 static void
 omping_instance_create(struct omping_instance *instance, int argc, char *argv[])
 {
+	struct ai_item *addr;
+	struct omping_stack *stack;
+	const char *backend_name;
+	size_t no_remote_addrs;
 	uint16_t bind_port;
+	int i;
 
-	bind_port = 0;
 	memset(instance, 0, sizeof(struct omping_instance));
 
 	cli_parse(argc, argv, instance);
 
-	rh_list_create(&instance->remote_hosts, &instance->remote_addrs, instance->dup_buf_items,
-	    instance->rate_limit_time);
+	/*
+	 * One list of remote hosts is shared by all stacks. State of all remote hosts is allocated
+	 * from one arena sized to hold every remote host. Hot statistics are stored in separate
+	 * array indexed by id of remote host. Server op_mode (which has only one stack) doesn't
+	 * need client part of state, so only compact server info table is created and list stays
+	 * empty.
+	 */
+	no_remote_addrs = 0;
+	for (i = 0; i < instance->no_stacks; i++) {
+		TAILQ_FOREACH(addr, &instance->stacks[i].remote_addrs, entries) {
+			no_remote_addrs++;
+		}
+	}
+
+	rh_list_create(&instance->remote_hosts, &instance->rh_arena, NULL, NULL,
+	    instance->dup_buf_items);
+
+	if (instance->op_mode == OMPING_OP_MODE_SERVER) {
+		ar_arena_create(&instance->rh_arena, rh_si_table_alloc_size(no_remote_addrs,
+		    instance->stacks[0].local_addr.sas.ss_family));
+
+		rh_si_table_create(&instance->si_table, &instance->rh_arena,
+		    &instance->stacks[0].remote_addrs);
+
+		/*
+		 * Server info table holds addresses of all clients and server never needs names
+		 * of clients, so list of addresses is no longer needed.
+		 */
+		aii_list_free(&instance->stacks[0].remote_addrs);
+
+		instance->rh_no_active = instance->si_table.no_items;
+	} else {
+		ar_arena_create(&instance->rh_arena,
+		    no_remote_addrs * rh_item_alloc_size(instance->dup_buf_items));
+
+		instance->cast_stats = rh_list_alloc_cast_stats(&instance->rh_arena,
+		    no_remote_addrs);
+		if (instance->cast_stats == NULL) {
+			errx(1, "Can't alloc memory");
+		}
+
+		for (i = 0; i < instance->no_stacks; i++) {
+			TAILQ_FOREACH(addr, &instance->stacks[i].remote_addrs, entries) {
+				if (rh_list_add_item(&instance->remote_hosts, &instance->rh_arena,
+				    instance->cast_stats, addr, instance->dup_buf_items) == NULL) {
+					errx(1, "Can't alloc memory");
+				}
+			}
+		}
+
+		instance->rh_no_active = rh_list_length(&instance->remote_hosts);
+	}
+
+	/*
+	 * Rate limit parameters are shared by all clients. Server info of client stores only
+	 * theoretical arrival time.
+	 */
+	if (instance->rate_limit_time > 0) {
+		gcra_init(&instance->client_rl, instance->rate_limit_time,
+		    instance->rate_limit_burst);
+	}
+
+	if (instance->rate_limit_aggr_time > 0) {
+		/*
+		 * Aggregate burst must allow every client to use its own burst at once
+		 */
+		gcra_init(&instance->aggr_rl, instance->rate_limit_aggr_time,
+		    instance->rate_limit_burst * instance->rh_no_active);
+	}
 
-	instance->rh_no_active = rh_list_length(&instance->remote_hosts);
+	rl_table_create(&instance->stop_rl, STOP_RL_TABLE_SIZE, STOP_RL_INTERVAL * UTIL_NSINMS,
+	    STOP_RL_BURST, STOP_RL_AGGR_INTERVAL * UTIL_NSINMS, STOP_RL_AGGR_BURST);
 
-	instance->ucast_socket =
-	    sf_create_unicast_socket(AF_CAST_SA(&instance->local_addr.sas), instance->ttl, 1,
-	    instance->single_addr, instance->local_ifname, instance->transport_method, 1, 0,
-	    instance->sndbuf_size, instance->rcvbuf_size,
-	    (instance->op_mode == OMPING_OP_MODE_CLIENT ? &bind_port : NULL));
+	for (i = 0; i < instance->no_stacks; i++) {
+		stack = &instance->stacks[i];
+		bind_port = 0;
 
-	if (instance->ucast_socket == -1) {
-		err(1, "Can't create/bind unicast socket");
+		stack->ucast_socket =
+		    sf_create_unicast_socket(AF_CAST_SA(&stack->local_addr.sas), instance->ttl, 1,
+		    stack->single_addr, stack->local_ifname, instance->transport_method, 1, 0,
+		    instance->sndbuf_size, instance->rcvbuf_size,
+		    (instance->op_mode == OMPING_OP_MODE_CLIENT ? &bind_port : NULL));
+
+		if (stack->ucast_socket == -1) {
+			err(1, "Can't create/bind unicast socket");
+		}
+
+		switch (instance->op_mode) {
+		case OMPING_OP_MODE_SERVER:
+		case OMPING_OP_MODE_COLLECTOR:
+		case OMPING_OP_MODE_SHOW_VERSION:
+			stack->mcast_socket = -1;
+			break;
+		case OMPING_OP_MODE_CLIENT:
+		case OMPING_OP_MODE_NORMAL:
+			stack->mcast_socket =
+			    sf_create_multicast_socket((struct sockaddr *)&stack->mcast_addr.sas,
+				AF_CAST_SA(&stack->local_addr.sas), stack->local_ifname,
+				instance->ttl, stack->single_addr, instance->transport_method,
+				&stack->remote_addrs, 1, 0, instance->sndbuf_size,
+				instance->rcvbuf_size,
+				(instance->op_mode == OMPING_OP_MODE_CLIENT ? bind_port : 0));
+
+			if (stack->mcast_socket == -1) {
+				err(1, "Can't create/bind multicast socket");
+			}
+			break;
+		}
 	}
 
 	switch (instance->op_mode) {
 	case OMPING_OP_MODE_SERVER:
-		instance->mcast_socket = -1;
 		rh_list_put_to_finish_state(&instance->remote_hosts, RH_LFS_CLIENT);
 		break;
-	case OMPING_OP_MODE_SHOW_VERSION:
-		rh_list_put_to_finish_state(&instance->remote_hosts, RH_LFS_SERVER);
+	case OMPING_OP_MODE_COLLECTOR:
+		rh_list_put_to_finish_state(&instance->remote_hosts, RH_LFS_BOTH);
+		col_matrix_create(&instance->collector);
 		break;
+	case OMPING_OP_MODE_SHOW_VERSION:
 	case OMPING_OP_MODE_CLIENT:
 		rh_list_put_to_finish_state(&instance->remote_hosts, RH_LFS_SERVER);
+		break;
 	case OMPING_OP_MODE_NORMAL:
-		instance->mcast_socket =
-		    sf_create_multicast_socket((struct sockaddr *)&instance->mcast_addr.sas,
-			AF_CAST_SA(&instance->local_addr.sas), instance->local_ifname,
-			instance->ttl, instance->single_addr, instance->transport_method,
-			&instance->remote_addrs, 1, 0, instance->sndbuf_size,
-			instance->rcvbuf_size,
-			(instance->op_mode == OMPING_OP_MODE_CLIENT ? bind_port : 0));
+		break;
+	}
+
+	omping_mp_sockets_create(instance);
 
-		if (instance->mcast_socket == -1) {
-			err(1, "Can't create/bind multicast socket");
+	if (instance->no_profiles > 0) {
+		if (rh_list_alloc_profiles(&instance->remote_hosts, &instance->rh_arena,
+		    instance->no_profiles) == -1) {
+			errx(1, "Can't alloc memory");
 		}
+	}
+
+	if (instance->txtime_clock != -1) {
+		omping_txtime_apply(instance);
+	}
+
+	if (instance->pacer_rate > 0) {
+		omping_pacer_apply(instance);
+	}
+
+	backend_name = rs_backend_name();
+
+	switch (rs_backend_open(instance->poll_socks, instance->no_poll_socks)) {
+	case -1:
+		err(1, "Can't open %s transport backend", rs_backend_name());
+		/* NOTREACHED */
+		break;
+	case 1:
+		warn("Can't open %s transport backend, using %s backend", backend_name,
+		    rs_backend_name());
 		break;
 	}
 
-	util_random_init(&instance->local_addr.sas);
+	VERBOSE_PRINTF("Transport backend %s, receive timestamps from %s", rs_backend_name(),
+	    rs_backend_ts_source());
 
-	rh_list_gen_cid(&instance->remote_hosts, &instance->local_addr);
+	omping_recv_msgs_alloc(instance);
+
+	util_random_init(&instance->stacks[0].local_addr.sas);
+
+	rh_list_gen_cid(&instance->remote_hosts, &instance->stacks[0].local_addr);
 
 	instance->hn_max_len = rh_list_hn_max_len(&instance->remote_hosts);
+
+	if (instance->efficient) {
+		omping_eff_apply(instance);
+	}
+
+	if (instance->stats_thread) {
+		omping_stats_thread_start(instance);
+	}
+
+	if (instance->rt_opts.enabled) {
+		omping_rt_apply(instance);
+	}
+
+	instance->start_ts = util_get_time();
+
+	for (i = 0; i < instance->no_profiles; i++) {
+		prof_init(&instance->profiles[i], util_tv_to_ms(instance->start_ts));
+	}
 }
 
 /*
@@ -246,134 +653,329 @@ omping_instance_create(struct omping_instance *instance, int argc, char *argv[])
 static void
 omping_instance_free(struct omping_instance *instance)
 {
-	aii_list_free(&instance->remote_addrs);
-	rh_list_free(&instance->remote_hosts);
+	struct omping_stack *stack;
+	int i;
 
-	free(instance->local_addr.host_name);
-	free(instance->mcast_addr.host_name);
-	free(instance->local_ifname);
+	if (instance->stats_thread) {
+		omping_stats_thread_stop(instance);
+	}
+
+	rh_list_free(&instance->remote_hosts, &instance->rh_arena);
+	rl_table_free(&instance->stop_rl);
+
+	if (instance->op_mode == OMPING_OP_MODE_COLLECTOR) {
+		col_matrix_free(&instance->collector);
+	}
+
+	for (i = 0; i < instance->no_stacks; i++) {
+		stack = &instance->stacks[i];
+
+		aii_list_free(&stack->remote_addrs);
+		free(stack->flow_socks);
+		free(stack->local_addr.host_name);
+		free(stack->mcast_addr.host_name);
+		free(stack->local_ifname);
+	}
+
+	rs_backend_close();
+
+	free(instance->recv_msgs[0].msg);
+	free(instance->recv_msgs);
+
+	free(instance->poll_socks);
+	free(instance->collector_addr.host_name);
 }
 
 /*
- * Loop for receiving messages for given time (instance->wait_time) and process them. Instance is
- * omping instance. timeout_time is maximum time to wait.
- * Function returns 0 on success, or -2 on EINTR.
+ * Create array of sockets to poll on. Every stack adds its unicast and multicast socket. In
+ * multipath mode (instance->mp_flows > 1), every flow (except first one, which uses main unicast
+ * socket) adds pair of unicast socket bound to random port (so queries sent by it have different
+ * source port and may be hashed to different ECMP path) and multicast socket bound to same port
+ * (so multicast answers of flow are received). With traffic classes (instance->no_tclasses > 0),
+ * every class is flow with its own pair of sockets (also first one) and traffic class is set on
+ * unicast socket. Unicast socket of every flow is also stored in stack flow_socks.
+ * Sockets are shared by all remote hosts, so number of sockets doesn't depend on number of
+ * remote hosts. Socket with even index in instance->poll_socks is always unicast socket and
+ * socket with odd index is always multicast socket.
  */
-static int
-omping_poll_receive_loop(struct omping_instance *instance, int timeout_time)
+static void
+omping_mp_sockets_create(struct omping_instance *instance)
 {
-	char msg[MAX_MSG_SIZE];
-	struct sockaddr_storage from;
-	struct timeval old_tstamp;
-	struct timeval rp_timestamp;
-	enum sf_cast_type cast_type;
-	int i;
-	int poll_res;
-	int receive_res;
-	uint8_t ttl;
-	int res;
+	struct omping_stack *stack;
+	uint16_t bind_port;
+	int first_new;
+	int i, j;
+	int no_flows;
+	int sock_i;
 
-	memset(&old_tstamp, 0, sizeof(old_tstamp));
+	no_flows = (instance->mp_flows > 1 ? instance->mp_flows : 1);
+	first_new = (instance->no_tclasses > 0 ? 0 : 1);
 
-	do {
-		poll_res = omping_poll_timeout(instance, &old_tstamp, timeout_time);
-		if (poll_res == -2) {
-			return (-2);
-			/* NOTREACHED */
+	instance->no_poll_socks = instance->no_stacks * 2 * (1 + no_flows - first_new);
+	instance->poll_socks = (int *)malloc(sizeof(int) * instance->no_poll_socks);
+	if (instance->poll_socks == NULL) {
+		errx(1, "Can't alloc memory");
+	}
+
+	sock_i = 0;
+
+	for (j = 0; j < instance->no_stacks; j++) {
+		stack = &instance->stacks[j];
+
+		stack->flow_socks = (int *)malloc(sizeof(int) * no_flows);
+		if (stack->flow_socks == NULL) {
+			errx(1, "Can't alloc memory");
 		}
 
-		for (i = 0; i < 2; i++) {
-			receive_res = 0;
+		instance->poll_socks[sock_i++] = stack->ucast_socket;
+		instance->poll_socks[sock_i++] = stack->mcast_socket;
+		stack->flow_socks[0] = stack->ucast_socket;
 
-			if (i == 0 && poll_res & 1) {
-				receive_res = rs_receive_msg(instance->ucast_socket, &from, msg,
-				    sizeof(msg), &ttl, &rp_timestamp);
-			}
+		for (i = first_new; i < no_flows; i++) {
+			bind_port = 0;
 
-			if (i == 1 && poll_res & 2) {
-				receive_res = rs_receive_msg(instance->mcast_socket, &from, msg,
-				    sizeof(msg), &ttl, &rp_timestamp);
-			}
+			stack->flow_socks[i] =
+			    sf_create_unicast_socket(AF_CAST_SA(&stack->local_addr.sas),
+			    instance->ttl, 1, stack->single_addr, stack->local_ifname,
+			    instance->transport_method, 1, 0, instance->sndbuf_size,
+			    instance->rcvbuf_size, &bind_port);
 
-			switch (receive_res) {
-			case -1:
-				err(2, "Cannot receive message");
-				/* NOTREACHED */
-				break;
-			case -2:
-				return (-2);
-				/* NOTREACHED */
-				break;
-			case -3:
-				warn("Cannot receive message");
-				break;
-			case -4:
-				VERBOSE_PRINTF("Received message too long");
-				break;
+			if (stack->flow_socks[i] == -1) {
+				err(1, "Can't create/bind unicast socket");
 			}
 
-			if (receive_res > 0) {
-				if (i == 0) {
-					cast_type = SF_CT_UNI;
-				} else {
-					switch (instance->transport_method) {
-					case SF_TM_ASM:
-					case SF_TM_SSM:
-						cast_type = SF_CT_MULTI;
-						break;
-					case SF_TM_IPBC:
-						cast_type = SF_CT_BROAD;
-						break;
-					default:
-						DEBUG_PRINTF("Internal error - unknown tm");
-						errx(1, "Internal error - unknown tm");
-						/* NOTREACHED */
-					}
+			if (instance->no_tclasses > 0) {
+				if (sfset_tclass(AF_CAST_SA(&stack->local_addr.sas),
+				    stack->flow_socks[i], instance->tclasses[i]) == -1) {
+					err(1, "Can't set traffic class %d", instance->tclasses[i]);
 				}
+			}
 
-				res = omping_process_msg(instance, msg, receive_res, &from, ttl,
-				    cast_type, rp_timestamp);
+			instance->poll_socks[sock_i++] = stack->flow_socks[i];
 
-				if (res == -2) {
-					return (-2);
-				}
+			instance->poll_socks[sock_i] =
+			    sf_create_multicast_socket((struct sockaddr *)&stack->mcast_addr.sas,
+				AF_CAST_SA(&stack->local_addr.sas), stack->local_ifname,
+				instance->ttl, stack->single_addr, instance->transport_method,
+				&stack->remote_addrs, 1, 0, instance->sndbuf_size,
+				instance->rcvbuf_size, bind_port);
+
+			if (instance->poll_socks[sock_i++] == -1) {
+				err(1, "Can't create/bind multicast socket");
 			}
+
+			VERBOSE_PRINTF("IPv%d flow %d uses source port %u", stack->ip_ver, i,
+			    ntohs(bind_port));
 		}
-	} while (poll_res > 0);
+	}
 
-	return (0);
+	if (no_flows > 1) {
+		if (rh_list_alloc_flows(&instance->remote_hosts, &instance->rh_arena, no_flows,
+		    (instance->no_tclasses > 0 ? instance->tclasses : NULL)) == -1) {
+			errx(1, "Can't alloc memory");
+		}
+	}
 }
 
 /*
- * Wait for messages on sockets. instance is omping_instance and old_tstamp is temporary variable
- * which must be set to zero on first call. Function handles EINTR for display statistics.
- * Function is wrapper on top of rs_poll_timeout, but handles -1 error code. Other return values
- * have same meaning. timeout_time is maximum time to wait
+ * Enable egress pacing. All sent messages are charged to token bucket of instance (see
+ * rs_pacer_set) and queries wait for its tokens in queues of remote hosts (see
+ * omping_send_client_paced), so total output of omping doesn't exceed instance->pacer_rate.
+ * Maximum pacing rate is also set to all sockets if supported, so kernel (with fq qdisc) spreads
+ * packets of every socket in time.
  */
-static int
-omping_poll_timeout(struct omping_instance *instance, struct timeval *old_tstamp, int timeout_time)
+static void
+omping_pacer_apply(struct omping_instance *instance)
 {
-	int poll_res;
+	uint64_t burst;
+	int i;
 
-	do {
-		poll_res = rs_poll_timeout(instance->ucast_socket, instance->mcast_socket,
-		    timeout_time, old_tstamp);
+	burst = instance->pacer_rate * PACER_BURST_TIME / 1000000000;
+	if (burst < PACER_MIN_BURST) {
+		burst = PACER_MIN_BURST;
+	}
 
-		switch (poll_res) {
-		case -1:
-			err(2, "Cannot poll on sockets");
-			/* NOTREACHED */
+	pace_init(&instance->pacer, instance->pacer_rate, burst);
+	rs_pacer_set(&instance->pacer);
+
+	for (i = 0; i < instance->no_poll_socks; i++) {
+		if (instance->poll_socks[i] < 0) {
+			continue;
+		}
+
+		if (sfset_max_pacing_rate(instance->poll_socks[i], instance->pacer_rate) == -1) {
+			if (errno != ENOTSUP) {
+				err(1, "Can't set maximum pacing rate of socket");
+			}
+
+			VERBOSE_PRINTF("SO_MAX_PACING_RATE is not supported, only user space "
+			    "pacing is used");
+			break;
+		}
+	}
+
+	VERBOSE_PRINTF("Egress pacing to %.3f Mbit/s (burst %"PRIu64" bytes) enabled",
+	    instance->pacer_rate * 8 / 1000000.0, burst);
+}
+
+/*
+ * Put query round (one query of every traffic class) of remote host ri to its egress pacer queue.
+ * instance is omping instance and cur_time is current time. Round is queued once per interval, so
+ * only time of oldest round is stored. If queue is full, oldest round is skipped, so queue always
+ * contains freshest rounds.
+ */
+static void
+omping_pacer_enqueue(struct omping_instance *instance, struct rh_item *ri, struct timeval cur_time)
+{
+	struct rh_item_ci *ci;
+
+	ci = &ri->client_info;
+
+	if (ci->pacer_pending >= PACER_MAX_PENDING) {
+		ci->pacer_ts = util_ns_to_tv(util_tv_to_ns(ci->pacer_ts) +
+		    (uint64_t)instance->wait_time * 1000000);
+		instance->no_pacer_skipped++;
+
+		return ;
+	}
+
+	if (ci->pacer_pending == 0) {
+		ci->pacer_ts = cur_time;
+	}
+
+	ci->pacer_pending++;
+	instance->no_pacer_pending++;
+}
+
+/*
+ * Loop for receiving messages for given time (instance->wait_time) and process them. Instance is
+ * omping instance. timeout_time is maximum time to wait.
+ * Function returns 0 on success, or -2 on EINTR.
+ */
+static int
+omping_poll_receive_loop(struct omping_instance *instance, int timeout_time)
+{
+	struct timeval old_tstamp;
+	int sock_events[RS_MAX_POLL_SOCKS];
+	int i;
+	int max_poll_timeout;
+	int poll_res;
+
+	memset(&old_tstamp, 0, sizeof(old_tstamp));
+
+	do {
+		max_poll_timeout = -1;
+
+		if (instance->scan_concurrency > 0) {
+			if (omping_send_scan_inits(instance, &max_poll_timeout) == -2) {
+				return (-2);
+			}
+
+			if (instance->rh_no_active == 0) {
+				/*
+				 * Every host is scanned. Don't wait for rest of interval.
+				 */
+				return (0);
+			}
+		} else if (instance->fast_start) {
+			if (omping_send_client_inits(instance, &max_poll_timeout) == -2) {
+				return (-2);
+			}
+		}
+
+		if (instance->no_pacer_pending > 0) {
+			if (omping_send_client_paced(instance, util_get_time(),
+			    &max_poll_timeout) == -2) {
+				return (-2);
+			}
+		}
+
+		if (instance->no_profiles > 0) {
+			if (omping_send_profiles(instance, util_get_time(),
+			    &max_poll_timeout) == -2) {
+				return (-2);
+			}
+		}
+
+		poll_res = omping_poll_timeout(instance, &old_tstamp, timeout_time,
+		    max_poll_timeout, sock_events);
+		if (poll_res == -2) {
+			return (-2);
+			/* NOTREACHED */
+		}
+
+		if (poll_res == -3) {
+			/*
+			 * Only max_poll_timeout expired. Continue with sending of init messages.
+			 */
+			continue;
+		}
+
+		/*
+		 * Sockets with even index are unicast, sockets with odd index are multicast
+		 */
+		for (i = 0; i < instance->no_poll_socks && poll_res > 0; i++) {
+			if (sock_events[i] & RS_EV_ERR) {
+				if (omping_process_err_queue(instance,
+				    instance->poll_socks[i]) == -2) {
+					return (-2);
+				}
+			}
+
+			if (sock_events[i] & RS_EV_READ) {
+				if (omping_receive_msgs(instance, i) == -2) {
+					return (-2);
+				}
+			}
+		}
+	} while (poll_res > 0 || poll_res == -3);
+
+	return (0);
+}
+
+/*
+ * Wait for messages on sockets. instance is omping_instance and old_tstamp is temporary variable
+ * which must be set to zero on first call. Function handles EINTR for display statistics.
+ * Function is wrapper on top of rs_poll_timeout, but handles -1 error code. Other return values
+ * have same meaning. timeout_time is maximum time to wait and max_poll_timeout is maximum time
+ * of one wait (or -1 for no limit). sock_events is filled by events of instance->poll_socks.
+ */
+static int
+omping_poll_timeout(struct omping_instance *instance, struct timeval *old_tstamp, int timeout_time,
+    int max_poll_timeout, int *sock_events)
+{
+	int poll_res;
+
+	do {
+		poll_res = rs_poll_timeout(instance->poll_socks, instance->no_poll_socks,
+		    timeout_time, max_poll_timeout, instance->rt_opts.spin, old_tstamp,
+		    sock_events);
+		instance->no_wakeups++;
+
+		switch (poll_res) {
+		case -1:
+			err(2, "Cannot poll on sockets");
+			/* NOTREACHED */
 			break;
 		case -2:
 			if (clistate_is_stats_display_requested()) {
 				clistate_cancel_stats_display();
 
 				if (instance->op_mode == OMPING_OP_MODE_SHOW_VERSION) {
-					cliprint_final_remote_version(&instance->remote_hosts,
-					    instance->hn_max_len);
+					omping_remote_version_print(instance);
+				} else if (instance->op_mode == OMPING_OP_MODE_COLLECTOR) {
+					omping_collector_print(instance, 0);
 				} else {
+					omping_stats_sync(instance);
 					cliprint_final_stats(&instance->remote_hosts,
 					    instance->hn_max_len, instance->transport_method);
+
+					if (instance->no_profiles > 0) {
+						cliprint_profile_stats(&instance->remote_hosts,
+						    instance->hn_max_len, instance->profiles,
+						    instance->no_profiles,
+						    instance->transport_method);
+					}
 				}
 
 				cliprint_nl();
@@ -386,12 +988,91 @@ omping_poll_timeout(struct omping_instance *instance, struct timeval *old_tstamp
 			return (-2);
 			/* NOTREACHED */
 			break;
+		case -3:
+			return (-3);
+			/* NOTREACHED */
+			break;
 		}
 	} while (poll_res < 0);
 
 	return (poll_res);
 }
 
+/*
+ * Read all messages from socket error queue and attribute them to remote hosts. instance is
+ * omping instance and sock is socket with pending errors. Unreachable errors (port, host or
+ * network unreachable) put remote host to exponential backoff, other errors are counted as
+ * error messages.
+ * Function returns 0 on success, or -2 on EINTR.
+ */
+static int
+omping_process_err_queue(struct omping_instance *instance, int sock)
+{
+	char addr_str[INET6_ADDRSTRLEN];
+	struct sockaddr_storage dst_addr;
+	struct rh_item *rh_item;
+	struct rh_item_ci *ci;
+	int backoff;
+	int err_no;
+	int icmp_origin;
+	int res;
+
+	while ((res = rs_receive_err(sock, &dst_addr, &err_no, &icmp_origin)) > 0) {
+		af_sa_to_str((struct sockaddr *)&dst_addr, addr_str);
+		DEBUG_PRINTF("Received error %d (icmp %d) for message to %s", err_no, icmp_origin,
+		    addr_str);
+
+		rh_item = rh_list_find(&instance->remote_hosts, (const struct sockaddr *)&dst_addr);
+		if (rh_item == NULL) {
+			DEBUG_PRINTF("Error is not related to any remote host");
+			continue;
+		}
+
+		ci = &rh_item->client_info;
+
+		if (!(err_no == ECONNREFUSED || err_no == EHOSTUNREACH || err_no == ENETUNREACH ||
+		    err_no == EHOSTDOWN || err_no == ENETDOWN)) {
+			ci->no_err_msgs++;
+			continue;
+		}
+
+		if (ci->no_unreach < (uint64_t)~0) {
+			ci->no_unreach++;
+		}
+
+		if (ci->unreach_backoff == 0) {
+			backoff = instance->wait_time * UNREACH_BACKOFF_MUL;
+			if (backoff < UNREACH_BACKOFF_MIN) {
+				backoff = UNREACH_BACKOFF_MIN;
+			}
+		} else if (omping_client_unreach_remaining(ci, util_get_time()) > 0) {
+			/*
+			 * Error for message sent before backoff started
+			 */
+			continue;
+		} else {
+			backoff = ci->unreach_backoff * UNREACH_BACKOFF_MUL;
+		}
+
+		if (backoff > UNREACH_BACKOFF_MAX) {
+			backoff = UNREACH_BACKOFF_MAX;
+		}
+
+		ci->unreach_backoff = backoff;
+		ci->unreach_ts = util_get_time();
+		instance->fs_next_init_ms = 0;
+
+		VERBOSE_PRINTF("%s is unreachable (%s), backing off for %d ms",
+		    rh_item->addr->host_name, strerror(err_no), backoff);
+	}
+
+	if (res == -1) {
+		err(2, "Cannot receive message from socket error queue");
+	}
+
+	return (res);
+}
+
 /*
  * Process received message. Instance is omping instance, msg is received message with msg_len
  * length, from is source of message. ttl is packet Time-To-Live or 0, if that information was not
@@ -421,8 +1102,10 @@ omping_process_msg(struct omping_instance *instance, const char *msg, size_t msg
 	    msg_decoded.msg_type, msg_decoded.msg_type, msg_len);
 
 	if (omping_check_msg_common(&msg_decoded) == -1) {
-		res = ms_stop(instance->ucast_socket, &instance->mcast_addr.sas, &msg_decoded,
-		    from);
+		res = omping_send_stop(instance, &msg_decoded, from, rp_timestamp);
+	} else if (instance->op_mode == OMPING_OP_MODE_COLLECTOR &&
+	    msg_decoded.msg_type != MSG_TYPE_REPORT) {
+		goto error_unknown_msg_type;
 	} else {
 		switch (msg_decoded.msg_type) {
 		case MSG_TYPE_INIT:
@@ -462,6 +1145,18 @@ omping_process_msg(struct omping_instance *instance, const char *msg, size_t msg
 			res = omping_process_answer_msg(instance, msg, msg_len, &msg_decoded, from,
 			    ttl, cast_type, rp_timestamp);
 			break;
+		case MSG_TYPE_REPORT:
+			if (cast_type != SF_CT_UNI)
+				goto error_unknown_mcast;
+
+			if (instance->op_mode != OMPING_OP_MODE_COLLECTOR)
+				goto error_unknown_msg_type;
+
+			if (col_matrix_process_report(&instance->collector, msg, msg_len, from,
+			    rp_timestamp) == -1) {
+				DEBUG_PRINTF("Received malformed report from %s", addr_str);
+			}
+			break;
 		}
 	}
 
@@ -517,18 +1212,8 @@ omping_process_answer_msg(struct omping_instance *instance, const char *msg, siz
     const struct msg_decoded *msg_decoded, const struct sockaddr_storage *from, uint8_t ttl,
     enum sf_cast_type cast_type, struct timeval rp_timestamp)
 {
+	struct omping_answer_rec rec;
 	struct rh_item *rh_item;
-	double avg_rtt;
-	double rtt;
-	uint64_t received;
-	uint64_t sent;
-	int cast_index;
-	int dist_set;
-	int first_packet;
-	int is_dup;
-	int rtt_set;
-	int loss;
-	uint8_t dist;
 
 	rh_item = rh_list_find(&instance->remote_hosts, (const struct sockaddr *)from);
 	if (rh_item == NULL) {
@@ -536,6 +1221,15 @@ omping_process_answer_msg(struct omping_instance *instance, const char *msg, siz
 		return (-5);
 	}
 
+	if (cast_type != SF_CT_UNI && msg_decoded->mcast_seq_isset) {
+		/*
+		 * Multicast sequence number is tracked for all multicast answers of sender (also
+		 * for answers to other clients), so loss of same packet can be correlated across
+		 * receivers
+		 */
+		lb_update(&rh_item->client_info.mcast_loss, msg_decoded->mcast_seq);
+	}
+
 	if (msg_decoded->client_id == NULL) {
 		DEBUG_PRINTF("Message doesn't contain client id");
 		return (-5);
@@ -547,6 +1241,8 @@ omping_process_answer_msg(struct omping_instance *instance, const char *msg, siz
 		return (-5);
 	}
 
+	rh_item->client_info.unreach_backoff = 0;
+
 	if (!msg_decoded->seq_num_isset) {
 		DEBUG_PRINTF("Message doesn't contain seq num");
 		return (-5);
@@ -557,91 +1253,201 @@ omping_process_answer_msg(struct omping_instance *instance, const char *msg, siz
 		return (-5);
 	}
 
+	if (msg_decoded->throttled_isset &&
+	    msg_decoded->throttled > rh_item->client_info.ses_throttled) {
+		/*
+		 * Server sends total number of throttled queries in session, so lost answers
+		 * don't matter
+		 */
+		rh_item->client_info.no_throttled +=
+		    msg_decoded->throttled - rh_item->client_info.ses_throttled;
+		rh_item->client_info.ses_throttled = msg_decoded->throttled;
+	}
+
+	if (msg_decoded->profile_isset && msg_decoded->profile >= instance->no_profiles) {
+		DEBUG_PRINTF("Message contains unknown profile");
+		return (-5);
+	}
+
+	if (msg_decoded->profile_isset && (msg_decoded->seq_num == 0 || msg_decoded->seq_num >
+	    rh_item->client_info.profiles[msg_decoded->profile].seq_num)) {
+		DEBUG_PRINTF("Message contains seq num which was never sent by profile");
+		return (-5);
+	}
+
+	memset(&rec, 0, sizeof(rec));
+	rec.type = OMPING_REC_ANSWER;
+	rec.rh_item = rh_item;
+	rec.cast_type = cast_type;
+	rec.msg_len = (uint32_t)msg_len;
+	rec.seq_num = msg_decoded->seq_num;
+	rec.rp_timestamp = rp_timestamp;
+	rec.no_answerable = rh_ci_answerable(&rh_item->client_info,
+	    rh_item->client_info.no_sent);
+	rec.seq_num_overflow = (rh_item->client_info.seq_num_overflow != 0);
+
 	if (ttl > 0 && msg_decoded->ttl > 0) {
-		dist_set = 1;
-		dist =  msg_decoded->ttl - ttl;
-	} else {
-		dist_set = dist = 0;
+		rec.dist_set = 1;
+		rec.dist = msg_decoded->ttl - ttl;
 	}
 
 	if (msg_decoded->client_tstamp_isset) {
-		rtt_set = 1;
-		rtt = util_time_double_absdiff_ns(msg_decoded->client_tstamp, rp_timestamp);
+		rec.rtt_set = 1;
+		rec.rtt = util_time_double_absdiff_ns(msg_decoded->client_tstamp, rp_timestamp);
+	}
+
+	if (msg_decoded->profile_isset) {
+		rec.profile_set = 1;
+		rec.profile = msg_decoded->profile;
+	}
+
+	if (msg_decoded->server_stats_isset) {
+		rec.server_stats_isset = 1;
+		memcpy(&rec.server_stats, &msg_decoded->server_stats, sizeof(rec.server_stats));
+	}
+
+	/*
+	 * With stats thread, statistics are updated and answer is printed outside of receive loop
+	 */
+	if (instance->stats_thread) {
+		if (ring_push(&instance->stats_ring, &rec) == -1) {
+			DEBUG2_PRINTF("Stats ring is full. Answer dropped.");
+		}
 	} else {
-		rtt_set = 0;
-		rtt = 0;
+		omping_process_answer_rec(instance, &rec);
 	}
 
+	return (0);
+}
+
+/*
+ * Update statistics of remote host by answer record rec and print answer (unless quiet mode is
+ * enabled). Answer of test profile updates only statistics of profile. Instance is omping
+ * instance. Function is called by receive loop or by stats thread (if enabled).
+ */
+static void
+omping_process_answer_rec(struct omping_instance *instance, const struct omping_answer_rec *rec)
+{
+	struct rh_cast_stats *cs;
+	struct rh_item *rh_item;
+	double avg_rtt;
+	uint64_t received;
+	uint64_t sent;
+	int cast_index;
+	int first_packet;
+	int is_dup;
+	int loss;
+	int steady;
+
+	rh_item = rec->rh_item;
+
 	avg_rtt = 0;
-	cast_index = (cast_type == SF_CT_UNI ? 0 : 1);
+	cast_index = (rec->cast_type == SF_CT_UNI ? 0 : 1);
+
+	if (rec->profile_set) {
+		/*
+		 * Answers of test profiles are not printed, only statistics of profile are updated
+		 */
+		rh_ci_prof_received(&rh_item->client_info, rec->profile, cast_index, rec->rtt_set,
+		    rec->rtt);
+
+		return ;
+	}
+	cs = &rh_item->client_info.cast_stats[cast_index];
 	is_dup = 0;
 
 	if (instance->dup_buf_items > 0) {
-		is_dup = rh_ci_is_dup_packet(&rh_item->client_info, msg_decoded->seq_num,
-		    cast_index);
+		is_dup = rh_ci_is_dup_packet(&rh_item->client_info, rec->seq_num, cast_index);
 	}
 
 	if (is_dup) {
-		if (rh_item->client_info.no_dups[cast_index] == ((uint64_t)~0)) {
+		if (cs->no_dups == ((uint64_t)~0)) {
 			DEBUG_PRINTF("Number of received duplicates for %s exhausted.",
 			    rh_item->addr->host_name);
 		} else {
-			rh_item->client_info.no_dups[cast_index]++;
+			cs->no_dups++;
 		}
 
-		received = rh_item->client_info.no_received[cast_index];
+		received = cs->no_received;
 	} else {
-		first_packet = (rh_item->client_info.no_received[cast_index] == 0);
+		first_packet = (cs->no_received == 0);
 
-		received = ++rh_item->client_info.no_received[cast_index];
+		received = ++cs->no_received;
 
 		if (cast_index == 0) {
-			rh_item->client_info.lru_seq_num = msg_decoded->seq_num;
+			/*
+			 * With stats thread, lru_seq_num is read concurrently by send loop
+			 */
+			__atomic_store_n(&rh_item->client_info.lru_seq_num, rec->seq_num,
+			    __ATOMIC_RELAXED);
 		}
 
-		if (cast_type != SF_CT_UNI && first_packet &&
-		    !rh_item->client_info.seq_num_overflow) {
-			rh_item->client_info.first_mcast_seq = msg_decoded->seq_num;
+		if (rec->cast_type != SF_CT_UNI && first_packet && !rec->seq_num_overflow) {
+			rh_item->client_info.first_mcast_seq = rec->seq_num;
 		}
 
-		if (rtt_set) {
-			util_ov_update(&rh_item->client_info.avg_rtt[cast_index],
-			    &rh_item->client_info.m2_rtt[cast_index], rtt, received);
+		steady = (rec->rtt_set && !rh_ci_warmup_update(&rh_item->client_info, cast_index,
+		    rec->rtt, rec->rp_timestamp, instance->warmup_time));
+
+		if (steady) {
+			cs->no_rtt++;
 
-			if (first_packet) {
-				rh_item->client_info.rtt_max[cast_index] = rtt;
-				rh_item->client_info.rtt_min[cast_index] = rtt;
+			util_ov_update(&cs->avg_rtt, &cs->m2_rtt, rec->rtt, cs->no_rtt);
+
+			rh_ci_rtt_hist_add(&rh_item->client_info, cast_index, rec->rtt);
+
+			if (cs->no_rtt == 1) {
+				cs->rtt_max = rec->rtt;
+				cs->rtt_min = rec->rtt;
 			} else {
-				if (rtt > rh_item->client_info.rtt_max[cast_index]) {
-					rh_item->client_info.rtt_max[cast_index] = rtt;
+				if (rec->rtt > cs->rtt_max) {
+					cs->rtt_max = rec->rtt;
 				}
 
-				if (rtt < rh_item->client_info.rtt_min[cast_index]) {
-					rh_item->client_info.rtt_min[cast_index] = rtt;
+				if (rec->rtt < cs->rtt_min) {
+					cs->rtt_min = rec->rtt;
 				}
 			}
 		}
+
+		rh_ci_flow_received(&rh_item->client_info, cast_index, rec->seq_num, steady,
+		    rec->rtt);
+	}
+
+	if (rec->server_stats_isset) {
+		rh_ci_srv_stats_update(&rh_item->client_info, cast_index, &rec->server_stats);
 	}
 
 	if (instance->cont_stat) {
-		sent = rh_item->client_info.no_sent;
+		sent = rec->no_answerable;
 
-		if (cast_type != SF_CT_UNI && rh_item->client_info.first_mcast_seq > 0) {
-			sent = sent - rh_item->client_info.first_mcast_seq + 1;
+		if (rec->cast_type != SF_CT_UNI && rh_item->client_info.first_mcast_seq > 0) {
+			/*
+			 * Queries sent before first multicast answer are not counted
+			 */
+			if (sent > rh_item->client_info.first_mcast_seq - 1) {
+				sent = sent - rh_item->client_info.first_mcast_seq + 1;
+			} else {
+				sent = 0;
+			}
 		}
 		loss = util_packet_loss_percent(sent, received);
-		avg_rtt = rh_item->client_info.avg_rtt[cast_index] / UTIL_NSINMS;
+		avg_rtt = cs->avg_rtt / UTIL_NSINMS;
 	} else {
 		loss = 0;
 	}
 
 	if (instance->quiet == 0) {
+		/*
+		 * Line is printed by more calls, so stdout is locked to keep it together with stats
+		 * thread
+		 */
+		flockfile(stdout);
 		cliprint_packet_stats(rh_item->addr->host_name, instance->hn_max_len,
-		    msg_decoded->seq_num, is_dup, msg_len, dist_set, dist, rtt_set,
-		    rtt / UTIL_NSINMS, avg_rtt, loss, cast_type, instance->cont_stat);
+		    rec->seq_num, is_dup, rec->msg_len, rec->dist_set, rec->dist, rec->rtt_set,
+		    rec->rtt / UTIL_NSINMS, avg_rtt, loss, rec->cast_type, instance->cont_stat);
+		funlockfile(stdout);
 	}
-
-	return (0);
 }
 
 /*
@@ -656,49 +1462,53 @@ omping_process_init_msg(struct omping_instance *instance, const char *msg, size_
     const struct msg_decoded *msg_decoded, const struct sockaddr_storage *from,
     struct timeval rp_timestamp)
 {
-	struct rh_item *rh_item;
+	struct omping_stack *stack;
+	struct rh_item_si *si;
 
-	rh_item = rh_list_find(&instance->remote_hosts, (const struct sockaddr *)from);
-	if (rh_item == NULL) {
+	si = omping_si_find(instance, from);
+	if (si == NULL) {
 		DEBUG_PRINTF("Received message from unknown address");
 
-		return (ms_stop(instance->ucast_socket, &instance->mcast_addr.sas,
-		    msg_decoded, from));
+		return (omping_send_stop(instance, msg_decoded, from, rp_timestamp));
 	}
 
-	if (rh_item->server_info.state == RH_SS_FINISHING) {
+	stack = omping_stack_by_addr(instance, from);
+
+	if (si->state == RH_SS_FINISHING) {
 		DEBUG_PRINTF("We are in finishing state. Sending request to stop.");
 
-		return (ms_stop(instance->ucast_socket, &instance->mcast_addr.sas,
-		    msg_decoded, from));
+		return (omping_send_stop(instance, msg_decoded, from, rp_timestamp));
 	}
 
 	if (!msg_decoded->mcast_prefix_isset) {
 		DEBUG_PRINTF("Mcast prefix is not set");
 
-		return (ms_response(instance->ucast_socket, &instance->mcast_addr.sas,
+		return (ms_response(stack->ucast_socket, &stack->mcast_addr.sas,
 		    msg_decoded, from, 0, 1, NULL, 0));
 	}
 
-	if (!msg_has_prefix(msg, msg_len, &instance->mcast_addr.sas)) {
+	if (!msg_has_prefix(msg, msg_len, &stack->mcast_addr.sas)) {
 		DEBUG_PRINTF("Can't find required prefix");
 
-		return (ms_response(instance->ucast_socket, &instance->mcast_addr.sas, msg_decoded,
+		return (ms_response(stack->ucast_socket, &stack->mcast_addr.sas, msg_decoded,
 		    from, 0, 1, NULL, 0));
 	}
 
-	if (util_time_absdiff(rh_item->server_info.last_init_ts, rp_timestamp) <
-	    DEFAULT_WAIT_TIME) {
+	if (rh_si_is_retrans(si, msg_decoded->client_id, msg_decoded->client_id_len)) {
+		DEBUG_PRINTF("Init message retransmission. Sending response with same session id.");
+
+		return (ms_response(stack->ucast_socket, &stack->mcast_addr.sas, msg_decoded,
+		    from, 1, 0, si->ses_id, SESSIONID_LEN));
+	}
+
+	if (rh_si_new_session(si, msg_decoded->client_id, msg_decoded->client_id_len,
+	    rp_timestamp, MIN_INIT_TIME) == -1) {
 		DEBUG_PRINTF("Time diff between two init messages too short. Ignoring message.");
 		return (0);
 	}
 
-	util_gen_sid(rh_item->server_info.ses_id);
-	rh_item->server_info.state = RH_SS_ANSWER;
-	rh_item->server_info.last_init_ts = rp_timestamp;
-
-	return (ms_response(instance->ucast_socket, &instance->mcast_addr.sas, msg_decoded, from,
-	    1, 0, rh_item->server_info.ses_id, SESSIONID_LEN));
+	return (ms_response(stack->ucast_socket, &stack->mcast_addr.sas, msg_decoded, from,
+	    1, 0, si->ses_id, SESSIONID_LEN));
 }
 
 /*
@@ -713,70 +1523,193 @@ omping_process_query_msg(struct omping_instance *instance, const char *msg, size
     const struct msg_decoded *msg_decoded, const struct sockaddr_storage *from,
     struct timeval rp_timestamp)
 {
-	struct rh_item *rh_item;
-
-	rh_item = rh_list_find(&instance->remote_hosts, (const struct sockaddr *)from);
-	if (rh_item == NULL) {
+	const struct tlv_server_stats *server_stats;
+	struct gcra_item client_rl;
+	struct omping_stack *stack;
+	struct rh_item_si *si;
+	struct tlv_server_stats stats;
+	uint32_t now_ms;
+	uint32_t mcast_seq;
+	int rl_res;
+
+	si = omping_si_find(instance, from);
+	if (si == NULL) {
 		DEBUG_PRINTF("Received message from unknown address");
 
-		return (ms_stop(instance->ucast_socket, &instance->mcast_addr.sas,
-		    msg_decoded, from));
+		return (omping_send_stop(instance, msg_decoded, from, rp_timestamp));
 	}
 
-	if (rh_item->server_info.state != RH_SS_ANSWER) {
+	if (si->state != RH_SS_ANSWER) {
 		DEBUG_PRINTF("Server is not in answer state");
 
-		return (ms_stop(instance->ucast_socket, &instance->mcast_addr.sas,
-		    msg_decoded, from));
+		return (omping_send_stop(instance, msg_decoded, from, rp_timestamp));
 	}
 
 	if (!msg_decoded->seq_num_isset || msg_decoded->mcast_grp == NULL) {
 		DEBUG_PRINTF("Received message doesn't have mcast group set");
 
-		return (ms_stop(instance->ucast_socket, &instance->mcast_addr.sas,
-		    msg_decoded, from));
+		return (omping_send_stop(instance, msg_decoded, from, rp_timestamp));
 	}
 
 	if (msg_decoded->ses_id_len != SESSIONID_LEN ||
-	    memcmp(msg_decoded->ses_id, rh_item->server_info.ses_id, SESSIONID_LEN) != 0) {
+	    memcmp(msg_decoded->ses_id, si->ses_id, SESSIONID_LEN) != 0) {
 		DEBUG_PRINTF("Received message session id isn't expected");
 
-		return (ms_stop(instance->ucast_socket, &instance->mcast_addr.sas,
-		    msg_decoded, from));
+		return (omping_send_stop(instance, msg_decoded, from, rp_timestamp));
 	}
 
 	/*
-	 * Rate limiting
+	 * Queries of test profiles have own sequence numbers, so they are not part of server side
+	 * statistics (neither received nor answered)
 	 */
-	if (instance->rate_limit_time > 0) {
-		if (gcra_rl(&rh_item->server_info.gcra, rp_timestamp) == 0) {
+	if (!msg_decoded->profile_isset) {
+		rh_si_stats_update(si, msg_decoded->seq_num, msg_decoded->client_tstamp_isset,
+		    msg_decoded->client_tstamp, rp_timestamp);
+	}
+
+	/*
+	 * Rate limiting. Per client limit and aggregate limit of all clients. Client limit uses
+	 * shared parameters with theoretical arrival time of client.
+	 */
+	client_rl = instance->client_rl;
+	client_rl.tat = si->gcra_tat;
+
+	if (instance->rate_limit_time > 0 && instance->rate_limit_aggr_time > 0) {
+		rl_res = gcra_rl_hier(&client_rl, &instance->aggr_rl, rp_timestamp);
+	} else if (instance->rate_limit_time > 0) {
+		rl_res = gcra_rl(&client_rl, rp_timestamp);
+	} else if (instance->rate_limit_aggr_time > 0) {
+		rl_res = (gcra_rl(&instance->aggr_rl, rp_timestamp) ? 1 : -1);
+	} else {
+		rl_res = 1;
+	}
+
+	si->gcra_tat = client_rl.tat;
+
+	if (rl_res != 1) {
+		if (rl_res == 0) {
 			DEBUG_PRINTF("Received message rate limited");
-			return (0);
+			instance->no_client_rl++;
+		} else {
+			DEBUG_PRINTF("Received message rate limited by aggregate limit");
+			instance->no_aggr_rl++;
+		}
+
+		/*
+		 * Client is informed about throttled queries in next answer. Throttled queries of
+		 * test profiles are only lost queries of profile.
+		 */
+		if (!msg_decoded->profile_isset) {
+			si->no_throttled++;
+			si->last_throttled_seq = msg_decoded->seq_num;
 		}
+
+		return (0);
+	}
+
+	if (!msg_decoded->profile_isset) {
+		si->no_answered++;
 	}
 
 	/*
-	 * Answer to query message
+	 * Server side statistics are sent once per SERVER_STATS_INTERVAL (only in answers of main
+	 * regime, because client doesn't use answers of test profiles for them)
 	 */
-	return (ms_answer(instance->ucast_socket, &instance->mcast_addr.sas, msg, msg_len,
-	    msg_decoded, from, instance->ttl, MS_ANSWER_BOTH));
+	server_stats = NULL;
+	now_ms = (uint32_t)util_tv_to_ms(rp_timestamp);
+	if (!msg_decoded->profile_isset && (!(si->flags & RH_SIF_STATS_SET) ||
+	    now_ms - si->last_stats_ms >= SERVER_STATS_INTERVAL)) {
+		si->last_stats_ms = now_ms;
+		si->flags |= RH_SIF_STATS_SET;
+
+		stats.first_seq = si->first_seq;
+		stats.jitter_us = (uint32_t)si->jitter;
+		stats.max_seq = si->max_seq;
+		stats.no_answered = si->no_answered;
+		stats.no_received = si->no_received;
+		server_stats = &stats;
+	}
+
+	/*
+	 * Answer to query message. Multicast sequence number is shared by all clients, so receivers
+	 * can correlate loss of same multicast packet. Multicast answer is sent to port of query
+	 * source, so sequence number is added only to answers received by all nodes on default
+	 * port (not for client mode or multipath flows).
+	 */
+	stack = omping_stack_by_addr(instance, from);
+
+	mcast_seq = 0;
+	if (af_sa_port(AF_CAST_SA(from)) == stack->port) {
+		stack->mcast_seq++;
+		if (stack->mcast_seq == 0) {
+			stack->mcast_seq++;
+		}
+
+		mcast_seq = stack->mcast_seq;
+	}
+
+	return (ms_answer(stack->ucast_socket, &stack->mcast_addr.sas, msg, msg_len,
+	    msg_decoded, from, instance->ttl, MS_ANSWER_BOTH, si->no_throttled,
+	    si->last_throttled_seq, server_stats, mcast_seq));
 }
 
 /*
- * Process response message. Instance is omping instance, msg is received message with msg_len
- * length, msg_decoded is decoded message and from is address of sender.
- * Function returns 0 on sucess, otherwise same error as rs_sendto or -4 if message cannot be
- * created (usually due to small message buffer), or -5 if message is invalid (not for us, message
- * without client_id, ...).
+ * Process message received on socket with sock_index index in instance->poll_socks. Socket with
+ * even index is unicast, socket with odd index is multicast (or broadcast). Instance is omping
+ * instance, msg is received message with msg_len length, from is source of message, ttl is packet
+ * Time-To-Live (or 0) and rp_timestamp is receiving time of packet.
+ * Function returns 0 on success or -2 on EINTR.
  */
 static int
-omping_process_response_msg(struct omping_instance *instance, const char *msg, size_t msg_len,
+omping_process_received_msg(struct omping_instance *instance, int sock_index, const char *msg,
+    size_t msg_len, const struct sockaddr_storage *from, uint8_t ttl, struct timeval rp_timestamp)
+{
+	enum sf_cast_type cast_type;
+
+	if (instance->rt_opts.enabled) {
+		/*
+		 * Delay between kernel receive timestamp and now is error added by omping itself
+		 */
+		rt_stats_add(&instance->rt_stats,
+		    util_time_double_absdiff_ns(rp_timestamp, util_get_time()));
+	}
+
+	if (sock_index % 2 == 0) {
+		cast_type = SF_CT_UNI;
+	} else {
+		switch (instance->transport_method) {
+		case SF_TM_ASM:
+		case SF_TM_SSM:
+			cast_type = SF_CT_MULTI;
+			break;
+		case SF_TM_IPBC:
+			cast_type = SF_CT_BROAD;
+			break;
+		default:
+			DEBUG_PRINTF("Internal error - unknown tm");
+			errx(1, "Internal error - unknown tm");
+			/* NOTREACHED */
+		}
+	}
+
+	return (omping_process_msg(instance, msg, msg_len, from, ttl, cast_type, rp_timestamp));
+}
+
+/*
+ * Process response message. Instance is omping instance, msg is received message with msg_len
+ * length, msg_decoded is decoded message and from is address of sender.
+ * Function returns 0 on sucess, otherwise same error as rs_sendto or -4 if message cannot be
+ * created (usually due to small message buffer), or -5 if message is invalid (not for us, message
+ * without client_id, ...).
+ */
+static int
+omping_process_response_msg(struct omping_instance *instance, const char *msg, size_t msg_len,
     const struct msg_decoded *msg_decoded, const struct sockaddr_storage *from)
 {
+	struct omping_answer_rec rec;
+	struct omping_stack *stack;
 	struct rh_item *rh_item;
 	enum rh_client_state old_cstate;
-	const char *ci_ses_id;
-	const char *msg_ses_id;
 	int send_res;
 
 	rh_item = rh_list_find(&instance->remote_hosts, (const struct sockaddr *)from);
@@ -786,6 +1719,8 @@ omping_process_response_msg(struct omping_instance *instance, const char *msg, s
 		return (-5);
 	}
 
+	stack = omping_stack_by_addr(instance, from);
+
 	if (rh_item->client_info.state == RH_CS_STOP) {
 		DEBUG_PRINTF("Client is in stop state. Ignoring message.");
 
@@ -805,14 +1740,17 @@ omping_process_response_msg(struct omping_instance *instance, const char *msg, s
 		return (-5);
 	}
 
+	rh_item->client_info.unreach_backoff = 0;
+
 	if (instance->op_mode == OMPING_OP_MODE_SHOW_VERSION) {
 		if (msg_decoded->server_info_len > 0) {
+			/*
+			 * Remote host is moved to stop state, so server info is stored only once
+			 * and it can be allocated from arena
+			 */
 			rh_item->client_info.server_info_len = msg_decoded->server_info_len;
-
-			free(rh_item->client_info.server_info);
-
-			rh_item->client_info.server_info =
-			    (char *)malloc(rh_item->client_info.server_info_len);
+			rh_item->client_info.server_info = (char *)ar_alloc(&instance->rh_arena,
+			    rh_item->client_info.server_info_len);
 
 			if (rh_item->client_info.server_info == NULL) {
 				errx(1, "Can't alloc memory");
@@ -843,8 +1781,15 @@ omping_process_response_msg(struct omping_instance *instance, const char *msg, s
 			 * Technically, packet was sent and also received so no lost at all
 			 */
 			rh_item->client_info.no_sent--;
+			if (rh_item->client_info.no_flows > 1) {
+				rh_item->client_info.flows[rh_item->client_info.seq_num %
+				    rh_item->client_info.no_flows].no_sent--;
+			}
+
+			util_gen_cid(rh_item->client_info.client_id, &stack->local_addr);
 
-			util_gen_cid(rh_item->client_info.client_id, &instance->local_addr);
+			rh_item->client_info.init_interval = 0;
+			instance->fs_next_init_ms = 0;
 		} else {
 			DEBUG_PRINTF("Client was not in query state. Put it to stop state");
 			omping_client_move_to_stop(instance, rh_item, RH_CSR_SERVER);
@@ -853,7 +1798,7 @@ omping_process_response_msg(struct omping_instance *instance, const char *msg, s
 		return (-5);
 	}
 
-	if (!(tlv_mcast_grp_eq(&instance->mcast_addr.sas, msg_decoded->mcast_grp,
+	if (!(tlv_mcast_grp_eq(&stack->mcast_addr.sas, msg_decoded->mcast_grp,
 	    msg_decoded->mcast_grp_len))) {
 		DEBUG_PRINTF("Server send us different multicast group then expected");
 
@@ -865,251 +1810,1355 @@ omping_process_response_msg(struct omping_instance *instance, const char *msg, s
 		return (-5);
 	}
 
-	if (rh_item->client_info.ses_id_len == msg_decoded->ses_id_len) {
-		ci_ses_id = rh_item->client_info.ses_id;
-		msg_ses_id = msg_decoded->ses_id;
+	if (msg_decoded->ses_id_len != SESSIONID_LEN) {
+		DEBUG_PRINTF("Message contains session id with invalid length");
 
-		if (memcmp(ci_ses_id, msg_ses_id, msg_decoded->ses_id_len) == 0) {
-			DEBUG_PRINTF("Duplicate server response");
+		return (-5);
+	}
 
-			return (-5);
-		}
+	if (rh_item->client_info.ses_id_len == SESSIONID_LEN &&
+	    memcmp(rh_item->client_info.ses_id, msg_decoded->ses_id, SESSIONID_LEN) == 0) {
+		DEBUG_PRINTF("Duplicate server response");
+
+		return (-5);
 	}
 
 	old_cstate = rh_item->client_info.state;
 	rh_item->client_info.state = RH_CS_QUERY;
-	rh_item->client_info.ses_id_len = msg_decoded->ses_id_len;
-
-	free(rh_item->client_info.ses_id);
+	rh_item->client_info.ses_id_len = SESSIONID_LEN;
+	memcpy(rh_item->client_info.ses_id, msg_decoded->ses_id, SESSIONID_LEN);
+	rh_item->client_info.ses_throttled = 0;
+
+	if (instance->stats_thread) {
+		/*
+		 * Server side statistics of previous session may be still updated by stats thread,
+		 * so new session is started by stats thread after answers of previous session.
+		 * Record can't be dropped, so ring is drained if (exceptionally) it's full.
+		 */
+		if (ring_is_full(&instance->stats_ring)) {
+			omping_stats_sync(instance);
+		}
 
-	rh_item->client_info.ses_id = (char *)malloc(rh_item->client_info.ses_id_len);
-	if (rh_item->client_info.ses_id == NULL) {
-		errx(1, "Can't alloc memory");
+		memset(&rec, 0, sizeof(rec));
+		rec.type = OMPING_REC_NEW_SESSION;
+		rec.rh_item = rh_item;
+		ring_push(&instance->stats_ring, &rec);
+	} else {
+		rh_ci_srv_stats_new_session(&rh_item->client_info);
 	}
 
-	memcpy(rh_item->client_info.ses_id, msg_decoded->ses_id, rh_item->client_info.ses_id_len);
-
 	if (old_cstate == RH_CS_INITIAL) {
+		if (rh_item->client_info.est_ts.tv_sec == 0 &&
+		    rh_item->client_info.est_ts.tv_usec == 0) {
+			/*
+			 * First session establishment starts warm-up phase
+			 */
+			rh_item->client_info.est_ts = util_get_time();
+		}
+
+		rh_item->client_info.est_time =
+		    util_time_double_absdiff(rh_item->client_info.first_init_ts, util_get_time());
+		memset(&rh_item->client_info.first_init_ts, 0,
+		    sizeof(rh_item->client_info.first_init_ts));
+
 		if (instance->quiet < 2) {
 			cliprint_client_state(rh_item->addr->host_name, instance->hn_max_len,
-			    instance->transport_method, &instance->mcast_addr.sas,
-			    &rh_item->addr->sas, RH_CS_QUERY, RH_CSR_NONE);
+			    instance->transport_method, &stack->mcast_addr.sas,
+			    &rh_item->addr->sas, RH_CS_QUERY, RH_CSR_NONE,
+			    (instance->fast_start ? rh_item->client_info.est_time : -1));
 		}
 	}
 
-	send_res = omping_send_client_query(instance, rh_item, (old_cstate == RH_CS_INITIAL));
+	if (instance->txtime_clock != -1) {
+		/*
+		 * Query is sent immediately, so next scheduled query departs one interval later
+		 */
+		rh_item->client_info.txtime_next = util_clock_ns(instance->txtime_clock) +
+		    (uint64_t)instance->wait_time * 1000000;
+	}
+
+	send_res = omping_send_client_query(instance, rh_item, (old_cstate == RH_CS_INITIAL), NULL,
+	    0);
 
 	return (send_res);
 }
 
 /*
- * Send client query message. instance is omping instance. ri is one item fro rh_list and it's
- * client to process. increase is boolean variable. If set, seq_num and no_sent packets are
- * increased.
- * Function return 0 on success, otherwise same error as rs_sendto or -4 if message cannot be
- * created (usually due to small message buffer)
+ * Receive messages waiting on socket with sock_index index in instance->poll_socks by transport
+ * backend and process them. Instance is omping instance. In efficiency mode, all waiting messages
+ * are received in batches of instance->no_recv_msgs messages, otherwise only one message is
+ * received.
+ * Function returns 0 on success or -2 on EINTR.
  */
 static int
-omping_send_client_query(struct omping_instance *instance, struct rh_item *ri, int increase)
+omping_receive_msgs(struct omping_instance *instance, int sock_index)
 {
-	struct rh_item_ci *ci;
-	int send_res;
-
-	ci = &ri->client_info;
+	struct rs_msg *recv_msg;
+	int i;
+	int no_msgs;
 
-	if (increase) {
-		if (ci->no_sent + 1 == ((uint64_t)~0)) {
-			omping_client_move_to_stop(instance, ri, RH_CSR_SEND_MAXIMUM);
-			DEBUG_PRINTF("Maximum number of sent messages for %s exhausted. "
-			    "Moving to stop state.", ri->addr->host_name);
+	do {
+		no_msgs = rs_receive_msgs(instance->poll_socks[sock_index], instance->recv_msgs,
+		    instance->no_recv_msgs);
 
-			return (0);
+		switch (no_msgs) {
+		case -1:
+			err(2, "Cannot receive message");
+			/* NOTREACHED */
+			break;
+		case -2:
+			return (-2);
+			/* NOTREACHED */
+			break;
+		case -3:
+			warn("Cannot receive message");
+			break;
 		}
 
-		if (instance->send_count_queries > 0 &&
-		    ci->no_sent + 1 > instance->send_count_queries) {
-			omping_client_move_to_stop(instance, ri, RH_CSR_TO_SEND_EXHAUSTED);
-			DEBUG_PRINTF("Number of messages to be sent by %s exhausted. "
-			    "Moving to stop state.", ri->addr->host_name);
+		if (no_msgs > 0) {
+			if (instance->backend_no_msgs == 0) {
+				instance->backend_first_ts = instance->recv_msgs[0].timestamp;
+			}
 
-			return (0);
+			instance->backend_last_ts = instance->recv_msgs[no_msgs - 1].timestamp;
+			instance->backend_no_msgs += no_msgs;
 		}
 
-		ci->seq_num++;
-		ci->no_sent++;
+		for (i = 0; i < no_msgs; i++) {
+			recv_msg = &instance->recv_msgs[i];
 
-		if (ci->seq_num == 0) {
-			ci->seq_num_overflow = 1;
-			ci->seq_num++;
+			if (recv_msg->recv_size == -4) {
+				VERBOSE_PRINTF("Received message too long");
+				continue;
+			}
+
+			if (omping_process_received_msg(instance, sock_index, recv_msg->data,
+			    recv_msg->recv_size, &recv_msg->from_addr, recv_msg->ttl,
+			    recv_msg->timestamp) == -2) {
+				return (-2);
+			}
 		}
+	} while (instance->efficient && no_msgs == instance->no_recv_msgs);
+
+	return (0);
+}
+
+/*
+ * Allocate buffers for receiving of messages. In efficiency mode, RS_MAX_BATCH_MSGS messages are
+ * received by one call, otherwise one.
+ */
+static void
+omping_recv_msgs_alloc(struct omping_instance *instance)
+{
+	char *msg_buf;
+	int i;
+
+	instance->no_recv_msgs = (instance->efficient ? RS_MAX_BATCH_MSGS : 1);
+
+	instance->recv_msgs = calloc(instance->no_recv_msgs, sizeof(struct rs_msg));
+	msg_buf = malloc(MAX_MSG_SIZE * instance->no_recv_msgs);
+	if (instance->recv_msgs == NULL || msg_buf == NULL) {
+		errx(1, "Can't alloc memory");
 	}
 
-	send_res = ms_query(instance->ucast_socket, &ri->addr->sas, &instance->mcast_addr.sas,
-	    ci->seq_num, ci->client_id, ci->ses_id, ci->ses_id_len);
+	for (i = 0; i < instance->no_recv_msgs; i++) {
+		instance->recv_msgs[i].msg = msg_buf + i * MAX_MSG_SIZE;
+		instance->recv_msgs[i].msg_len = MAX_MSG_SIZE;
+	}
+}
 
-	return (send_res);
+/*
+ * Print remote versions (remote version display mode). In scan mode, versions were already
+ * printed as they arrived, so only summary is printed. Scan time is measured from first init
+ * message, which was always sent to first host in list.
+ */
+static void
+omping_remote_version_print(struct omping_instance *instance)
+{
+	struct rh_item *first;
+
+	if (instance->scan_concurrency == 0) {
+		cliprint_final_remote_version(&instance->remote_hosts, instance->hn_max_len);
+
+		return ;
+	}
+
+	first = TAILQ_FIRST(&instance->remote_hosts);
+
+	cliprint_scan_summary(&instance->remote_hosts,
+	    util_time_double_absdiff(first->client_info.first_init_ts, util_get_time()));
 }
 
 /*
- * Send client init or request messages to all of remote hosts. instance is omping instance.
- * Function return 0 on success, or -2 on EINTR.
+ * Send stats report to collector from last statistics snapshot. instance is omping instance.
+ * Report contains summaries of peers starting with instance->report_next and continuing round
+ * robin until REPORT_MAX_PEERS summaries are collected or REPORT_MAX_SIZE is reached. Summary also
+ * contains runs of lost multicast packets finalized since previous report. Next report continues
+ * with first peer which was not included.
+ * Function returns 0 on success, or -2 on EINTR.
  */
 static int
-omping_send_client_msgs(struct omping_instance *instance)
+omping_report_send(struct omping_instance *instance)
 {
-	struct rh_item *remote_host;
+	struct tlv_peer_summary peer_summaries[REPORT_MAX_PEERS];
+	struct tlv_peer_summary *peer_summary;
+	struct omping_stack *stack;
+	struct rh_item *peer_items[REPORT_MAX_PEERS];
+	struct rh_item *rh_item;
+	struct rh_item *start;
 	struct rh_item_ci *ci;
+	size_t no_added;
+	size_t i;
+	size_t no_peers;
 	int send_res;
 
-	TAILQ_FOREACH(remote_host, &instance->remote_hosts, entries) {
-		send_res = 0;
-		ci = &remote_host->client_info;
+	start = instance->report_next;
+	if (start == NULL) {
+		start = TAILQ_FIRST(&instance->remote_hosts);
+	}
 
-		switch (ci->state) {
-		case RH_CS_INITIAL:
-			/*
-			 * Initial message is send at most after DEFAULT_WAIT_TIME
-			 */
-			if (util_time_absdiff(ci->last_init_ts, util_get_time()) >
-			    DEFAULT_WAIT_TIME) {
-				if (instance->quiet < 2) {
-					cliprint_client_state(remote_host->addr->host_name,
-					    instance->hn_max_len, instance->transport_method, NULL,
-					    &remote_host->addr->sas, RH_CS_INITIAL, RH_CSR_NONE);
-				}
+	rh_item = start;
+	no_peers = 0;
 
-				send_res = ms_init(instance->ucast_socket, &remote_host->addr->sas,
-				    &instance->mcast_addr.sas, ci->client_id,
-				    (instance->op_mode == OMPING_OP_MODE_SHOW_VERSION ? 1 : 0));
+	while (rh_item != NULL && no_peers < REPORT_MAX_PEERS) {
+		ci = &rh_item->client_info;
 
-				ci->last_init_ts = util_get_time();
-			}
-			break;
-		case RH_CS_QUERY:
-			if (instance->wait_time == 0) {
-				/*
-				 * Handle wait time zero specifically. Send query if answer for
-				 * previous query received or after 1ms.
-				 */
-				if (ci->lru_seq_num == ci->seq_num ||
-				    util_time_absdiff(ci->last_query_ts, util_get_time()) >= 1) {
-					send_res = omping_send_client_query(instance, remote_host,
-					    1);
+		if (ci->no_sent > 0 || ci->mcast_loss.isset) {
+			peer_summary = &peer_summaries[no_peers];
 
-					ci->last_query_ts = util_get_time();
-				}
-			} else {
-				send_res = omping_send_client_query(instance, remote_host, 1);
+			memcpy(&peer_summary->addr, &rh_item->addr->sas,
+			    sizeof(peer_summary->addr));
+			memcpy(&peer_summary->stats, &ci->report_stats,
+			    sizeof(peer_summary->stats));
+			peer_summary->stats.no_sent = ci->report_sent;
+
+			peer_summary->loss_isset = ci->mcast_loss.isset;
+			if (ci->mcast_loss.isset) {
+				memcpy(&peer_summary->loss, &ci->mcast_loss.pending,
+				    sizeof(peer_summary->loss));
 			}
-			break;
-		case RH_CS_STOP:
-			/*
-			 * Do nothing
-			 */
-			break;
+
+			peer_items[no_peers++] = rh_item;
 		}
 
-		switch (send_res) {
-		case -1:
-			err(2, "Cannot send message");
-			/* NOTREACHED */
-			break;
-		case -2:
-			return (-2);
-			/* NOTREACHED */
-			break;
-		case -3:
-			warn("Send message error");
-			ci->no_err_msgs++;
-			break;
-		case -4:
-			DEBUG_PRINTF("Cannot send message. Buffer too small");
+		rh_item = TAILQ_NEXT(rh_item, entries);
+		if (rh_item == NULL) {
+			rh_item = TAILQ_FIRST(&instance->remote_hosts);
+		}
+
+		if (rh_item == start) {
 			break;
 		}
 	}
 
+	if (no_peers == 0) {
+		return (0);
+	}
+
+	stack = omping_stack_by_addr(instance, &instance->collector_addr.sas);
+
+	send_res = ms_report(stack->ucast_socket, &instance->collector_addr.sas,
+	    peer_summaries, no_peers, REPORT_MAX_SIZE, &no_added);
+
+	switch (send_res) {
+	case -1:
+		err(2, "Cannot send message");
+		/* NOTREACHED */
+		break;
+	case -2:
+		return (-2);
+		/* NOTREACHED */
+		break;
+	case -3:
+		DEBUG_PRINTF("Cannot send report to collector");
+		return (0);
+		/* NOTREACHED */
+		break;
+	case -4:
+		DEBUG_PRINTF("Cannot send report. Buffer too small");
+		return (0);
+		/* NOTREACHED */
+		break;
+	}
+
+	for (i = 0; i < no_added; i++) {
+		lb_reported(&peer_items[i]->client_info.mcast_loss);
+	}
+
+	if (no_added < no_peers) {
+		instance->report_next = peer_items[no_added];
+	} else {
+		instance->report_next = rh_item;
+	}
+
 	return (0);
 }
 
 /*
- * Main loop of omping. It is used for receiving and sending messages. On the end, it prints final
- * statistics. instance is omping instance. timeout_time is maximum amount of time to keep loop
- * running (after this time, loop is ended). final_stats is boolean flag which determines if final
- * statistics should be displayed or not. allow_auto_exit is boolean which if set, allows auto exit
- * if every client is in STOP state.
+ * Take snapshot of receive statistics of all remote hosts for collector report. instance is omping
+ * instance. With stats thread, function is called by stats thread when it processes report record,
+ * so snapshot contains all answers received before report was requested. Completion is signaled
+ * by report_ready.
  */
 static void
-omping_send_receive_loop(struct omping_instance *instance, int timeout_time, int final_stats,
-    int allow_auto_exit)
+omping_report_snapshot(struct omping_instance *instance)
 {
-	struct timeval start_time;
-	int clients_res;
-	int loop_end;
-	int poll_rec_res;
-	int receive_timeout;
-	uint64_t time_diff;
+	struct rh_item *rh_item;
 
-	if (timeout_time != 0) {
-		start_time = util_get_time();
+	TAILQ_FOREACH(rh_item, &instance->remote_hosts, entries) {
+		rh_ci_fill_peer_stats(&rh_item->client_info, &rh_item->client_info.report_stats);
 	}
 
-	loop_end = 0;
+	if (instance->stats_thread) {
+		__atomic_store_n(&instance->report_ready, 1, __ATOMIC_RELEASE);
+	}
+}
 
-	do {
-		clients_res = omping_send_client_msgs(instance);
-		if (clients_res != 0 && clients_res != -2) {
-			err(3, "unknown value of clients_res %u", clients_res);
-			/* NOTREACHED */
-		}
+/*
+ * Apply real-time options of instance. Process is pinned to CPU and SCHED_FIFO scheduler is set
+ * first, then busy polling is enabled on all sockets and memory is locked as last, so all
+ * allocations made during initialization are locked.
+ */
+static void
+omping_rt_apply(struct omping_instance *instance)
+{
+	struct rt_opts *rt_opts;
+	int i;
 
-		if (clients_res == -2) {
-			if (clistate_is_exit_requested()) {
-				loop_end = 1;
-			}
+	rt_opts = &instance->rt_opts;
 
-			continue;
+	if (rt_opts->cpu != -1) {
+		if (rt_set_cpu(rt_opts->cpu) == -1) {
+			err(1, "Can't pin process to CPU %d", rt_opts->cpu);
 		}
 
-		if (timeout_time != 0) {
-			time_diff = util_time_absdiff(start_time, util_get_time());
+		VERBOSE_PRINTF("Process pinned to CPU %d", rt_opts->cpu);
+	}
 
-			if ((int)time_diff + instance->wait_time > timeout_time) {
-				receive_timeout = timeout_time - time_diff;
-			} else {
-				receive_timeout = instance->wait_time;
-			}
-		} else {
-			receive_timeout = instance->wait_time;
+	if (rt_opts->fifo_prio > 0) {
+		if (rt_set_fifo(rt_opts->fifo_prio) == -1) {
+			err(1, "Can't set SCHED_FIFO scheduler with priority %d",
+			    rt_opts->fifo_prio);
 		}
 
-		poll_rec_res = omping_poll_receive_loop(instance, receive_timeout);
+		VERBOSE_PRINTF("SCHED_FIFO scheduler with priority %d set", rt_opts->fifo_prio);
+	}
 
-		if (poll_rec_res != 0 && poll_rec_res != -2) {
-			err(3, "unknown value of poll_rec_res %u", poll_rec_res);
-			/* NOTREACHED */
-		}
+	if (rt_opts->busy_poll > 0) {
+		for (i = 0; i < instance->no_poll_socks; i++) {
+			if (instance->poll_socks[i] < 0) {
+				continue;
+			}
 
-		if (clistate_is_exit_requested()) {
-			loop_end = 1;
+			if (sfset_busy_poll(instance->poll_socks[i], rt_opts->busy_poll) == -1) {
+				err(1, "Can't enable busy polling of socket");
+			}
 		}
 
-		if (timeout_time != 0 &&
-		    (int)util_time_absdiff(start_time, util_get_time()) >= timeout_time) {
-			loop_end = 1;
-		}
+		VERBOSE_PRINTF("Busy polling for %d us enabled", rt_opts->busy_poll);
+	}
 
-		if (allow_auto_exit && instance->auto_exit && instance->rh_no_active == 0) {
-			loop_end = 1;
+	if (rt_opts->mlock) {
+		if (rt_lock_memory() == -1) {
+			err(1, "Can't lock memory");
 		}
-	} while (!loop_end);
 
-	if (final_stats) {
-		if (instance->op_mode == OMPING_OP_MODE_SHOW_VERSION) {
-			cliprint_final_remote_version(&instance->remote_hosts,
-			    instance->hn_max_len);
-		} else {
-			cliprint_final_stats(&instance->remote_hosts, instance->hn_max_len,
-			    instance->transport_method);
-		}
+		VERBOSE_PRINTF("Memory locked");
 	}
 }
+
+/*
+ * Send client query message. instance is omping instance. ri is one item fro rh_list and it's
+ * client to process. increase is boolean variable. If set, seq_num and no_sent packets are
+ * increased. tstamp and txtime are client time stamp and departure time passed to ms_query (NULL
+ * and 0 if query is sent immediately).
+ * Function return 0 on success, otherwise same error as rs_sendto or -4 if message cannot be
+ * created (usually due to small message buffer)
+ */
+static int
+omping_send_client_query(struct omping_instance *instance, struct rh_item *ri, int increase,
+    const struct timeval *tstamp, uint64_t txtime)
+{
+	struct omping_stack *stack;
+	struct rh_item_ci *ci;
+	int flow;
+	int send_res;
+
+	ci = &ri->client_info;
+
+	if (increase) {
+		if (ci->no_sent + 1 == ((uint64_t)~0)) {
+			omping_client_move_to_stop(instance, ri, RH_CSR_SEND_MAXIMUM);
+			DEBUG_PRINTF("Maximum number of sent messages for %s exhausted. "
+			    "Moving to stop state.", ri->addr->host_name);
+
+			return (0);
+		}
+
+		if (instance->send_count_queries > 0 &&
+		    ci->no_sent + 1 > instance->send_count_queries) {
+			omping_client_move_to_stop(instance, ri, RH_CSR_TO_SEND_EXHAUSTED);
+			DEBUG_PRINTF("Number of messages to be sent by %s exhausted. "
+			    "Moving to stop state.", ri->addr->host_name);
+
+			return (0);
+		}
+
+		ci->seq_num++;
+		ci->no_sent++;
+
+		if (ci->seq_num == 0) {
+			ci->seq_num_overflow = 1;
+			ci->seq_num++;
+		}
+
+		rh_ci_flow_sent(ci, ci->seq_num);
+	}
+
+	/*
+	 * In multipath mode, queries are rotated over flows (unicast sockets with different source
+	 * port) so they may be hashed to different ECMP paths. With traffic classes, every flow has
+	 * its own class which is also requested for answers.
+	 */
+	flow = 0;
+	if (instance->mp_flows > 1) {
+		flow = ci->seq_num % instance->mp_flows;
+	}
+
+	stack = omping_stack_by_addr(instance, &ri->addr->sas);
+
+	send_res = ms_query(stack->flow_socks[flow], &ri->addr->sas, &stack->mcast_addr.sas,
+	    ci->seq_num, ci->client_id, ci->ses_id, ci->ses_id_len,
+	    (instance->no_tclasses > 0 ? instance->tclasses[flow] : -1), -1, 0, tstamp, txtime);
+
+	return (send_res);
+}
+
+/*
+ * Send client init message if init message retransmission interval expired. instance is omping
+ * instance, ri is one item from rh_list in initial state and cur_time is current time.
+ * Function return 0 on success (message sent or not needed), otherwise same error as rs_sendto or
+ * -4 if message cannot be created (usually due to small message buffer)
+ */
+static int
+omping_send_client_init(struct omping_instance *instance, struct rh_item *ri,
+    struct timeval cur_time)
+{
+	struct omping_stack *stack;
+	struct rh_item_ci *ci;
+	int first_init;
+	int init_interval;
+	int send_res;
+
+	ci = &ri->client_info;
+
+	/*
+	 * Initial message is send at most after init_interval
+	 */
+	if (ci->init_interval != 0 &&
+	    util_time_absdiff(ci->last_init_ts, cur_time) <= (uint64_t)ci->init_interval) {
+		return (0);
+	}
+
+	first_init = (ci->first_init_ts.tv_sec == 0 && ci->first_init_ts.tv_usec == 0);
+
+	if (instance->quiet < 2 && (first_init || !instance->fast_start)) {
+		cliprint_client_state(ri->addr->host_name, instance->hn_max_len,
+		    instance->transport_method, NULL, &ri->addr->sas, RH_CS_INITIAL, RH_CSR_NONE,
+		    -1);
+	}
+
+	stack = omping_stack_by_addr(instance, &ri->addr->sas);
+
+	send_res = ms_init(stack->ucast_socket, &ri->addr->sas, &stack->mcast_addr.sas,
+	    ci->client_id, (instance->op_mode == OMPING_OP_MODE_SHOW_VERSION ? 1 : 0));
+
+	ci->last_init_ts = util_get_time();
+
+	if (first_init) {
+		ci->first_init_ts = ci->last_init_ts;
+	}
+
+	if (instance->fast_start) {
+		/*
+		 * Exponential backoff with jitter
+		 */
+		if (ci->init_interval == 0) {
+			init_interval = FAST_START_INIT_TIME;
+		} else {
+			init_interval = ci->init_interval * FAST_START_BACKOFF_MUL;
+			if (init_interval > DEFAULT_WAIT_TIME) {
+				init_interval = DEFAULT_WAIT_TIME;
+			}
+		}
+
+		ci->init_interval = util_rand_jitter(init_interval, FAST_START_JITTER_PCT);
+	} else {
+		ci->init_interval = DEFAULT_WAIT_TIME;
+	}
+
+	return (send_res);
+}
+
+/*
+ * Send init messages to all of remote hosts in initial state with expired retransmission
+ * interval. It's used in fast start mode, where retransmission interval is usually much shorter
+ * then interval of sending queries. instance is omping instance. next_timeout is filled by number
+ * of ms to the next init message retransmission or -1 if there is no remote host in initial
+ * state.
+ * Function return 0 on success, or -2 on EINTR.
+ */
+static int
+omping_send_client_inits(struct omping_instance *instance, int *next_timeout)
+{
+	struct rh_item *remote_host;
+	struct rh_item_ci *ci;
+	struct timeval cur_time;
+	uint64_t cur_time_ms;
+	uint64_t elapsed;
+	int send_res;
+	int timeout;
+
+	cur_time = util_get_time();
+	cur_time_ms = util_tv_to_ms(cur_time);
+
+	if (instance->fs_next_init_ms == (uint64_t)~0) {
+		*next_timeout = -1;
+
+		return (0);
+	}
+
+	if (instance->fs_next_init_ms > cur_time_ms) {
+		*next_timeout = instance->fs_next_init_ms - cur_time_ms;
+
+		return (0);
+	}
+
+	*next_timeout = -1;
+
+	TAILQ_FOREACH(remote_host, &instance->remote_hosts, entries) {
+		ci = &remote_host->client_info;
+
+		if (ci->state != RH_CS_INITIAL) {
+			continue;
+		}
+
+		timeout = omping_client_unreach_remaining(ci, cur_time);
+		if (timeout == 0) {
+			send_res = omping_send_client_init(instance, remote_host, cur_time);
+			if (omping_client_send_res_process(ci, send_res) == -2) {
+				instance->fs_next_init_ms = 0;
+
+				return (-2);
+			}
+
+			elapsed = util_time_absdiff(ci->last_init_ts, cur_time);
+			if (elapsed > (uint64_t)ci->init_interval) {
+				timeout = 0;
+			} else {
+				timeout = ci->init_interval - elapsed + 1;
+			}
+		}
+
+		if (*next_timeout == -1 || timeout < *next_timeout) {
+			*next_timeout = timeout;
+		}
+	}
+
+	if (*next_timeout == -1) {
+		instance->fs_next_init_ms = (uint64_t)~0;
+	} else {
+		instance->fs_next_init_ms = cur_time_ms + *next_timeout;
+	}
+
+	return (0);
+}
+
+/*
+ * Send client init or request messages to all of remote hosts (and stats report to collector if
+ * set). instance is omping instance.
+ * Function return 0 on success, or -2 on EINTR.
+ */
+static int
+omping_send_client_msgs(struct omping_instance *instance)
+{
+	struct rh_item *remote_host;
+	struct rh_item_ci *ci;
+	struct timeval cur_time;
+	uint64_t now_ns;
+	int i;
+	int send_res;
+
+	/*
+	 * Report is sent before queries, so answer to previous query had wait_time to arrive
+	 */
+	if (instance->collector_addr.host_name != NULL) {
+		if (omping_send_report(instance) == -2) {
+			return (-2);
+		}
+	}
+
+	/*
+	 * Time is got once for all remote hosts. It's only used for timers, send timestamp of query
+	 * is always current.
+	 */
+	cur_time = util_get_time();
+	now_ns = (instance->txtime_clock != -1 ? util_clock_ns(instance->txtime_clock) : 0);
+
+	TAILQ_FOREACH(remote_host, &instance->remote_hosts, entries) {
+		send_res = 0;
+		ci = &remote_host->client_info;
+
+		if (omping_client_unreach_remaining(ci, cur_time) > 0) {
+			/*
+			 * Remote host is unreachable. Don't send anything until backoff expires
+			 */
+			continue;
+		}
+
+		switch (ci->state) {
+		case RH_CS_INITIAL:
+			/*
+			 * Init messages of scan mode are sent by omping_send_scan_inits
+			 */
+			if (instance->scan_concurrency == 0) {
+				send_res = omping_send_client_init(instance, remote_host, cur_time);
+			}
+			break;
+		case RH_CS_QUERY:
+			if (instance->wait_time == 0) {
+				/*
+				 * Handle wait time zero specifically. Send query if answer for
+				 * previous query received or after 1ms.
+				 */
+				if (__atomic_load_n(&ci->lru_seq_num, __ATOMIC_RELAXED) ==
+				    ci->seq_num ||
+				    util_time_absdiff(ci->last_query_ts, cur_time) >= 1) {
+					if (instance->pacer_rate == 0) {
+						send_res = omping_send_client_query(instance,
+						    remote_host, 1, NULL, 0);
+					} else if (ci->pacer_pending == 0) {
+						omping_pacer_enqueue(instance, remote_host,
+						    cur_time);
+					}
+
+					ci->last_query_ts = cur_time;
+				}
+			} else if (instance->txtime_clock != -1) {
+				send_res = omping_send_client_sched(instance, remote_host, cur_time,
+				    now_ns);
+			} else if (instance->pacer_rate > 0) {
+				omping_pacer_enqueue(instance, remote_host, cur_time);
+			} else {
+				/*
+				 * With traffic classes, query of every class is sent at once, so
+				 * all classes are measured concurrently
+				 */
+				for (i = 0;
+				    i < (instance->no_tclasses > 0 ? instance->no_tclasses : 1) &&
+				    send_res >= 0 && ci->state == RH_CS_QUERY; i++) {
+					send_res = omping_send_client_query(instance, remote_host,
+					    1, NULL, 0);
+				}
+			}
+			break;
+		case RH_CS_STOP:
+			/*
+			 * Do nothing
+			 */
+			break;
+		}
+
+		if (omping_client_send_res_process(ci, send_res) == -2) {
+			return (-2);
+		}
+	}
+
+	if (instance->no_pacer_pending > 0) {
+		return (omping_send_client_paced(instance, cur_time, NULL));
+	}
+
+	return (0);
+}
+
+/*
+ * Send query rounds (one query of every traffic class) waiting in egress pacer queues of remote
+ * hosts while pacer has tokens. instance is omping instance and cur_time is current time. Queues
+ * are served round robin (one query round per remote host), starting with remote host where
+ * previous call stopped, so no remote host is starved. Queues of remote hosts which are no longer
+ * in query state or which are unreachable are flushed. If next_timeout is not NULL and some
+ * queries are still waiting, it's lowered to time in ms until pacer has tokens again.
+ * Function return 0 on success, or -2 on EINTR.
+ */
+static int
+omping_send_client_paced(struct omping_instance *instance, struct timeval cur_time,
+    int *next_timeout)
+{
+	struct rh_item *remote_host;
+	struct rh_item *sweep_start;
+	struct rh_item_ci *ci;
+	uint64_t cur_ns;
+	uint64_t delay;
+	uint64_t queue_ns;
+	int i;
+	int no_sent;
+	int send_res;
+	int timeout;
+
+	cur_ns = util_tv_to_ns(cur_time);
+
+	remote_host = instance->pacer_next;
+	if (remote_host == NULL) {
+		remote_host = TAILQ_FIRST(&instance->remote_hosts);
+	}
+
+	sweep_start = remote_host;
+	no_sent = 0;
+
+	while (instance->no_pacer_pending > 0 && pace_ready(&instance->pacer, cur_time)) {
+		ci = &remote_host->client_info;
+
+		if (ci->pacer_pending > 0 && (ci->state != RH_CS_QUERY ||
+		    omping_client_unreach_remaining(ci, cur_time) > 0)) {
+			instance->no_pacer_pending -= ci->pacer_pending;
+			ci->pacer_pending = 0;
+		}
+
+		if (ci->pacer_pending > 0) {
+			queue_ns = util_tv_to_ns(ci->pacer_ts);
+			delay = (cur_ns > queue_ns ? cur_ns - queue_ns : 0);
+
+			if (delay > 0) {
+				instance->no_pacer_deferred++;
+				instance->pacer_delay_sum += delay;
+
+				if (delay > instance->pacer_delay_max) {
+					instance->pacer_delay_max = delay;
+				}
+			}
+
+			/*
+			 * Next query round was queued (approximately) one interval later
+			 */
+			ci->pacer_pending--;
+			instance->no_pacer_pending--;
+			ci->pacer_ts = util_ns_to_tv(queue_ns +
+			    (uint64_t)instance->wait_time * 1000000);
+
+			send_res = 0;
+
+			for (i = 0; i < (instance->no_tclasses > 0 ? instance->no_tclasses : 1) &&
+			    send_res >= 0 && ci->state == RH_CS_QUERY; i++) {
+				send_res = omping_send_client_query(instance, remote_host, 1, NULL,
+				    0);
+			}
+
+			no_sent++;
+
+			if (omping_client_send_res_process(ci, send_res) == -2) {
+				instance->pacer_next = remote_host;
+
+				return (-2);
+			}
+		}
+
+		remote_host = TAILQ_NEXT(remote_host, entries);
+		if (remote_host == NULL) {
+			remote_host = TAILQ_FIRST(&instance->remote_hosts);
+		}
+
+		if (remote_host == sweep_start) {
+			if (no_sent == 0) {
+				break;
+			}
+
+			no_sent = 0;
+		}
+	}
+
+	instance->pacer_next = remote_host;
+
+	if (next_timeout != NULL && instance->no_pacer_pending > 0) {
+		timeout = (int)((pace_wait_time(&instance->pacer, cur_time) + 999999) / 1000000);
+		if (timeout < 1) {
+			timeout = 1;
+		}
+
+		if (*next_timeout == -1 || timeout < *next_timeout) {
+			*next_timeout = timeout;
+		}
+	}
+
+	return (0);
+}
+
+/*
+ * Send queries of client in txtime mode. instance is omping instance, ri is one item from rh_list
+ * in query state, cur_time is current time and now_ns is current time of txtime clock. All
+ * queries departing before end of next interval (plus slack) are passed to kernel at once and
+ * every query gets departure time on exact grid of interval, so spacing of queries doesn't depend
+ * on wakeup jitter. Client time stamp of query is its departure time, so RTT doesn't contain time
+ * spent in qdisc. Grid is restarted if departure time of next query already passed (first query or
+ * stalled process), so missed queries are not sent in burst.
+ * Function return same value as omping_send_client_query for last sent query (or 0 if no query
+ * was sent).
+ */
+static int
+omping_send_client_sched(struct omping_instance *instance, struct rh_item *ri,
+    struct timeval cur_time, uint64_t now_ns)
+{
+	struct timeval tstamp;
+	struct rh_item_ci *ci;
+	uint64_t horizon;
+	uint64_t interval;
+	int i;
+	int send_res;
+
+	ci = &ri->client_info;
+	interval = (uint64_t)instance->wait_time * 1000000;
+
+	horizon = now_ns + interval + (interval < TXTIME_MAX_SLACK ? interval : TXTIME_MAX_SLACK);
+
+	if (ci->txtime_next < now_ns + TXTIME_MIN_LEAD) {
+		ci->txtime_next = now_ns + TXTIME_MIN_LEAD;
+	}
+
+	send_res = 0;
+
+	while (send_res >= 0 && ci->state == RH_CS_QUERY && ci->txtime_next < horizon) {
+		tstamp = util_ns_to_tv(util_tv_to_ns(cur_time) + (ci->txtime_next - now_ns));
+
+		for (i = 0; i < (instance->no_tclasses > 0 ? instance->no_tclasses : 1) &&
+		    send_res >= 0 && ci->state == RH_CS_QUERY; i++) {
+			send_res = omping_send_client_query(instance, ri, 1, &tstamp,
+			    ci->txtime_next);
+		}
+
+		ci->txtime_next += interval;
+	}
+
+	return (send_res);
+}
+
+/*
+ * Send one query of test profile with profile index to remote host ri (in query state). Query has
+ * sequence number of profile, so statistics of main regime are not affected. Query is not sent if
+ * count of profile in current run is exhausted.
+ * Function returns same value as ms_query (or 0 if query was not sent).
+ */
+static int
+omping_send_profile_query(struct omping_instance *instance, struct rh_item *ri, int profile)
+{
+	struct omping_stack *stack;
+	struct prof_item *prof;
+	struct rh_item_prof *ps;
+	struct rh_item_ci *ci;
+
+	ci = &ri->client_info;
+	prof = &instance->profiles[profile];
+	ps = &ci->profiles[profile];
+
+	if (ps->run != prof->no_runs) {
+		ps->run = prof->no_runs;
+		ps->run_sent = 0;
+	}
+
+	if ((prof->count > 0 && ps->run_sent >= prof->count) || ps->seq_num + 1 == 0) {
+		return (0);
+	}
+
+	ps->seq_num++;
+	ps->no_sent++;
+	ps->run_sent++;
+
+	stack = omping_stack_by_addr(instance, &ri->addr->sas);
+
+	return (ms_query(stack->ucast_socket, &ri->addr->sas, &stack->mcast_addr.sas,
+	    ps->seq_num, ci->client_id, ci->ses_id, ci->ses_id_len, prof->tclass, profile,
+	    prof->size, NULL, 0));
+}
+
+/*
+ * Send rounds of test profiles which are due. instance is omping instance and cur_time is current
+ * time. Round consists of burst queries of profile to every remote host in query state. Every
+ * profile has its own schedule (see prof_round_due), so profiles are interleaved with main regime
+ * and with each other without shifting their timing. next_timeout is lowered to time in ms until
+ * next round of some profile.
+ * Function return 0 on success, or -2 on EINTR.
+ */
+static int
+omping_send_profiles(struct omping_instance *instance, struct timeval cur_time, int *next_timeout)
+{
+	struct prof_item *prof;
+	struct rh_item *remote_host;
+	struct rh_item_ci *ci;
+	uint64_t now_ms;
+	int i, j;
+	int send_res;
+	int timeout;
+
+	now_ms = util_tv_to_ms(cur_time);
+
+	for (i = 0; i < instance->no_profiles; i++) {
+		prof = &instance->profiles[i];
+
+		if (prof_round_due(prof, now_ms)) {
+			TAILQ_FOREACH(remote_host, &instance->remote_hosts, entries) {
+				ci = &remote_host->client_info;
+
+				if (ci->state != RH_CS_QUERY ||
+				    omping_client_unreach_remaining(ci, cur_time) > 0) {
+					continue;
+				}
+
+				send_res = 0;
+
+				for (j = 0; j < prof->burst && send_res >= 0 &&
+				    ci->state == RH_CS_QUERY; j++) {
+					send_res = omping_send_profile_query(instance, remote_host,
+					    i);
+				}
+
+				if (omping_client_send_res_process(ci, send_res) == -2) {
+					return (-2);
+				}
+			}
+		}
+
+		timeout = prof_wait_time(prof, now_ms);
+		if (timeout != -1 && (*next_timeout == -1 || timeout < *next_timeout)) {
+			*next_timeout = timeout;
+		}
+	}
+
+	return (0);
+}
+
+/*
+ * Main loop of omping. It is used for receiving and sending messages. On the end, it prints final
+ * statistics. instance is omping instance. timeout_time is maximum amount of time to keep loop
+ * running (after this time, loop is ended). final_stats is boolean flag which determines if final
+ * statistics should be displayed or not. allow_auto_exit is boolean which if set, allows auto exit
+ * if every client is in STOP state.
+ */
+static void
+omping_send_receive_loop(struct omping_instance *instance, int timeout_time, int final_stats,
+    int allow_auto_exit)
+{
+	struct timeval start_time;
+	int clients_res;
+	int loop_end;
+	int poll_rec_res;
+	int receive_timeout;
+	uint64_t time_diff;
+
+	start_time = util_get_time();
+
+	loop_end = 0;
+
+	do {
+		clients_res = omping_send_client_msgs(instance);
+		if (clients_res != 0 && clients_res != -2) {
+			err(3, "unknown value of clients_res %u", clients_res);
+			/* NOTREACHED */
+		}
+
+		if (clients_res == -2) {
+			if (clistate_is_exit_requested()) {
+				loop_end = 1;
+			}
+
+			continue;
+		}
+
+		time_diff = util_time_absdiff(start_time, util_get_time());
+		receive_timeout = instance->wait_time;
+
+		if (instance->efficient) {
+			/*
+			 * All timers are coalesced to one wakeup per interval. Wakeups are aligned
+			 * to start of loop, so time spent by sending doesn't shift next wakeup.
+			 */
+			receive_timeout -= time_diff % instance->wait_time;
+		}
+
+		if (timeout_time != 0 && (int)time_diff + receive_timeout > timeout_time) {
+			receive_timeout = timeout_time - time_diff;
+		}
+
+		poll_rec_res = omping_poll_receive_loop(instance, receive_timeout);
+
+		if (poll_rec_res != 0 && poll_rec_res != -2) {
+			err(3, "unknown value of poll_rec_res %u", poll_rec_res);
+			/* NOTREACHED */
+		}
+
+		if (clistate_is_exit_requested()) {
+			loop_end = 1;
+		}
+
+		if (timeout_time != 0 &&
+		    (int)util_time_absdiff(start_time, util_get_time()) >= timeout_time) {
+			loop_end = 1;
+		}
+
+		if (allow_auto_exit && instance->auto_exit && instance->rh_no_active == 0) {
+			loop_end = 1;
+		}
+	} while (!loop_end);
+
+	if (final_stats) {
+		if (instance->op_mode == OMPING_OP_MODE_SHOW_VERSION) {
+			omping_remote_version_print(instance);
+		} else {
+			omping_stats_sync(instance);
+			cliprint_final_stats(&instance->remote_hosts, instance->hn_max_len,
+			    instance->transport_method);
+
+			if (instance->no_profiles > 0) {
+				cliprint_profile_stats(&instance->remote_hosts,
+				    instance->hn_max_len, instance->profiles,
+				    instance->no_profiles, instance->transport_method);
+			}
+		}
+	}
+}
+
+/*
+ * Send stats report to collector. instance is omping instance. Report is sent at most once per
+ * REPORT_INTERVAL ms. Number of answerable queries of every remote host is taken together with
+ * snapshot of receive statistics, so they match. With stats thread, snapshot is requested by report
+ * record and report is sent by first call after stats thread takes snapshot, so receive loop never
+ * waits for stats thread.
+ * Function returns 0 on success, or -2 on EINTR.
+ */
+static int
+omping_send_report(struct omping_instance *instance)
+{
+	struct omping_answer_rec rec;
+	struct rh_item *rh_item;
+	struct rh_item_ci *ci;
+	uint64_t sent;
+
+	if (instance->report_pending) {
+		if (!__atomic_load_n(&instance->report_ready, __ATOMIC_ACQUIRE)) {
+			return (0);
+		}
+
+		instance->report_pending = 0;
+
+		if (omping_report_send(instance) == -2) {
+			return (-2);
+		}
+	}
+
+	if ((instance->last_report_ts.tv_sec != 0 || instance->last_report_ts.tv_usec != 0) &&
+	    util_time_absdiff(instance->last_report_ts, util_get_time()) < REPORT_INTERVAL) {
+		return (0);
+	}
+
+	if (instance->stats_thread && ring_is_full(&instance->stats_ring)) {
+		DEBUG_PRINTF("Stats ring is full. Report postponed.");
+
+		return (0);
+	}
+
+	instance->last_report_ts = util_get_time();
+
+	TAILQ_FOREACH(rh_item, &instance->remote_hosts, entries) {
+		ci = &rh_item->client_info;
+
+		sent = rh_ci_answerable(ci, ci->no_sent);
+		ci->report_sent = (sent > UINT32_MAX ? UINT32_MAX : sent);
+	}
+
+	if (instance->stats_thread) {
+		instance->report_ready = 0;
+		instance->report_pending = 1;
+
+		memset(&rec, 0, sizeof(rec));
+		rec.type = OMPING_REC_REPORT;
+		ring_push(&instance->stats_ring, &rec);
+
+		return (0);
+	}
+
+	omping_report_snapshot(instance);
+
+	return (omping_report_send(instance));
+}
+
+/*
+ * Send init messages in scan mode. instance is omping instance. Init messages are sent in order of
+ * remote hosts list, but at most instance->scan_concurrency remote hosts may wait for response at
+ * once. Init message is retransmitted after SCAN_INIT_TIME ms and remote host which doesn't
+ * respond to SCAN_MAX_INITS init messages is moved to stop state, so next host can be scanned.
+ * next_timeout is set to number of ms after which function should be called again, or -1 if no
+ * remote host is waiting for response.
+ * Function returns 0 on success or -2 on EINTR.
+ */
+static int
+omping_send_scan_inits(struct omping_instance *instance, int *next_timeout)
+{
+	struct omping_stack *stack;
+	struct rh_item *remote_host;
+	struct rh_item_ci *ci;
+	struct timeval cur_time;
+	uint64_t elapsed;
+	int no_waiting;
+	int send_res;
+	int timeout;
+
+	cur_time = util_get_time();
+	*next_timeout = -1;
+	no_waiting = 0;
+
+	TAILQ_FOREACH(remote_host, &instance->remote_hosts, entries) {
+		ci = &remote_host->client_info;
+
+		if (ci->state != RH_CS_INITIAL) {
+			continue;
+		}
+
+		if (ci->no_inits == 0) {
+			/*
+			 * Hosts are scanned in list order, so no following host was scanned yet
+			 */
+			if (no_waiting >= instance->scan_concurrency) {
+				break;
+			}
+
+			elapsed = SCAN_INIT_TIME;
+		} else {
+			elapsed = util_time_absdiff(ci->last_init_ts, cur_time);
+		}
+
+		if (elapsed >= SCAN_INIT_TIME) {
+			if (ci->no_inits >= SCAN_MAX_INITS) {
+				omping_client_move_to_stop(instance, remote_host,
+				    RH_CSR_NO_RESPONSE);
+
+				continue;
+			}
+
+			stack = omping_stack_by_addr(instance, &remote_host->addr->sas);
+
+			send_res = ms_init(stack->ucast_socket, &remote_host->addr->sas,
+			    &stack->mcast_addr.sas, ci->client_id, 1);
+
+			if (omping_client_send_res_process(ci, send_res) == -2) {
+				return (-2);
+			}
+
+			if (ci->no_inits == 0) {
+				ci->first_init_ts = cur_time;
+			}
+
+			ci->last_init_ts = cur_time;
+			ci->no_inits++;
+			elapsed = 0;
+		}
+
+		no_waiting++;
+
+		timeout = SCAN_INIT_TIME - elapsed;
+		if (*next_timeout == -1 || timeout < *next_timeout) {
+			*next_timeout = timeout;
+		}
+	}
+
+	return (0);
+}
+
+/*
+ * Send stop message as reply to message from unknown source or from source in bad state. instance
+ * is omping instance, msg_decoded is decoded received message, from is address of sender and
+ * rp_timestamp is receiving time of message. Stop messages are rate limited by instance stop_rl
+ * table, so stray traffic can't be used for amplification.
+ * Function returns 0 on success (or if message was rate limited), otherwise same error as ms_stop.
+ */
+static int
+omping_send_stop(struct omping_instance *instance, const struct msg_decoded *msg_decoded,
+    const struct sockaddr_storage *from, struct timeval rp_timestamp)
+{
+	struct omping_stack *stack;
+
+	if (rl_table_rl(&instance->stop_rl, (const struct sockaddr *)from, rp_timestamp) == 0) {
+		DEBUG2_PRINTF("Stop message rate limited");
+
+		return (0);
+	}
+
+	stack = omping_stack_by_addr(instance, from);
+
+	return (ms_stop(stack->ucast_socket, &stack->mcast_addr.sas, msg_decoded, from));
+}
+
+/*
+ * Find server info of remote host with address sas. Server op_mode keeps only compact server info
+ * table, other modes use server info part of remote host list item.
+ * Function returns pointer to server info or NULL if address is unknown.
+ */
+static struct rh_item_si *
+omping_si_find(struct omping_instance *instance, const struct sockaddr_storage *sas)
+{
+	struct rh_item *rh_item;
+
+	if (instance->op_mode == OMPING_OP_MODE_SERVER) {
+		return (rh_si_table_find(&instance->si_table, (const struct sockaddr *)sas));
+	}
+
+	rh_item = rh_list_find(&instance->remote_hosts, (const struct sockaddr *)sas);
+
+	return (rh_item != NULL ? &rh_item->server_info : NULL);
+}
+
+/*
+ * Return stack of instance with same address family as sas. Every address omping works with
+ * (remote addresses and senders of accepted messages) has family of one of stacks, so function
+ * never fails.
+ */
+static struct omping_stack *
+omping_stack_by_addr(struct omping_instance *instance, const struct sockaddr_storage *sas)
+{
+	int i;
+
+	for (i = 0; i < instance->no_stacks; i++) {
+		if (instance->stacks[i].local_addr.sas.ss_family == sas->ss_family) {
+			return (&instance->stacks[i]);
+		}
+	}
+
+	DEBUG_PRINTF("Internal error - can't find stack for address family %d", sas->ss_family);
+	errx(1, "Internal error - can't find stack for address family %d", sas->ss_family);
+
+	/* NOTREACHED */
+	return (NULL);
+}
+
+/*
+ * Wait until stats thread processes all answer records pushed to stats ring, so statistics of
+ * remote hosts are consistent. Function does nothing if stats thread is not enabled.
+ */
+static void
+omping_stats_sync(struct omping_instance *instance)
+{
+	struct timespec ts;
+
+	if (!instance->stats_thread) {
+		return ;
+	}
+
+	/*
+	 * Sleep instead of yield, because stats thread may have lower priority in real-time mode
+	 */
+	ts.tv_sec = 0;
+	ts.tv_nsec = STATS_SYNC_SLEEP * UTIL_NSINMS / 1000;
+
+	while (!ring_is_empty(&instance->stats_ring)) {
+		nanosleep(&ts, NULL);
+	}
+}
+
+/*
+ * Main function of stats thread. arg is omping instance. Thread processes answer and control
+ * records from stats ring until ring is closed.
+ */
+static void *
+omping_stats_thread(void *arg)
+{
+	struct omping_answer_rec *rec;
+	struct omping_instance *instance;
+
+	instance = (struct omping_instance *)arg;
+
+	do {
+		while ((rec = (struct omping_answer_rec *)ring_front(&instance->stats_ring)) !=
+		    NULL) {
+			switch (rec->type) {
+			case OMPING_REC_ANSWER:
+				omping_process_answer_rec(instance, rec);
+				break;
+			case OMPING_REC_NEW_SESSION:
+				rh_ci_srv_stats_new_session(&rec->rh_item->client_info);
+				break;
+			case OMPING_REC_REPORT:
+				omping_report_snapshot(instance);
+				break;
+			}
+
+			ring_consume(&instance->stats_ring);
+		}
+	} while (ring_wait(&instance->stats_ring) == 0);
+
+	return (NULL);
+}
+
+/*
+ * Create stats ring and start stats thread. Signals are blocked in stats thread, so they are
+ * still delivered to main thread (and interrupt poll). Thread is started before real-time mode
+ * is applied, so it doesn't inherit real-time priority and CPU affinity of main thread.
+ */
+static void
+omping_stats_thread_start(struct omping_instance *instance)
+{
+	sigset_t old_set;
+	sigset_t set;
+	int res;
+
+	ring_create(&instance->stats_ring, STATS_RING_SIZE, sizeof(struct omping_answer_rec));
+
+	sigfillset(&set);
+	pthread_sigmask(SIG_BLOCK, &set, &old_set);
+
+	res = pthread_create(&instance->stats_tid, NULL, omping_stats_thread, instance);
+
+	pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+
+	if (res != 0) {
+		errno = res;
+		err(1, "Can't create stats thread");
+	}
+}
+
+/*
+ * Stop stats thread after it processes all pushed answer records and free stats ring.
+ */
+static void
+omping_stats_thread_stop(struct omping_instance *instance)
+{
+
+	ring_close(&instance->stats_ring);
+	pthread_join(instance->stats_tid, NULL);
+	ring_free(&instance->stats_ring);
+}
+
+/*
+ * Enable scheduled transmission (SO_TXTIME) on unicast sockets of all flows, so queries can be
+ * passed to kernel ahead of time with departure time (see omping_send_client_sched).
+ */
+static void
+omping_txtime_apply(struct omping_instance *instance)
+{
+	struct omping_stack *stack;
+	int i, j;
+	int no_flows;
+
+	no_flows = (instance->mp_flows > 1 ? instance->mp_flows : 1);
+
+	if (util_clock_ns(instance->txtime_clock) == 0) {
+		err(1, "Can't read clock for scheduled transmission");
+	}
+
+	for (j = 0; j < instance->no_stacks; j++) {
+		stack = &instance->stacks[j];
+
+		for (i = 0; i < no_flows; i++) {
+			if (sfset_txtime(stack->flow_socks[i], instance->txtime_clock) == -1) {
+				err(1, "Can't enable scheduled transmission (SO_TXTIME) of socket");
+			}
+		}
+	}
+
+	VERBOSE_PRINTF("Scheduled transmission of queries enabled");
+}
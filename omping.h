@@ -22,7 +22,13 @@
 #define _OMPING_H_
 
 #include "aiifunc.h"
+#include "colfunc.h"
+#include "pacefunc.h"
+#include "proffunc.h"
 #include "rhfunc.h"
+#include "ringfunc.h"
+#include "rlfunc.h"
+#include "rtfunc.h"
 #include "sockfunc.h"
 
 #ifdef __cplusplus
@@ -40,6 +46,23 @@ extern "C" {
 #define DEFAULT_WAIT_TIME	1000
 #define DEFAULT_TTL		64
 
+/*
+ * Fast start. First init message retransmission is made after FAST_START_INIT_TIME ms. Every
+ * next retransmission interval is multiplied by FAST_START_BACKOFF_MUL until it reaches
+ * DEFAULT_WAIT_TIME. Every interval is randomized by +- FAST_START_JITTER_PCT percent so
+ * restarted nodes don't send init messages in synchronized bursts.
+ */
+#define FAST_START_INIT_TIME	10
+#define FAST_START_BACKOFF_MUL	2
+#define FAST_START_JITTER_PCT	25
+
+/*
+ * Minimum time between two init messages with different client id which are accepted by server.
+ * Init message with same client id as previous one is retransmission and it's answered by response
+ * with same session id.
+ */
+#define MIN_INIT_TIME		FAST_START_INIT_TIME
+
 /*
  * Default Wait For Finish multiply constant. wait_time is multiplied with following
  * value.
@@ -58,7 +81,114 @@ extern "C" {
 #define DUP_BUF_SECS		(2 * 60)
 
 /*
- * Default burst value for rate limit GCRA
+ * Warm-up phase. WARMUP_AUTO used as warm-up time means automatic detection of steady state.
+ * Standard deviation of RTT is computed in windows of WARMUP_WIN_ITEMS packets. When two
+ * consecutive windows differ by less then WARMUP_STABLE_PCT percent (or WARMUP_STABLE_MIN_NS ns),
+ * warm-up ends. Warm-up never takes more then WARMUP_AUTO_MAX_ITEMS packets.
+ */
+#define WARMUP_AUTO		-1
+#define WARMUP_WIN_ITEMS	8
+#define WARMUP_STABLE_PCT	25
+#define WARMUP_STABLE_MIN_NS	20000.0
+#define WARMUP_AUTO_MAX_ITEMS	64
+
+/*
+ * Unreachable remote host backoff. After ICMP unreachable error (read from socket error queue),
+ * no messages are sent to remote host for UNREACH_BACKOFF_MUL * wait_time ms (at least
+ * UNREACH_BACKOFF_MIN ms). Every next error multiplies interval by UNREACH_BACKOFF_MUL until it
+ * reaches UNREACH_BACKOFF_MAX ms. Backoff is canceled by any valid message from remote host.
+ */
+#define UNREACH_BACKOFF_MIN	10
+#define UNREACH_BACKOFF_MUL	2
+#define UNREACH_BACKOFF_MAX	60000
+
+/*
+ * Rate limit of stop messages sent as reply to messages from unknown sources (or sources in bad
+ * state). Sources are hashed to STOP_RL_TABLE_SIZE buckets, where every bucket allows one stop
+ * message per STOP_RL_INTERVAL ms with burst of STOP_RL_BURST. All buckets together are limited
+ * to one stop message per STOP_RL_AGGR_INTERVAL ms with burst of STOP_RL_AGGR_BURST.
+ */
+#define STOP_RL_TABLE_SIZE	1024
+#define STOP_RL_INTERVAL	1000
+#define STOP_RL_BURST		3
+#define STOP_RL_AGGR_INTERVAL	10
+#define STOP_RL_AGGR_BURST	50
+
+/*
+ * Interval in ms of sending server side statistics of client in answer messages
+ */
+#define SERVER_STATS_INTERVAL	1000
+
+/*
+ * Stats report sent to collector. Report is sent at most once per REPORT_INTERVAL ms and it's
+ * never bigger then REPORT_MAX_SIZE bytes. Peers which don't fit into one report are sent in
+ * next reports (round robin), so collector traffic is bounded regardless of number of nodes.
+ */
+#define REPORT_INTERVAL		1000
+#define REPORT_MAX_SIZE		1400
+#define REPORT_MAX_PEERS	32
+
+/*
+ * Multipath (ECMP) probing. Queries to every remote host are rotated over MP_MAX_FLOWS flows at
+ * most (every flow is unicast socket with different source port). Flow is highlighted in final
+ * statistics if its loss is at least MP_LOSS_DIFF_PCT percentage points bigger then loss of
+ * all flows together or if its average RTT is bigger by MP_RTT_DIFF_PCT percent (and at least
+ * MP_RTT_DIFF_MIN_NS ns) then average RTT of all flows. Flows with less then MP_MIN_SENT sent
+ * queries are never highlighted.
+ */
+#define MP_MAX_FLOWS		16
+#define MP_LOSS_DIFF_PCT	5.0
+#define MP_RTT_DIFF_PCT		50.0
+#define MP_RTT_DIFF_MIN_NS	100000.0
+#define MP_MIN_SENT		10
+
+/*
+ * Scan mode (remote version display of many hosts). Init message is sent to at most
+ * SCAN_DEF_CONCURRENCY (or user defined number up to SCAN_MAX_CONCURRENCY) remote hosts at once.
+ * Init message is retransmitted after SCAN_INIT_TIME ms and remote host which doesn't respond to
+ * SCAN_MAX_INITS init messages is considered unresponsive.
+ */
+#define SCAN_DEF_CONCURRENCY	256
+#define SCAN_MAX_CONCURRENCY	65536
+#define SCAN_INIT_TIME		200
+#define SCAN_MAX_INITS		3
+
+/*
+ * Efficiency mode. Timer slack is wait_time divided by EFF_TIMER_SLACK_DIV, but at least
+ * EFF_MIN_TIMER_SLACK ns (default timer slack of Linux).
+ */
+#define EFF_TIMER_SLACK_DIV	100
+#define EFF_MIN_TIMER_SLACK	50000
+
+/*
+ * Stats thread. Answers are passed from receive loop to stats thread in ring of STATS_RING_SIZE
+ * records. Answer which doesn't fit into full ring is dropped (and counted). Receive loop waits
+ * for stats thread to process all records (before statistics are printed or reported) by sleeping
+ * STATS_SYNC_SLEEP us.
+ */
+#define STATS_RING_SIZE		8192
+#define STATS_SYNC_SLEEP	100
+
+/*
+ * Scheduled transmission (txtime mode). Every send pass passes to kernel queries departing before
+ * end of next interval plus TXTIME_MAX_SLACK ns (but at most one more interval). Departure time
+ * of query is at least TXTIME_MIN_LEAD ns in future, so qdisc doesn't drop it as late.
+ */
+#define TXTIME_MAX_SLACK	10000000
+#define TXTIME_MIN_LEAD		500000
+
+/*
+ * Egress pacing. Burst of pacer is PACER_BURST_TIME ns of pacing rate, but at least PACER_MIN_BURST
+ * bytes. Every remote host has queue of at most PACER_MAX_PENDING query rounds waiting for tokens.
+ * Oldest query round is skipped if queue is full.
+ */
+#define PACER_BURST_TIME	1000000
+#define PACER_MIN_BURST		1500
+#define PACER_MAX_PENDING	8
+
+/*
+ * Default burst value for rate limit GCRA (per client and also per client share of aggregate
+ * rate limit)
  */
 #define GCRA_BURST		5
 
@@ -83,38 +213,149 @@ enum omping_op_mode {
 	OMPING_OP_MODE_CLIENT,
 	OMPING_OP_MODE_SERVER,
 	OMPING_OP_MODE_SHOW_VERSION,
+	OMPING_OP_MODE_COLLECTOR,
 };
 
 /*
- * Structure with internal omping data. Should be filled by cli_parse and no longer modified outside
- * omping_ functions.
+ * Maximum number of address family stacks (IPv4 and IPv6 stack in dual-stack mode)
  */
-struct omping_instance {
+#define OMPING_MAX_STACKS	2
+
+/*
+ * Address family dependent part of omping instance. Only stacks[0] is used normally, in dual-stack
+ * mode stacks[0] is IPv4 and stacks[1] is IPv6 stack. Every stack has its own sockets, multicast
+ * group and remote addresses, but all stacks share one list of remote hosts. flow_socks is array
+ * of unicast sockets of flows (see MP_MAX_FLOWS) and mcast_seq is multicast sequence number of
+ * multicast answers sent by stack.
+ */
+struct omping_stack {
 	struct ai_item	local_addr;
 	struct ai_item	mcast_addr;
-	struct rh_list	remote_hosts;
 	struct aii_list	remote_addrs;
+	char		*local_ifname;
+	int		*flow_socks;
+	int		ip_ver;
+	int		mcast_socket;
+	int		single_addr;
+	int		ucast_socket;
+	uint32_t	mcast_seq;
+	uint16_t	port;
+};
+
+/*
+ * Type of record passed to stats thread. Control records (new session of remote host and snapshot
+ * of statistics for collector report) are processed in order with answers, so receive loop
+ * doesn't have to wait until stats thread processes all pending answers.
+ */
+enum omping_rec_type {
+	OMPING_REC_ANSWER,
+	OMPING_REC_NEW_SESSION,
+	OMPING_REC_REPORT,
+};
+
+/*
+ * Record passed from receive loop to stats thread. Answer record contains everything needed for
+ * statistics update and printing of one answer, so stats thread doesn't touch received message.
+ * New session record contains only rh_item and report record contains only type.
+ * rtt is valid only if rtt_set is set and dist only if dist_set is set. server_stats is valid only
+ * if server_stats_isset is set. profile is index of test profile of answer and it's valid only if
+ * profile_set is set. no_answerable and seq_num_overflow are copied from client info of remote
+ * host at push time, because they are updated by send loop and stats thread must not read them.
+ */
+struct omping_answer_rec {
+	struct tlv_server_stats server_stats;
+	struct timeval	rp_timestamp;
+	struct rh_item	*rh_item;
+	enum sf_cast_type cast_type;
+	enum omping_rec_type type;
+	double		rtt;
+	uint64_t	no_answerable;
+	uint32_t	msg_len;
+	uint32_t	seq_num;
+	uint8_t		dist;
+	uint8_t		dist_set;
+	uint8_t		profile;
+	uint8_t		profile_set;
+	uint8_t		rtt_set;
+	uint8_t		seq_num_overflow;
+	uint8_t		server_stats_isset;
+};
+
+/*
+ * Structure with internal omping data. Should be filled by cli_parse and no longer modified outside
+ * omping_ functions. report_pending is set when snapshot of statistics for collector report was
+ * requested from stats thread and report_ready is set by stats thread when snapshot is taken.
+ */
+struct omping_instance {
+	struct omping_stack stacks[OMPING_MAX_STACKS];
+	struct ai_item	collector_addr;
+	struct rh_list	remote_hosts;
+	struct rl_table	stop_rl;
+	struct gcra_item aggr_rl;
+	struct gcra_item client_rl;
+	struct col_matrix collector;
+	struct ar_arena	rh_arena;
+	struct pace_bucket pacer;
+	struct prof_item profiles[PROF_MAX];
+	struct ring	stats_ring;
+	struct rt_opts	rt_opts;
+	struct rt_stats	rt_stats;
+	struct rh_si_table si_table;
+	struct timeval	backend_first_ts;
+	struct timeval	backend_last_ts;
+	struct timeval	last_report_ts;
+	struct timeval	start_ts;
+	struct rh_cast_stats *cast_stats;
+	struct rh_item	*pacer_next;
+	struct rh_item	*report_next;
+	struct rs_msg	*recv_msgs;
 	enum omping_op_mode op_mode;
 	enum sf_transport_method transport_method;
-	char		*local_ifname;
+	char		*export_file;
+	pthread_t	stats_tid;
+	uint64_t	backend_no_msgs;
+	uint64_t	fs_next_init_ms;
+	uint64_t	no_aggr_rl;
+	uint64_t	no_client_rl;
+	uint64_t	no_pacer_deferred;
+	uint64_t	no_pacer_pending;
+	uint64_t	no_pacer_skipped;
+	uint64_t	no_wakeups;
+	uint64_t	pacer_delay_max;
+	uint64_t	pacer_delay_sum;
+	uint64_t	pacer_rate;
+	uint64_t	rate_limit_aggr_time;
+	uint64_t	rate_limit_time;
 	uint64_t	send_count_queries;
+	int		*poll_socks;
+	int		tclasses[MP_MAX_FLOWS];
 	int		auto_exit;
+	int		backend_stats;
 	int		cont_stat;
 	int		dup_buf_items;
+	int		efficient;
+	int		fast_start;
 	int		hn_max_len;
-	int		ip_ver;
-	int		mcast_socket;
+	int		mp_flows;
+	int		no_poll_socks;
+	int		no_profiles;
+	int		no_recv_msgs;
+	int		no_stacks;
+	int		no_tclasses;
 	int		quiet;
-	int		rate_limit_time;
+	int		rate_limit_burst;
 	int		rcvbuf_size;
-	int		single_addr;
+	int		report_pending;
+	int		report_ready;
+	int		scan_concurrency;
 	int		sndbuf_size;
+	int		stats_thread;
 	int		timeout_time;
-	int		ucast_socket;
+	int		txtime_clock;
 	int		wait_for_finish_time;
 	int		wait_time;
+	int		warmup_time;
 	unsigned int	rh_no_active;
-	uint16_t	port;
 	uint8_t		ttl;
 };
 
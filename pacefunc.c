@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+ * FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Author: agent <agent@local>
+ */
+
+#include <sys/time.h>
+
+#include <inttypes.h>
+#include <string.h>
+
+#include "pacefunc.h"
+#include "util.h"
+
+static void	pace_refill(struct pace_bucket *pb, uint64_t now);
+
+/*
+ * Charge bytes sent at time tv to token bucket pb. Tokens are taken even if bucket doesn't contain
+ * enough of them, so messages which can't wait (answers) delay following paced messages. Debt is
+ * limited by burst, so paced messages are not starved long after burst of such messages.
+ */
+void
+pace_charge(struct pace_bucket *pb, size_t bytes, struct timeval tv)
+{
+
+	pace_refill(pb, util_tv_to_ns(tv));
+
+	pb->tokens -= (int64_t)bytes;
+	if (pb->tokens < -(int64_t)pb->burst) {
+		pb->tokens = -(int64_t)pb->burst;
+	}
+
+	pb->no_bytes += bytes;
+}
+
+/*
+ * Initialize token bucket pb with rate bytes per second and maximum burst bytes. Bucket is full
+ * after initialization.
+ */
+void
+pace_init(struct pace_bucket *pb, uint64_t rate, uint64_t burst)
+{
+
+	memset(pb, 0, sizeof(*pb));
+
+	pb->burst = burst;
+	pb->rate = rate;
+	pb->tokens = (int64_t)burst;
+	pb->last_ns = util_tv_to_ns(util_get_time());
+}
+
+/*
+ * Test if paced message can be sent at time tv from token bucket pb.
+ * Function returns 1 if bucket contains at least one token, otherwise 0.
+ */
+int
+pace_ready(struct pace_bucket *pb, struct timeval tv)
+{
+
+	pace_refill(pb, util_tv_to_ns(tv));
+
+	return (pb->tokens > 0);
+}
+
+/*
+ * Add tokens for time elapsed between last refill of token bucket pb and now (in ns). Number of
+ * tokens is limited by burst. last_ns is moved only by time of added tokens, so remainder shorter
+ * then one token is not lost by frequent refills.
+ */
+static void
+pace_refill(struct pace_bucket *pb, uint64_t now)
+{
+	uint64_t elapsed;
+	uint64_t new_tokens;
+
+	if (now <= pb->last_ns) {
+		return ;
+	}
+
+	elapsed = now - pb->last_ns;
+	new_tokens = (elapsed / 1000000000) * pb->rate +
+	    (elapsed % 1000000000) * pb->rate / 1000000000;
+
+	if (new_tokens >= pb->burst || pb->tokens + (int64_t)new_tokens >= (int64_t)pb->burst) {
+		pb->tokens = (int64_t)pb->burst;
+		pb->last_ns = now;
+
+		return ;
+	}
+
+	pb->tokens += (int64_t)new_tokens;
+	pb->last_ns += new_tokens * 1000000000 / pb->rate;
+}
+
+/*
+ * Return time in ns until token bucket pb contains at least one token (0 if it already contains
+ * some).
+ */
+uint64_t
+pace_wait_time(struct pace_bucket *pb, struct timeval tv)
+{
+
+	if (pace_ready(pb, tv)) {
+		return (0);
+	}
+
+	return (((uint64_t)(1 - pb->tokens) * 1000000000 + pb->rate - 1) / pb->rate);
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+ * FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Author: agent <agent@local>
+ */
+
+#ifndef _PACEFUNC_H_
+#define _PACEFUNC_H_
+
+#include <sys/time.h>
+
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Size of IP and UDP headers added to every paced message (IPv4 and IPv6)
+ */
+#define PACE_IP4_OVERHEAD	28
+#define PACE_IP6_OVERHEAD	48
+
+/*
+ * Token bucket used for egress pacing. Tokens are bytes, rate is number of tokens added per second
+ * and burst is maximum number of tokens. tokens may be negative (down to -burst) after charging of
+ * message which was sent without waiting for tokens. last_ns is time of last refill and no_bytes is
+ * number of all charged bytes.
+ */
+struct pace_bucket {
+	uint64_t	burst;
+	uint64_t	last_ns;
+	uint64_t	no_bytes;
+	uint64_t	rate;
+	int64_t		tokens;
+};
+
+extern void	pace_charge(struct pace_bucket *pb, size_t bytes, struct timeval tv);
+
+extern void	pace_init(struct pace_bucket *pb, uint64_t rate, uint64_t burst);
+
+extern int	pace_ready(struct pace_bucket *pb, struct timeval tv);
+
+extern uint64_t	pace_wait_time(struct pace_bucket *pb, struct timeval tv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PACEFUNC_H_ */
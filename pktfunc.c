@@ -0,0 +1,831 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+ * FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Author: agent <agent@local>
+ */
+
+#include <sys/types.h>
+
+#include <sys/socket.h>
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <errno.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include "addrfunc.h"
+#include "logging.h"
+#include "pktfunc.h"
+#include "util.h"
+
+#if defined(__linux__) && defined(TP_STATUS_BLK_TMO)
+#define PKT_TPACKET_V3
+#endif
+
+#ifdef PKT_TPACKET_V3
+/*
+ * Size of one block of ring (must be multiple of page size) and number of blocks
+ */
+#define PKT_BLOCK_SIZE		(1 << 18)
+#define PKT_NO_BLOCKS		32
+
+/*
+ * Frame size. TPACKET_V3 stores packets of variable length into blocks, but frame size must be
+ * still set.
+ */
+#define PKT_FRAME_SIZE		2048
+
+/*
+ * Timeout in ms after which block which is not full is passed to user space. It limits latency
+ * of receiving.
+ */
+#define PKT_BLOCK_TOV		1
+
+/*
+ * Index of first port comparison in BPF filter and maximum number of instructions of filter.
+ * Filter has fixed part, one instruction per port and two return instructions.
+ */
+#define PKT_FILTER_PORTS_INSN	15
+#define PKT_MAX_FILTER_INSNS	(PKT_FILTER_PORTS_INSN + RS_MAX_POLL_SOCKS + 2)
+
+/*
+ * State of packet backend. socks is array of no_socks sockets of omping (same as passed to wait),
+ * cursors are next packets of current block to check for every socket (cursor_idxs are indexes
+ * of these packets in block), map is mmaped ring with
+ * map_len length and cur_block is index of current block, which is owned by user space if
+ * block_held is set. fd is AF_PACKET socket.
+ */
+struct pkt_ring {
+	struct pkt_sock socks[RS_MAX_POLL_SOCKS];
+	struct tpacket3_hdr *cursors[RS_MAX_POLL_SOCKS];
+	uint32_t	cursor_idxs[RS_MAX_POLL_SOCKS];
+	char		*map;
+	size_t		map_len;
+	unsigned int	cur_block;
+	int		block_held;
+	int		fd;
+	int		no_socks;
+};
+
+static struct pkt_ring pkt_ring = { .fd = -1 };
+#endif
+
+/*
+ * Function prototypes
+ */
+#ifdef PKT_TPACKET_V3
+static int	pkt_block_acquire(void);
+
+static struct tpacket_block_desc	*pkt_block_desc(unsigned int block);
+
+static void	pkt_block_release(void);
+#endif
+
+static void	pkt_close(void);
+
+#ifdef PKT_TPACKET_V3
+static int	pkt_filter_attach(void);
+#endif
+
+static int	pkt_open(const int *socks, int no_socks);
+
+#ifdef PKT_TPACKET_V3
+static int	pkt_parse(const struct tpacket3_hdr *hdr, struct sockaddr_storage *dst_addr,
+    struct rs_msg *msg);
+#endif
+
+static int	pkt_recv_batch(int sock, struct rs_msg *msgs, int no_msgs);
+
+static int	pkt_wait(const int *socks, int no_socks, int timeout, int spin,
+    int *sock_events);
+
+/*
+ * Packet backend. Messages are received from AF_PACKET TPACKET_V3 mmap ring (BPF filter passes
+ * only UDP packets for ports of omping sockets) and parsed directly in ring with kernel
+ * timestamps. Messages are sent by socket backend. Backend needs CAP_NET_RAW.
+ */
+const struct rs_backend pkt_backend = {
+	.name = "packet",
+	.ts_source = "kernel (TPACKET_V3)",
+	.close = pkt_close,
+	.open = pkt_open,
+	.recv_batch = pkt_recv_batch,
+	.send_batch = NULL,
+	.wait = pkt_wait,
+	.optional = 0,
+};
+
+#ifdef PKT_TPACKET_V3
+/*
+ * Take current block of ring if it was passed to user space by kernel. Packets of block are
+ * assigned to sockets (cursor and no_pending of every socket are set).
+ * Function returns 1 if block was taken, otherwise 0.
+ */
+static int
+pkt_block_acquire(void)
+{
+	struct sockaddr_storage dst_addr;
+	struct tpacket_block_desc *block_desc;
+	struct tpacket3_hdr *hdr;
+	uint32_t i;
+	int sock_i;
+
+	block_desc = pkt_block_desc(pkt_ring.cur_block);
+
+	if (!(__atomic_load_n(&block_desc->hdr.bh1.block_status, __ATOMIC_ACQUIRE) &
+	    TP_STATUS_USER)) {
+		return (0);
+	}
+
+	for (sock_i = 0; sock_i < pkt_ring.no_socks; sock_i++) {
+		pkt_ring.cursors[sock_i] = NULL;
+		pkt_ring.socks[sock_i].no_pending = 0;
+	}
+
+	hdr = (struct tpacket3_hdr *)((char *)block_desc + block_desc->hdr.bh1.offset_to_first_pkt);
+
+	for (i = 0; i < block_desc->hdr.bh1.num_pkts; i++) {
+		if (pkt_parse(hdr, &dst_addr, NULL) == 0) {
+			sock_i = pkt_socks_find(pkt_ring.socks, pkt_ring.no_socks, &dst_addr);
+
+			if (sock_i >= 0) {
+				if (pkt_ring.cursors[sock_i] == NULL) {
+					pkt_ring.cursors[sock_i] = hdr;
+					pkt_ring.cursor_idxs[sock_i] = i;
+				}
+
+				pkt_ring.socks[sock_i].no_pending++;
+			}
+		}
+
+		hdr = (struct tpacket3_hdr *)((char *)hdr + hdr->tp_next_offset);
+	}
+
+	pkt_ring.block_held = 1;
+
+	return (1);
+}
+
+/*
+ * Return descriptor of block with block index.
+ */
+static struct tpacket_block_desc *
+pkt_block_desc(unsigned int block)
+{
+
+	return ((struct tpacket_block_desc *)(pkt_ring.map + block * PKT_BLOCK_SIZE));
+}
+
+/*
+ * Pass current block back to kernel and move to next block.
+ */
+static void
+pkt_block_release(void)
+{
+	struct tpacket_block_desc *block_desc;
+
+	block_desc = pkt_block_desc(pkt_ring.cur_block);
+
+	__atomic_store_n(&block_desc->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+
+	pkt_ring.cur_block = (pkt_ring.cur_block + 1) % PKT_NO_BLOCKS;
+	pkt_ring.block_held = 0;
+}
+#endif
+
+/*
+ * Close packet backend. Statistics of ring are displayed in verbose mode.
+ */
+static void
+pkt_close(void)
+{
+#ifdef PKT_TPACKET_V3
+	struct tpacket_stats_v3 stats;
+	socklen_t stats_len;
+
+	if (pkt_ring.fd == -1) {
+		return ;
+	}
+
+	memset(&stats, 0, sizeof(stats));
+	stats_len = sizeof(stats);
+	if (getsockopt(pkt_ring.fd, SOL_PACKET, PACKET_STATISTICS, &stats, &stats_len) == 0) {
+		VERBOSE_PRINTF("Packet backend: %u packets received, %u dropped by full ring",
+		    stats.tp_packets, stats.tp_drops);
+	}
+
+	munmap(pkt_ring.map, pkt_ring.map_len);
+	close(pkt_ring.fd);
+
+	pkt_ring.fd = -1;
+#endif
+}
+
+#ifdef PKT_TPACKET_V3
+/*
+ * Attach BPF filter to AF_PACKET socket. Filter passes only incoming UDP packets (not fragmented
+ * and without IPv6 extension headers) with destination port equal to port of some omping socket.
+ * Packet is accessed from network header (socket is SOCK_DGRAM).
+ * Function returns 0 on success, otherwise -1 (errno is set).
+ */
+static int
+pkt_filter_attach(void)
+{
+	struct sock_filter insns[PKT_MAX_FILTER_INSNS];
+	struct sock_fprog prog;
+	uint16_t port;
+	int accept_i;
+	int drop_i;
+	int i;
+	int j;
+	int no_ports;
+
+	no_ports = 0;
+
+	for (i = 0; i < pkt_ring.no_socks; i++) {
+		port = ntohs(af_sa_port(AF_CAST_SA(&pkt_ring.socks[i].bound_addr)));
+
+		for (j = 0; j < no_ports; j++) {
+			if (insns[PKT_FILTER_PORTS_INSN + j].k == port) {
+				break;
+			}
+		}
+
+		if (j == no_ports) {
+			insns[PKT_FILTER_PORTS_INSN + no_ports++].k = port;
+		}
+	}
+
+	drop_i = PKT_FILTER_PORTS_INSN + no_ports;
+	accept_i = drop_i + 1;
+
+	/*
+	 * Direction and protocol
+	 */
+	insns[0] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_AD_OFF +
+	    SKF_AD_PKTTYPE);
+	insns[1] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, PACKET_OUTGOING,
+	    drop_i - 2, 0);
+	insns[2] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_AD_OFF +
+	    SKF_AD_PROTOCOL);
+	insns[3] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETH_P_IP, 0, 7);
+
+	/*
+	 * IPv4. Load destination port
+	 */
+	insns[4] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 9);
+	insns[5] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0,
+	    drop_i - 6);
+	insns[6] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 6);
+	insns[7] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x1fff, drop_i - 8, 0);
+	insns[8] = (struct sock_filter)BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 0);
+	insns[9] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_H | BPF_IND, 2);
+	insns[10] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JA, PKT_FILTER_PORTS_INSN - 11, 0,
+	    0);
+
+	/*
+	 * IPv6. Load destination port
+	 */
+	insns[11] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETH_P_IPV6, 0,
+	    drop_i - 12);
+	insns[12] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 6);
+	insns[13] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0,
+	    drop_i - 14);
+	insns[14] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_H | BPF_ABS, PKT_IPV6_HDR_LEN + 2);
+
+	/*
+	 * Ports
+	 */
+	for (i = PKT_FILTER_PORTS_INSN; i < drop_i; i++) {
+		insns[i] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, insns[i].k,
+		    accept_i - (i + 1), 0);
+	}
+
+	insns[drop_i] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, 0);
+	insns[accept_i] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, 0xffffffff);
+
+	memset(&prog, 0, sizeof(prog));
+	prog.len = accept_i + 1;
+	prog.filter = insns;
+
+	return (setsockopt(pkt_ring.fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)));
+}
+#endif
+
+/*
+ * Open packet backend. socks is array of no_socks sockets. Ring is created on AF_PACKET socket
+ * and filter which drops every packet is attached to all sockets, so packets are not queued
+ * twice (error queue of sockets is still used).
+ * Function returns 0 on success, otherwise -1 (errno is set).
+ */
+static int
+pkt_open(const int *socks, int no_socks)
+{
+#ifdef PKT_TPACKET_V3
+	struct sock_filter drop_insn[1] = { BPF_STMT(BPF_RET | BPF_K, 0) };
+	struct sock_fprog drop_prog;
+	struct sockaddr_ll sll;
+	struct tpacket_req3 req;
+	int i;
+	int saved_errno;
+	int version;
+
+	memset(&pkt_ring, 0, sizeof(pkt_ring));
+	pkt_ring.no_socks = no_socks;
+
+	if (pkt_socks_init(pkt_ring.socks, socks, no_socks) == -1) {
+		return (-1);
+	}
+
+	/*
+	 * Protocol is set by bind after filter and ring are ready, so no unfiltered packet is
+	 * queued
+	 */
+	pkt_ring.fd = socket(AF_PACKET, SOCK_DGRAM, 0);
+	if (pkt_ring.fd == -1) {
+		DEBUG_PRINTF("Can't create AF_PACKET socket");
+		return (-1);
+	}
+
+	if (pkt_filter_attach() == -1) {
+		DEBUG_PRINTF("Can't attach BPF filter");
+		goto error_close;
+	}
+
+	version = TPACKET_V3;
+	if (setsockopt(pkt_ring.fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) == -1) {
+		DEBUG_PRINTF("Can't set TPACKET_V3");
+		goto error_close;
+	}
+
+	memset(&req, 0, sizeof(req));
+	req.tp_block_size = PKT_BLOCK_SIZE;
+	req.tp_block_nr = PKT_NO_BLOCKS;
+	req.tp_frame_size = PKT_FRAME_SIZE;
+	req.tp_frame_nr = PKT_BLOCK_SIZE / PKT_FRAME_SIZE * PKT_NO_BLOCKS;
+	req.tp_retire_blk_tov = PKT_BLOCK_TOV;
+
+	if (setsockopt(pkt_ring.fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) == -1) {
+		DEBUG_PRINTF("Can't create PACKET_RX_RING");
+		goto error_close;
+	}
+
+	pkt_ring.map_len = (size_t)PKT_BLOCK_SIZE * PKT_NO_BLOCKS;
+	pkt_ring.map = mmap(NULL, pkt_ring.map_len, PROT_READ | PROT_WRITE, MAP_SHARED,
+	    pkt_ring.fd, 0);
+	if (pkt_ring.map == MAP_FAILED) {
+		DEBUG_PRINTF("Can't mmap ring");
+		goto error_close;
+	}
+
+	memset(&sll, 0, sizeof(sll));
+	sll.sll_family = AF_PACKET;
+	sll.sll_protocol = htons(ETH_P_ALL);
+
+	if (bind(pkt_ring.fd, (struct sockaddr *)&sll, sizeof(sll)) == -1) {
+		DEBUG_PRINTF("Can't bind AF_PACKET socket");
+		goto error_unmap;
+	}
+
+	memset(&drop_prog, 0, sizeof(drop_prog));
+	drop_prog.len = 1;
+	drop_prog.filter = drop_insn;
+
+	for (i = 0; i < no_socks; i++) {
+		if (setsockopt(socks[i], SOL_SOCKET, SO_ATTACH_FILTER, &drop_prog,
+		    sizeof(drop_prog)) == -1) {
+			DEBUG_PRINTF("Can't attach drop filter to socket");
+			goto error_unmap;
+		}
+	}
+
+	DEBUG_PRINTF("Packet ring created with %u blocks of %u bytes", PKT_NO_BLOCKS,
+	    PKT_BLOCK_SIZE);
+
+	return (0);
+
+error_unmap:
+	saved_errno = errno;
+	munmap(pkt_ring.map, pkt_ring.map_len);
+	errno = saved_errno;
+error_close:
+	saved_errno = errno;
+	close(pkt_ring.fd);
+	pkt_ring.fd = -1;
+	errno = saved_errno;
+
+	return (-1);
+#else
+	errno = ENOSYS;
+
+	return (-1);
+#endif
+}
+
+#ifdef PKT_TPACKET_V3
+/*
+ * Parse packet with hdr header stored in ring. Arguments and return values are same as for
+ * pkt_parse_udp, but msg timestamp is set to kernel timestamp of packet.
+ */
+static int
+pkt_parse(const struct tpacket3_hdr *hdr, struct sockaddr_storage *dst_addr, struct rs_msg *msg)
+{
+	const struct sockaddr_ll *sll;
+
+	sll = (const struct sockaddr_ll *)((const char *)hdr +
+	    TPACKET_ALIGN(sizeof(struct tpacket3_hdr)));
+
+	if (pkt_parse_udp((const unsigned char *)hdr + hdr->tp_net, hdr->tp_snaplen,
+	    sll->sll_ifindex, dst_addr, msg) == -1) {
+		return (-1);
+	}
+
+	if (msg != NULL) {
+		msg->timestamp.tv_sec = hdr->tp_sec;
+		msg->timestamp.tv_usec = hdr->tp_nsec / 1000;
+	}
+
+	return (0);
+}
+#endif
+
+/*
+ * Parse IPv4 or IPv6 packet with UDP payload. ip_hdr is IP header of packet with len captured
+ * bytes and ifindex is index of interface packet was received on (used as scope of IPv6 link-local
+ * addresses). dst_addr is filled by destination address and port of packet. If msg is not NULL,
+ * from_addr, ttl, recv_size (-4 if packet is truncated) and data (pointing directly to packet)
+ * are filled. Packet is validated same way with or without msg, so backends can count packets
+ * with msg set to NULL and receive exactly same packets later.
+ * Function returns 0 on success or -1 if packet is not valid UDP packet.
+ */
+int
+pkt_parse_udp(const unsigned char *ip_hdr, size_t len, int ifindex,
+    struct sockaddr_storage *dst_addr, struct rs_msg *msg)
+{
+	struct sockaddr_in6 *sin6;
+	const unsigned char *udp_hdr;
+	size_t ip_hdr_len;
+	uint16_t udp_len;
+	uint8_t ttl;
+
+	memset(dst_addr, 0, sizeof(*dst_addr));
+
+	if (len < 1) {
+		return (-1);
+	}
+
+	switch (ip_hdr[0] >> 4) {
+	case 4:
+		ip_hdr_len = (ip_hdr[0] & 0x0f) * 4;
+		if (len < PKT_IPV4_HDR_LEN || ip_hdr_len < PKT_IPV4_HDR_LEN ||
+		    len < ip_hdr_len + PKT_UDP_HDR_LEN || ip_hdr[9] != IPPROTO_UDP) {
+			return (-1);
+		}
+
+		udp_hdr = ip_hdr + ip_hdr_len;
+		ttl = ip_hdr[8];
+
+		dst_addr->ss_family = AF_INET;
+		memcpy(&((struct sockaddr_in *)dst_addr)->sin_addr, ip_hdr + 16,
+		    sizeof(struct in_addr));
+		memcpy(&((struct sockaddr_in *)dst_addr)->sin_port, udp_hdr + 2, sizeof(uint16_t));
+
+		if (msg != NULL) {
+			memset(&msg->from_addr, 0, sizeof(msg->from_addr));
+			msg->from_addr.ss_family = AF_INET;
+			memcpy(&((struct sockaddr_in *)&msg->from_addr)->sin_addr, ip_hdr + 12,
+			    sizeof(struct in_addr));
+			memcpy(&((struct sockaddr_in *)&msg->from_addr)->sin_port, udp_hdr,
+			    sizeof(uint16_t));
+		}
+		break;
+	case 6:
+		ip_hdr_len = PKT_IPV6_HDR_LEN;
+		if (len < ip_hdr_len + PKT_UDP_HDR_LEN || ip_hdr[6] != IPPROTO_UDP) {
+			return (-1);
+		}
+
+		udp_hdr = ip_hdr + ip_hdr_len;
+		ttl = ip_hdr[7];
+
+		dst_addr->ss_family = AF_INET6;
+		memcpy(&((struct sockaddr_in6 *)dst_addr)->sin6_addr, ip_hdr + 24,
+		    sizeof(struct in6_addr));
+		memcpy(&((struct sockaddr_in6 *)dst_addr)->sin6_port, udp_hdr + 2,
+		    sizeof(uint16_t));
+
+		if (msg != NULL) {
+			memset(&msg->from_addr, 0, sizeof(msg->from_addr));
+			sin6 = (struct sockaddr_in6 *)&msg->from_addr;
+			sin6->sin6_family = AF_INET6;
+			memcpy(&sin6->sin6_addr, ip_hdr + 8, sizeof(struct in6_addr));
+			memcpy(&sin6->sin6_port, udp_hdr, sizeof(uint16_t));
+
+			if (IN6_IS_ADDR_LINKLOCAL(&sin6->sin6_addr)) {
+				sin6->sin6_scope_id = ifindex;
+			}
+		}
+		break;
+	default:
+		return (-1);
+	}
+
+	memcpy(&udp_len, udp_hdr + 4, sizeof(udp_len));
+	udp_len = ntohs(udp_len);
+
+	if (udp_len < PKT_UDP_HDR_LEN) {
+		return (-1);
+	}
+
+	if (msg == NULL) {
+		return (0);
+	}
+
+	msg->data = (const char *)udp_hdr + PKT_UDP_HDR_LEN;
+	msg->ttl = ttl;
+
+	if (len < ip_hdr_len + udp_len) {
+		DEBUG2_PRINTF("Packet truncated");
+		msg->recv_size = -4;
+	} else {
+		msg->recv_size = udp_len - PKT_UDP_HDR_LEN;
+	}
+
+	return (0);
+}
+
+/*
+ * Receive batch of messages for socket sock from current block of ring (recv_batch function of
+ * packet backend). Arguments and return values are same as for rs_receive_msgs, but data of
+ * messages points directly to ring.
+ */
+static int
+pkt_recv_batch(int sock, struct rs_msg *msgs, int no_msgs)
+{
+#ifdef PKT_TPACKET_V3
+	struct sockaddr_storage dst_addr;
+	struct pkt_sock *psock;
+	struct tpacket3_hdr *hdr;
+	uint32_t no_pkts;
+	uint32_t pkt_i;
+	int no_recv;
+	int sock_i;
+
+	for (sock_i = 0; sock_i < pkt_ring.no_socks; sock_i++) {
+		if (pkt_ring.socks[sock_i].sock == sock) {
+			break;
+		}
+	}
+
+	if (sock_i == pkt_ring.no_socks || !pkt_ring.block_held) {
+		return (0);
+	}
+
+	psock = &pkt_ring.socks[sock_i];
+	hdr = pkt_ring.cursors[sock_i];
+	pkt_i = pkt_ring.cursor_idxs[sock_i];
+	no_pkts = pkt_block_desc(pkt_ring.cur_block)->hdr.bh1.num_pkts;
+	no_recv = 0;
+
+	while (psock->no_pending > 0 && no_recv < no_msgs && pkt_i < no_pkts) {
+		if (pkt_parse(hdr, &dst_addr, &msgs[no_recv]) == 0 &&
+		    pkt_socks_find(pkt_ring.socks, pkt_ring.no_socks, &dst_addr) == sock_i) {
+			psock->no_pending--;
+			no_recv++;
+		}
+
+		hdr = (struct tpacket3_hdr *)((char *)hdr + hdr->tp_next_offset);
+		pkt_i++;
+	}
+
+	if (pkt_i >= no_pkts) {
+		/*
+		 * End of block. Never walk past last packet of block.
+		 */
+		psock->no_pending = 0;
+	}
+
+	pkt_ring.cursors[sock_i] = hdr;
+	pkt_ring.cursor_idxs[sock_i] = pkt_i;
+
+	return (no_recv);
+#else
+	return (0);
+#endif
+}
+
+/*
+ * Find socket which receives packet with dst_addr destination address and port. psocks is array
+ * of no_socks sockets. Multicast packet is received by socket bound to multicast or any address,
+ * unicast packet by socket bound to dst_addr.
+ * Function returns index of socket or -1 if no such socket exists.
+ */
+int
+pkt_socks_find(const struct pkt_sock *psocks, int no_socks,
+    const struct sockaddr_storage *dst_addr)
+{
+	const struct pkt_sock *psock;
+	int i;
+	int mcast;
+
+	mcast = af_is_sa_mcast(AF_CAST_SA(dst_addr));
+
+	for (i = 0; i < no_socks; i++) {
+		psock = &psocks[i];
+
+		if (psock->bound_addr.ss_family != dst_addr->ss_family ||
+		    af_sa_port(AF_CAST_SA(&psock->bound_addr)) !=
+		    af_sa_port(AF_CAST_SA(dst_addr)) || psock->mcast != mcast) {
+			continue;
+		}
+
+		if (mcast || af_sockaddr_eq(AF_CAST_SA(&psock->bound_addr), AF_CAST_SA(dst_addr))) {
+			return (i);
+		}
+	}
+
+	return (-1);
+}
+
+/*
+ * Initialize array psocks of no_socks (at most RS_MAX_POLL_SOCKS) items from socks array of
+ * sockets. Bound address of every socket is stored and socket bound to multicast or any address
+ * is marked as multicast one.
+ * Function returns 0 on success, otherwise -1 (errno is set).
+ */
+int
+pkt_socks_init(struct pkt_sock *psocks, const int *socks, int no_socks)
+{
+	struct pkt_sock *psock;
+	socklen_t addr_len;
+	int i;
+
+	if (no_socks > RS_MAX_POLL_SOCKS) {
+		errno = EINVAL;
+		return (-1);
+	}
+
+	memset(psocks, 0, sizeof(*psocks) * no_socks);
+
+	for (i = 0; i < no_socks; i++) {
+		psock = &psocks[i];
+		psock->sock = socks[i];
+
+		addr_len = sizeof(psock->bound_addr);
+		if (getsockname(socks[i], AF_CAST_SA(&psock->bound_addr), &addr_len) == -1) {
+			return (-1);
+		}
+
+		psock->mcast = af_is_sa_mcast(AF_CAST_SA(&psock->bound_addr));
+
+		if (psock->bound_addr.ss_family == AF_INET6) {
+			psock->mcast |= IN6_IS_ADDR_UNSPECIFIED(
+			    &((struct sockaddr_in6 *)&psock->bound_addr)->sin6_addr);
+		} else {
+			psock->mcast |=
+			    (((struct sockaddr_in *)&psock->bound_addr)->sin_addr.s_addr ==
+			    htonl(INADDR_ANY));
+		}
+	}
+
+	return (0);
+}
+
+/*
+ * Wait for events (wait function of packet backend). Arguments and return values are same as for
+ * socket backend, but socks are polled only for error queue and socket is readable if current
+ * block of ring contains packets for it. Block is passed back to kernel when all its packets were
+ * received. -3 is returned if block contains no packet for any socket.
+ */
+static int
+pkt_wait(const int *socks, int no_socks, int timeout, int spin, int *sock_events)
+{
+#ifdef PKT_TPACKET_V3
+	struct pollfd pfds[RS_MAX_POLL_SOCKS + 1];
+	struct timeval start_time;
+	int i;
+	int poll_res;
+	int poll_timeout;
+	int res;
+
+	if (pkt_ring.block_held) {
+		for (i = 0; i < pkt_ring.no_socks; i++) {
+			if (pkt_ring.socks[i].no_pending > 0) {
+				break;
+			}
+		}
+
+		if (i == pkt_ring.no_socks) {
+			pkt_block_release();
+		}
+	}
+
+	if (!pkt_ring.block_held) {
+		pkt_block_acquire();
+	}
+
+	memset(pfds, 0, sizeof(struct pollfd) * (no_socks + 1));
+
+	pfds[0].fd = pkt_ring.fd;
+	pfds[0].events = POLLIN;
+
+	for (i = 0; i < no_socks; i++) {
+		pfds[i + 1].fd = socks[i];
+	}
+
+	poll_timeout = (pkt_ring.block_held ? 0 : timeout);
+
+	if (spin) {
+		start_time = util_get_time();
+
+		do {
+			poll_res = poll(pfds, no_socks + 1, 0);
+		} while (poll_res == 0 &&
+		    (int)util_time_absdiff(start_time, util_get_time()) < poll_timeout);
+	} else {
+		poll_res = poll(pfds, no_socks + 1, poll_timeout);
+	}
+
+	if (poll_res == -1) {
+		if (errno == EINTR) {
+			DEBUG2_PRINTF("poll error - EINTR");
+			return (-2);
+		} else {
+			DEBUG2_PRINTF("poll error - errno = %d", errno);
+			return (-1);
+		}
+	}
+
+	if (poll_res == 0 && !pkt_ring.block_held) {
+		return (0);
+	}
+
+	if (pfds[0].revents & POLLERR || pfds[0].revents & POLLHUP ||
+	    pfds[0].revents & POLLNVAL) {
+		DEBUG2_PRINTF("poll error. ring revents = %d", pfds[0].revents);
+		return (-1);
+	}
+
+	if (!pkt_ring.block_held) {
+		pkt_block_acquire();
+	}
+
+	res = 0;
+
+	for (i = 0; i < no_socks; i++) {
+		sock_events[i] = 0;
+
+#ifdef MSG_ERRQUEUE
+		if (pfds[i + 1].revents & POLLERR) {
+			pfds[i + 1].revents &= ~POLLERR;
+			sock_events[i] |= RS_EV_ERR;
+		}
+#endif
+
+		if (pfds[i + 1].revents & POLLERR || pfds[i + 1].revents & POLLHUP ||
+		    pfds[i + 1].revents & POLLNVAL) {
+			DEBUG2_PRINTF("poll error. pfds[%d] revents = %d", i + 1,
+			    pfds[i + 1].revents);
+			return (-1);
+		}
+
+		if (pkt_ring.block_held && pkt_ring.socks[i].no_pending > 0) {
+			sock_events[i] |= RS_EV_READ;
+		}
+
+		if (sock_events[i] != 0) {
+			res++;
+		}
+	}
+
+	return (res > 0 ? res : -3);
+#else
+	return (-1);
+#endif
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+ * FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Author: agent <agent@local>
+ */
+
+#ifndef _PKTFUNC_H_
+#define _PKTFUNC_H_
+
+#include "rsfunc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Size of Ethernet, IPv4 (without options), IPv6 and UDP header
+ */
+#define PKT_ETH_HDR_LEN		14
+#define PKT_IPV4_HDR_LEN	20
+#define PKT_IPV6_HDR_LEN	40
+#define PKT_UDP_HDR_LEN		8
+
+/*
+ * Socket of omping used by backends which receive packets outside of sockets. bound_addr is
+ * address socket is bound to, mcast is set if socket receives multicast packets (it's bound to
+ * multicast or any address), no_pending is number of received packets for socket not yet passed
+ * to omping and sock is socket.
+ */
+struct pkt_sock {
+	struct sockaddr_storage bound_addr;
+	int	mcast;
+	int	no_pending;
+	int	sock;
+};
+
+/*
+ * Receive only transport backend using AF_PACKET TPACKET_V3 mmap ring
+ */
+extern const struct rs_backend	pkt_backend;
+
+extern int	pkt_parse_udp(const unsigned char *ip_hdr, size_t len, int ifindex,
+    struct sockaddr_storage *dst_addr, struct rs_msg *msg);
+
+extern int	pkt_socks_find(const struct pkt_sock *psocks, int no_socks,
+    const struct sockaddr_storage *dst_addr);
+
+extern int	pkt_socks_init(struct pkt_sock *psocks, const int *socks, int no_socks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PKTFUNC_H_ */
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+ * FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Author: agent <agent@local>
+ */
+
+#include <inttypes.h>
+
+#include "proffunc.h"
+
+static int	prof_run_over(const struct prof_item *prof);
+
+/*
+ * Initialize schedule of profile prof. start_ms is start time of omping in ms. First run
+ * starts offset ms later.
+ */
+void
+prof_init(struct prof_item *prof, uint64_t start_ms)
+{
+
+	prof->run_start = start_ms + prof->offset;
+	prof->next_round = prof->run_start;
+	prof->no_runs = 0;
+}
+
+/*
+ * Test if round of queries of profile prof should be sent at now_ms time (in ms). If so, time of
+ * next round is moved by one interval. Rounds stay on grid of run start, but if round is late
+ * by more then interval (stalled process), grid is restarted from now_ms, so missed rounds are not
+ * sent in burst. Runs which ended in meantime are skipped. First round of run increases
+ * prof->no_runs.
+ * Function returns 1 if round should be sent, otherwise 0.
+ */
+int
+prof_round_due(struct prof_item *prof, uint64_t now_ms)
+{
+
+	if (prof_run_over(prof)) {
+		if (prof->period == 0) {
+			prof->next_round = PROF_NEVER;
+
+			return (0);
+		}
+
+		do {
+			prof->run_start += prof->period;
+		} while (prof->run_start + prof->duration <= now_ms);
+
+		prof->next_round = prof->run_start;
+	}
+
+	if (now_ms < prof->next_round) {
+		return (0);
+	}
+
+	if (prof->next_round == prof->run_start) {
+		prof->no_runs++;
+	}
+
+	prof->next_round += prof->interval;
+	if (prof->next_round <= now_ms) {
+		prof->next_round = now_ms + prof->interval;
+	}
+
+	return (1);
+}
+
+/*
+ * Test if current run of profile prof is over, so next round belongs to next run (or profile
+ * never runs again).
+ * Function returns 1 if run is over, otherwise 0.
+ */
+static int
+prof_run_over(const struct prof_item *prof)
+{
+
+	if (prof->next_round == PROF_NEVER) {
+		return (1);
+	}
+
+	return (prof->duration > 0 && prof->next_round >= prof->run_start + prof->duration);
+}
+
+/*
+ * Return time in ms (from now_ms) until next round of profile prof should be sent (0 if it's
+ * already late) or -1 if profile never runs again.
+ */
+int
+prof_wait_time(const struct prof_item *prof, uint64_t now_ms)
+{
+	uint64_t next;
+
+	if (prof_run_over(prof)) {
+		if (prof->period == 0) {
+			return (-1);
+		}
+
+		next = prof->run_start + prof->period;
+	} else {
+		next = prof->next_round;
+	}
+
+	return (next > now_ms ? (int)(next - now_ms) : 0);
+}
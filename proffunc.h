@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+ * FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Author: agent <agent@local>
+ */
+
+#ifndef _PROFFUNC_H_
+#define _PROFFUNC_H_
+
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Maximum number of profiles, maximum length of profile name (including terminating zero),
+ * maximum number of queries sent to every remote host in one round and maximum size of query
+ * of profile in bytes
+ */
+#define PROF_MAX		8
+#define PROF_NAME_LEN		16
+#define PROF_MAX_BURST		64
+#define PROF_MAX_SIZE		9000
+
+/*
+ * Time of next round of profile which will never run again
+ */
+#define PROF_NEVER		((uint64_t)~0)
+
+/*
+ * Test profile. Profile sends rounds of queries (burst queries to every remote host) every
+ * interval ms. Queries are sent only during runs. First run starts offset ms after start of
+ * omping and lasts duration ms (0 means run never ends). If period is not 0, next run starts
+ * period ms after start of previous one. count is maximum number of queries sent to one remote
+ * host in one run (0 means no limit), size is size of query in bytes (0 for unpadded query) and
+ * tclass is traffic class of queries or -1. Times are in ms. run_start is start time of current
+ * (or next) run, next_round is time of next round and no_runs is number of started runs.
+ */
+struct prof_item {
+	char		name[PROF_NAME_LEN];
+	uint64_t	count;
+	uint64_t	next_round;
+	uint64_t	no_runs;
+	uint64_t	run_start;
+	int		burst;
+	int		duration;
+	int		interval;
+	int		offset;
+	int		period;
+	int		size;
+	int		tclass;
+};
+
+extern void	prof_init(struct prof_item *prof, uint64_t start_ms);
+
+extern int	prof_round_due(struct prof_item *prof, uint64_t now_ms);
+
+extern int	prof_wait_time(const struct prof_item *prof, uint64_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PROFFUNC_H_ */
@@ -32,8 +32,76 @@
 #include <string.h>
 #include <stdarg.h>
 
+#include "logging.h"
 #include "rhfunc.h"
 #include "omping.h"
+#include "util.h"
+
+/*
+ * Fill receive part of peer_stats (used in stats report message) from client information ci.
+ * no_sent is set to 0, because number of sent queries is updated by send loop and it's filled by
+ * caller. Counters bigger then 32-bit (or 16-bit for histogram) are saturated.
+ */
+void
+rh_ci_fill_peer_stats(const struct rh_item_ci *ci, struct tlv_peer_stats *peer_stats)
+{
+	int i, j;
+
+	memset(peer_stats, 0, sizeof(*peer_stats));
+
+	for (i = 0; i < 2; i++) {
+		peer_stats->no_received[i] = (ci->cast_stats[i].no_received > UINT32_MAX ?
+		    UINT32_MAX : ci->cast_stats[i].no_received);
+
+		if (ci->cast_stats[i].no_rtt > 0) {
+			peer_stats->avg_rtt_us[i] = (uint32_t)(ci->cast_stats[i].avg_rtt / 1000.0);
+		}
+
+		for (j = 0; j < TLV_RTT_HIST_BUCKETS; j++) {
+			peer_stats->rtt_hist[i][j] = (ci->rtt_hist[i][j] > UINT16_MAX ?
+			    UINT16_MAX : ci->rtt_hist[i][j]);
+		}
+	}
+}
+
+/*
+ * Account received answer with sequence number seq and cast_index type to statistics of its flow.
+ * rtt_set is nonzero if packet is not part of warm-up phase and rtt (in ns) is valid. Function
+ * does nothing if ci doesn't have flows (multipath mode is disabled).
+ */
+void
+rh_ci_flow_received(struct rh_item_ci *ci, int cast_index, uint32_t seq, int rtt_set, double rtt)
+{
+	struct rh_item_flow *flow;
+
+	if (ci->no_flows <= 1) {
+		return ;
+	}
+
+	flow = &ci->flows[seq % ci->no_flows];
+	flow->no_received[cast_index]++;
+
+	if (rtt_set) {
+		flow->no_rtt[cast_index]++;
+		util_ov_update(&flow->avg_rtt[cast_index], &flow->m2_rtt[cast_index], rtt,
+		    flow->no_rtt[cast_index]);
+	}
+}
+
+/*
+ * Account sent query with sequence number seq to statistics of its flow. Function does nothing
+ * if ci doesn't have flows (multipath mode is disabled).
+ */
+void
+rh_ci_flow_sent(struct rh_item_ci *ci, uint32_t seq)
+{
+
+	if (ci->no_flows <= 1) {
+		return ;
+	}
+
+	ci->flows[seq % ci->no_flows].no_sent++;
+}
 
 /*
  * Function to test if packet is duplicate. ci is client item information, seq is sequential number
@@ -57,67 +125,556 @@ rh_ci_is_dup_packet(const struct rh_item_ci *ci, uint32_t seq, int cast_index)
 }
 
 /*
- * Add item to remote host list. Addr pointer is stored in rh_item. On fail, function returns NULL,
- * otherwise newly allocated rh_item is returned. dup_buf_items is number of items to be stored in
- * duplicate buffers. rate_limit_time is maximum time between two received packets.
+ * Return number of sent packets which server should answer. ci is client item information and
+ * sent is number of sent packets. Queries throttled by server rate limit are not counted, so they
+ * are not reported as lost.
+ */
+uint64_t
+rh_ci_answerable(const struct rh_item_ci *ci, uint64_t sent)
+{
+
+	if (ci->no_throttled > sent) {
+		return (0);
+	}
+
+	return (sent - ci->no_throttled);
+}
+
+/*
+ * Account received answer to query of test profile with profile index to statistics of ci. Answer
+ * is of cast_index type. rtt_set is nonzero if rtt (in ns) is valid. Caller is responsible for
+ * ignoring answers with sequence number which was never sent by profile.
+ */
+void
+rh_ci_prof_received(struct rh_item_ci *ci, int profile, int cast_index, int rtt_set, double rtt)
+{
+	struct rh_item_prof *prof;
+	uint64_t received;
+
+	prof = &ci->profiles[profile];
+
+	received = ++prof->no_received[cast_index];
+
+	if (!rtt_set) {
+		return ;
+	}
+
+	util_ov_update(&prof->avg_rtt[cast_index], &prof->m2_rtt[cast_index], rtt, received);
+
+	if (received == 1 || rtt > prof->rtt_max[cast_index]) {
+		prof->rtt_max[cast_index] = rtt;
+	}
+
+	if (received == 1 || rtt < prof->rtt_min[cast_index]) {
+		prof->rtt_min[cast_index] = rtt;
+	}
+}
+
+/*
+ * Start new session in server statistics of ci. Last report of previous session is added to base
+ * values.
+ */
+void
+rh_ci_srv_stats_new_session(struct rh_item_ci *ci)
+{
+	struct rh_item_ss *ss;
+
+	ss = &ci->srv_stats;
+
+	if (ss->ses.no_received > 0) {
+		ss->answered_base += ss->ses.no_answered;
+		ss->fwd_expected_base += (uint32_t)(ss->ses.max_seq - ss->ses.first_seq) + 1;
+		ss->fwd_received_base += ss->ses.no_received;
+	}
+
+	memset(&ss->ses, 0, sizeof(ss->ses));
+}
+
+/*
+ * Store server statistics report server_stats received in answer with cast_index type (unicast =
+ * 0, multicast/broadcast = 1) into ci. Number of answers received by client is stored together
+ * with report, so reverse path loss is computed from same moment as server counters.
+ */
+void
+rh_ci_srv_stats_update(struct rh_item_ci *ci, int cast_index,
+    const struct tlv_server_stats *server_stats)
+{
+	struct rh_item_ss *ss;
+
+	ss = &ci->srv_stats;
+
+	ss->ses = *server_stats;
+	ss->rev_answered[cast_index] = ss->answered_base + server_stats->no_answered;
+	ss->rev_received[cast_index] = ci->cast_stats[cast_index].no_received;
+	ss->isset = 1;
+}
+
+/*
+ * Add rtt (in ns) of packet with cast_index type to RTT histogram of ci. See TLV_RTT_HIST_BUCKETS
+ * for bucket boundaries.
+ */
+void
+rh_ci_rtt_hist_add(struct rh_item_ci *ci, int cast_index, double rtt)
+{
+	uint64_t rtt_us;
+	int bucket;
+
+	rtt_us = (uint64_t)(rtt / 1000.0) >> 5;
+
+	for (bucket = 0; rtt_us > 0 && bucket < TLV_RTT_HIST_BUCKETS - 1; bucket++) {
+		rtt_us >>= 1;
+	}
+
+	if (ci->rtt_hist[cast_index][bucket] < UINT32_MAX) {
+		ci->rtt_hist[cast_index][bucket]++;
+	}
+}
+
+/*
+ * Update warm-up statistics. ci is client item information, cast_index is type of packet received
+ * (unicast = 0, multicast/broadcast = 1), rtt is round trip time of packet in ns and
+ * rp_timestamp is receiving time of packet. warmup_time is length of warm-up phase in ms
+ * counted from session establishment, WARMUP_AUTO for automatic detection of steady state or
+ * 0 if warm-up is disabled. Automatic detection computes standard deviation of RTT in windows of
+ * WARMUP_WIN_ITEMS packets and warm-up ends when standard deviation of two consecutive windows
+ * differs by less then WARMUP_STABLE_PCT percent (or WARMUP_STABLE_MIN_NS) or after
+ * WARMUP_AUTO_MAX_ITEMS packets.
+ * Function returns 1 if packet belongs to warm-up phase (and it's accounted in warm-up statistics),
+ * otherwise 0.
+ */
+int
+rh_ci_warmup_update(struct rh_item_ci *ci, int cast_index, double rtt,
+    struct timeval rp_timestamp, int warmup_time)
+{
+	struct rh_item_wu *wu;
+	double std_dev;
+	double tolerance;
+
+	wu = &ci->warmup[cast_index];
+
+	if (warmup_time == 0 || wu->finished) {
+		return (0);
+	}
+
+	if (warmup_time > 0 &&
+	    util_time_absdiff(ci->est_ts, rp_timestamp) >= (uint64_t)warmup_time) {
+		wu->finished = 1;
+
+		return (0);
+	}
+
+	if (warmup_time == WARMUP_AUTO) {
+		if (wu->no_received >= WARMUP_AUTO_MAX_ITEMS) {
+			wu->finished = 1;
+
+			return (0);
+		}
+
+		wu->win_items++;
+		util_ov_update(&wu->win_avg_rtt, &wu->win_m2_rtt, rtt, wu->win_items);
+
+		if (wu->win_items == WARMUP_WIN_ITEMS) {
+			std_dev = util_ov_std_dev(wu->win_m2_rtt, wu->win_items);
+
+			if (wu->no_received >= WARMUP_WIN_ITEMS) {
+				tolerance = wu->win_prev_std_dev * WARMUP_STABLE_PCT / 100.0;
+				if (tolerance < WARMUP_STABLE_MIN_NS) {
+					tolerance = WARMUP_STABLE_MIN_NS;
+				}
+
+				if (util_fabs(std_dev - wu->win_prev_std_dev) <= tolerance) {
+					/*
+					 * Steady state reached. This packet is first one of
+					 * steady state.
+					 */
+					wu->finished = 1;
+
+					return (0);
+				}
+			}
+
+			wu->win_prev_std_dev = std_dev;
+			wu->win_avg_rtt = wu->win_m2_rtt = 0;
+			wu->win_items = 0;
+		}
+	}
+
+	wu->no_received++;
+	util_ov_update(&wu->avg_rtt, &wu->m2_rtt, rtt, wu->no_received);
+
+	if (wu->no_received == 1 || rtt > wu->rtt_max) {
+		wu->rtt_max = rtt;
+	}
+
+	if (wu->no_received == 1 || rtt < wu->rtt_min) {
+		wu->rtt_min = rtt;
+	}
+
+	return (1);
+}
+
+/*
+ * Return number of bytes allocated from arena for one remote host by rh_list_add_item and
+ * rh_list_alloc_cast_stats. dup_buf_items is number of items stored in duplicate buffers.
+ */
+size_t
+rh_item_alloc_size(int dup_buf_items)
+{
+	size_t dup_buf_size;
+
+	dup_buf_size = (dup_buf_items * sizeof(uint32_t) + AR_ALIGN - 1) & ~((size_t)AR_ALIGN - 1);
+
+	return (((sizeof(struct rh_item) + AR_ALIGN - 1) & ~((size_t)AR_ALIGN - 1)) +
+	    2 * dup_buf_size + 2 * sizeof(struct rh_cast_stats));
+}
+
+/*
+ * Return address part of sockaddr sa (without port). Length of address is stored in addr_len.
+ */
+static const unsigned char *
+rh_sa_addr(const struct sockaddr *sa, size_t *addr_len)
+{
+
+	switch (sa->sa_family) {
+	case AF_INET:
+		*addr_len = sizeof(struct in_addr);
+		return ((const unsigned char *)&((const struct sockaddr_in *)sa)->sin_addr);
+		/* NOTREACHED */
+		break;
+	case AF_INET6:
+		*addr_len = sizeof(struct in6_addr);
+		return ((const unsigned char *)&((const struct sockaddr_in6 *)sa)->sin6_addr);
+		/* NOTREACHED */
+		break;
+	default:
+		DEBUG_PRINTF("Internal program error");
+		errx(1, "Internal program error");
+		/* NOTREACHED */
+	}
+
+	return (NULL);
+}
+
+/*
+ * Return hash of client id client_id with CLIENTID_LEN length. FNV-1a hash function is used.
+ */
+static uint32_t
+rh_si_cid_hash(const char *client_id)
+{
+	uint32_t hash;
+	size_t i;
+
+	hash = 2166136261U;
+
+	for (i = 0; i < CLIENTID_LEN; i++) {
+		hash ^= (unsigned char)client_id[i];
+		hash *= 16777619U;
+	}
+
+	return (hash);
+}
+
+/*
+ * Test if init message with client_id (client_id_len long) is retransmission of init message
+ * which created current session of si. Client id is compared only by hash.
+ * Function returns 1 if message is retransmission, otherwise 0.
+ */
+int
+rh_si_is_retrans(const struct rh_item_si *si, const char *client_id, size_t client_id_len)
+{
+
+	return (si->state == RH_SS_ANSWER && client_id_len == CLIENTID_LEN &&
+	    (si->flags & RH_SIF_CID_SET) && si->cid_hash == rh_si_cid_hash(client_id));
+}
+
+/*
+ * Start new session of si created by init message of client with client_id (client_id_len long,
+ * or 0 if message doesn't contain client id) received at rp_timestamp. Statistics are cleared
+ * and new session token is generated. min_init_time is minimal time in ms between two sessions.
+ * Function returns 0 on success, or -1 if previous session was created less then min_init_time ms
+ * ago (si is not changed).
+ */
+int
+rh_si_new_session(struct rh_item_si *si, const char *client_id, size_t client_id_len,
+    struct timeval rp_timestamp, unsigned int min_init_time)
+{
+	uint32_t now_ms;
+	uint64_t gcra_tat;
+
+	now_ms = (uint32_t)util_tv_to_ms(rp_timestamp);
+
+	if ((si->flags & RH_SIF_INIT_SET) && now_ms - si->last_init_ms < min_init_time) {
+		return (-1);
+	}
+
+	gcra_tat = si->gcra_tat;
+	memset(si, 0, sizeof(*si));
+	si->gcra_tat = gcra_tat;
+
+	util_gen_sid(si->ses_id);
+
+	si->state = RH_SS_ANSWER;
+	si->last_init_ms = now_ms;
+	si->flags = RH_SIF_INIT_SET;
+
+	if (client_id_len == CLIENTID_LEN) {
+		si->cid_hash = rh_si_cid_hash(client_id);
+		si->flags |= RH_SIF_CID_SET;
+	}
+
+	return (0);
+}
+
+/*
+ * Update server side receive statistics of client. si is server info of client, seq is sequence
+ * number of received query, client_tstamp is client timestamp from query (valid only if
+ * client_tstamp_isset is set) and rp_timestamp is receiving time of query. Interarrival jitter is
+ * computed as in RFC 3550.
+ */
+void
+rh_si_stats_update(struct rh_item_si *si, uint32_t seq, int client_tstamp_isset,
+    struct timeval client_tstamp, struct timeval rp_timestamp)
+{
+	int64_t transit;
+	float d;
+
+	if (si->no_received == 0) {
+		si->first_seq = si->max_seq = seq;
+	} else if ((int32_t)(seq - si->max_seq) > 0) {
+		si->max_seq = seq;
+	}
+
+	si->no_received++;
+
+	if (client_tstamp_isset) {
+		/*
+		 * Clocks of client and server are not synchronized, so transit can be negative
+		 */
+		transit = ((int64_t)util_tv_to_ns(rp_timestamp) -
+		    (int64_t)util_tv_to_ns(client_tstamp)) / 1000;
+
+		if (si->flags & RH_SIF_TRANSIT_SET) {
+			d = (float)(transit - si->last_transit);
+
+			if (d < 0) {
+				d = -d;
+			}
+
+			si->jitter += (d - si->jitter) / 16.0f;
+		}
+
+		si->last_transit = transit;
+		si->flags |= RH_SIF_TRANSIT_SET;
+	}
+}
+
+/*
+ * Return number of bytes allocated from arena by rh_si_table_create for table of no_items
+ * addresses of family.
+ */
+size_t
+rh_si_table_alloc_size(unsigned int no_items, int family)
+{
+	size_t key_len;
+	size_t no_buckets;
+
+	key_len = (family == AF_INET6 ? sizeof(struct in6_addr) : sizeof(struct in_addr));
+
+	for (no_buckets = 1; no_buckets < 2 * (size_t)no_items; no_buckets <<= 1)
+		;
+
+	return (no_items * sizeof(struct rh_item_si) + no_items * key_len +
+	    no_buckets * sizeof(uint32_t) + 3 * AR_ALIGN);
+}
+
+/*
+ * Create server info table with every address from remote_addrs. Arrays of table are allocated
+ * from arena. Hash table has power of two buckets and is at most half full. Duplicate addresses
+ * are stored only once.
+ */
+void
+rh_si_table_create(struct rh_si_table *table, struct ar_arena *arena,
+    struct aii_list *remote_addrs)
+{
+	const struct sockaddr *sa;
+	const unsigned char *addr;
+	struct ai_item *ai_item;
+	size_t addr_len;
+	unsigned int no_addrs;
+	uint32_t bucket;
+
+	memset(table, 0, sizeof(*table));
+
+	no_addrs = 0;
+	TAILQ_FOREACH(ai_item, remote_addrs, entries) {
+		no_addrs++;
+	}
+
+	if (no_addrs == 0) {
+		return ;
+	}
+
+	table->family = TAILQ_FIRST(remote_addrs)->sas.ss_family;
+	rh_sa_addr((const struct sockaddr *)&TAILQ_FIRST(remote_addrs)->sas, &table->key_len);
+
+	for (table->no_buckets = 1; table->no_buckets < 2 * no_addrs; table->no_buckets <<= 1)
+		;
+
+	table->items = (struct rh_item_si *)ar_alloc(arena,
+	    no_addrs * sizeof(struct rh_item_si));
+	table->keys = (unsigned char *)ar_alloc(arena, no_addrs * table->key_len);
+	table->buckets = (uint32_t *)ar_alloc(arena, table->no_buckets * sizeof(uint32_t));
+
+	if (table->items == NULL || table->keys == NULL || table->buckets == NULL) {
+		errx(1, "Can't alloc memory");
+	}
+
+	TAILQ_FOREACH(ai_item, remote_addrs, entries) {
+		sa = (const struct sockaddr *)&ai_item->sas;
+
+		if (sa->sa_family != table->family) {
+			DEBUG_PRINTF("Internal program error");
+			errx(1, "Internal program error");
+		}
+
+		if (rh_si_table_find(table, sa) != NULL) {
+			continue;
+		}
+
+		addr = rh_sa_addr(sa, &addr_len);
+		memcpy(table->keys + table->no_items * table->key_len, addr, addr_len);
+
+		bucket = af_sa_hash(sa) & (table->no_buckets - 1);
+		while (table->buckets[bucket] != 0) {
+			bucket = (bucket + 1) & (table->no_buckets - 1);
+		}
+
+		table->buckets[bucket] = ++table->no_items;
+	}
+}
+
+/*
+ * Find server info of client with addr sa in table. Pointer to server info is returned on success
+ * otherwise NULL is returned.
+ */
+struct rh_item_si *
+rh_si_table_find(const struct rh_si_table *table, const struct sockaddr *sa)
+{
+	const unsigned char *addr;
+	size_t addr_len;
+	uint32_t bucket;
+	uint32_t index;
+
+	if (table->no_buckets == 0 || sa->sa_family != table->family) {
+		return (NULL);
+	}
+
+	addr = rh_sa_addr(sa, &addr_len);
+
+	bucket = af_sa_hash(sa) & (table->no_buckets - 1);
+	while ((index = table->buckets[bucket]) != 0) {
+		if (memcmp(table->keys + (index - 1) * table->key_len, addr, addr_len) == 0) {
+			return (&table->items[index - 1]);
+		}
+
+		bucket = (bucket + 1) & (table->no_buckets - 1);
+	}
+
+	return (NULL);
+}
+
+/*
+ * Return number of bytes used by arrays of table.
+ */
+size_t
+rh_si_table_mem_size(const struct rh_si_table *table)
+{
+
+	return (table->no_items * (sizeof(struct rh_item_si) + table->key_len) +
+	    table->no_buckets * sizeof(uint32_t));
+}
+
+/*
+ * Move server info of all clients in table to RH_SS_FINISHING state.
+ */
+void
+rh_si_table_put_to_finish_state(struct rh_si_table *table)
+{
+	unsigned int i;
+
+	for (i = 0; i < table->no_items; i++) {
+		table->items[i].state = RH_SS_FINISHING;
+	}
+}
+
+/*
+ * Add item to remote host list. Item and its duplicate buffers are allocated from arena. Item gets
+ * next free id and its hot statistics are items with id index in cast_stats array (see
+ * rh_list_alloc_cast_stats), so array must be big enough for all items of list. Addr pointer is
+ * stored in rh_item. On fail, function returns NULL, otherwise newly allocated rh_item is
+ * returned. dup_buf_items is number of items to be stored in duplicate buffers.
  */
 struct rh_item *
-rh_list_add_item(struct rh_list *rh_list, struct ai_item *addr, int dup_buf_items,
-    int rate_limit_time)
+rh_list_add_item(struct rh_list *rh_list, struct ar_arena *arena, struct rh_cast_stats *cast_stats,
+    struct ai_item *addr, int dup_buf_items)
 {
 	struct rh_item *rh_item;
+	struct rh_item *last_item;
 	struct rh_item_ci *ci;
 	int i;
 
-	rh_item = (struct rh_item *)malloc(sizeof(struct rh_item));
+	rh_item = (struct rh_item *)ar_alloc(arena, sizeof(struct rh_item));
 	if (rh_item == NULL) {
 		return (NULL);
 	}
 
-	memset(rh_item, 0, sizeof(struct rh_item));
+	last_item = TAILQ_LAST(rh_list, rh_list);
+	rh_item->id = (last_item != NULL ? last_item->id + 1 : 0);
 
 	rh_item->addr = addr;
 	ci = &rh_item->client_info;
+	ci->cast_stats = &cast_stats[rh_item->id * 2];
 
 	if (dup_buf_items > 0) {
 		ci->dup_buf_items = dup_buf_items;
 
 		for (i = 0; i < 2; i++) {
-			ci->dup_buffer[i] = (uint32_t *)malloc(dup_buf_items * sizeof(uint32_t));
+			ci->dup_buffer[i] = (uint32_t *)ar_alloc(arena,
+			    dup_buf_items * sizeof(uint32_t));
 
 			if (ci->dup_buffer[i] == NULL) {
-				goto malloc_error;
+				return (NULL);
 			}
-
-			memset(ci->dup_buffer[i], 0, dup_buf_items * sizeof(uint32_t));
 		}
 	}
 
-	if (rate_limit_time > 0) {
-		gcra_init(&rh_item->server_info.gcra, rate_limit_time, GCRA_BURST);
-	}
-
 	TAILQ_INSERT_TAIL(rh_list, rh_item, entries);
 
 	return (rh_item);
+}
 
-malloc_error:
-	for (i = 0; i < 2; i++) {
-		free(rh_item->client_info.dup_buffer[i]);
-	}
-	free(rh_item);
+/*
+ * Allocate array of hot statistics for no_items remote hosts from arena. Array is aligned to cache
+ * line and zeroed.
+ * Function returns pointer to array or NULL on fail.
+ */
+struct rh_cast_stats *
+rh_list_alloc_cast_stats(struct ar_arena *arena, unsigned int no_items)
+{
 
-	return (NULL);
+	return ((struct rh_cast_stats *)ar_alloc(arena,
+	    no_items * 2 * sizeof(struct rh_cast_stats)));
 }
 
 /*
  * Create list of rh_items. It's also possible to pass aii_list to include every address from list
- * to newly allocated rh_list. dup_buf_items is number of items to be stored in duplicate buffers.
- * rate_limit_time is maximum time between two received packets.
+ * to newly allocated rh_list. Items are allocated from arena and cast_stats is array of hot
+ * statistics big enough for every item (see rh_list_add_item). dup_buf_items is number of items
+ * to be stored in duplicate buffers.
  */
 void
-rh_list_create(struct rh_list *rh_list, struct aii_list *remote_addrs, int dup_buf_items,
-    int rate_limit_time)
+rh_list_create(struct rh_list *rh_list, struct ar_arena *arena, struct rh_cast_stats *cast_stats,
+    struct aii_list *remote_addrs, int dup_buf_items)
 {
 	struct ai_item *addr;
 	struct rh_item *rh_item;
@@ -126,7 +683,8 @@ rh_list_create(struct rh_list *rh_list, struct aii_list *remote_addrs, int dup_b
 
 	if (remote_addrs != NULL) {
 		TAILQ_FOREACH(addr, remote_addrs, entries) {
-			rh_item = rh_list_add_item(rh_list, addr, dup_buf_items, rate_limit_time);
+			rh_item = rh_list_add_item(rh_list, arena, cast_stats, addr,
+			    dup_buf_items);
 			if (rh_item == NULL) {
 				errx(1, "Can't alloc memory");
 			}
@@ -134,6 +692,62 @@ rh_list_create(struct rh_list *rh_list, struct aii_list *remote_addrs, int dup_b
 	}
 }
 
+/*
+ * Allocate statistics of no_flows flows for every item in rh_list from arena. tclasses is array
+ * of no_flows traffic classes of flows or NULL if flows don't have traffic class. Function returns
+ * 0 on success, otherwise -1 (and rh_list is left in state which can be freed by rh_list_free).
+ */
+int
+rh_list_alloc_flows(struct rh_list *rh_list, struct ar_arena *arena, int no_flows,
+    const int *tclasses)
+{
+	struct rh_item *rh_item;
+	struct rh_item_ci *ci;
+	int i;
+
+	TAILQ_FOREACH(rh_item, rh_list, entries) {
+		ci = &rh_item->client_info;
+
+		ci->flows = (struct rh_item_flow *)ar_alloc(arena,
+		    no_flows * sizeof(struct rh_item_flow));
+		if (ci->flows == NULL) {
+			return (-1);
+		}
+
+		ci->no_flows = no_flows;
+
+		for (i = 0; i < no_flows; i++) {
+			ci->flows[i].tclass = (tclasses != NULL ? tclasses[i] : -1);
+		}
+	}
+
+	return (0);
+}
+
+/*
+ * Allocate statistics of no_profiles test profiles for every item in rh_list from arena. Function
+ * returns 0 on success, otherwise -1 (and rh_list is left in state which can be freed by
+ * rh_list_free).
+ */
+int
+rh_list_alloc_profiles(struct rh_list *rh_list, struct ar_arena *arena, int no_profiles)
+{
+	struct rh_item *rh_item;
+	struct rh_item_ci *ci;
+
+	TAILQ_FOREACH(rh_item, rh_list, entries) {
+		ci = &rh_item->client_info;
+
+		ci->profiles = (struct rh_item_prof *)ar_alloc(arena,
+		    no_profiles * sizeof(struct rh_item_prof));
+		if (ci->profiles == NULL) {
+			return (-1);
+		}
+	}
+
+	return (0);
+}
+
 /*
  * Find remote host with addr sa in list. rh_item pointer is returned on success otherwise NULL is
  * returned.
@@ -152,31 +766,14 @@ rh_list_find(struct rh_list *rh_list, const struct sockaddr *sa)
 }
 
 /*
- * Free list from memory.
+ * Free list from memory. arena is arena items were allocated from. It's freed together with
+ * list, so all items are freed at once.
  */
 void
-rh_list_free(struct rh_list *rh_list)
+rh_list_free(struct rh_list *rh_list, struct ar_arena *arena)
 {
-	struct rh_item *rh_item;
-	struct rh_item *rh_item_next;
-	int i;
-
-	rh_item = TAILQ_FIRST(rh_list);
-
-	while (rh_item != NULL) {
-		rh_item_next = TAILQ_NEXT(rh_item, entries);
 
-		free(rh_item->client_info.server_info);
-		free(rh_item->client_info.ses_id);
-
-		for (i = 0; i < 2; i++) {
-			free(rh_item->client_info.dup_buffer[i]);
-		}
-
-		free(rh_item);
-
-		rh_item = rh_item_next;
-	}
+	ar_arena_free(arena);
 
 	TAILQ_INIT(rh_list);
 }
@@ -30,7 +30,10 @@
 #include <netdb.h>
 
 #include "addrfunc.h"
+#include "arfunc.h"
 #include "gcra.h"
+#include "lbfunc.h"
+#include "tlv.h"
 #include "util.h"
 
 #ifdef __cplusplus
@@ -55,6 +58,7 @@ enum rh_client_stop_reason {
 	RH_CSR_TO_SEND_EXHAUSTED,
 	RH_CSR_SEND_MAXIMUM,
 	RH_CSR_REMOTE_VERSION_RECEIVED,
+	RH_CSR_NO_RESPONSE,
 };
 
 enum rh_list_finish_state {
@@ -64,51 +68,182 @@ enum rh_list_finish_state {
 };
 
 /*
- * Remote host info item, client info part
+ * Remote host info item, client info part, hot statistics of one cast type updated by every
+ * received answer. Statistics of all remote hosts are stored in one array indexed by id of remote
+ * host (2 items per host, unicast and multicast) separately from rest of remote host info, and
+ * every item is padded to fill exactly one cache line. no_rtt is number of RTT samples (answers
+ * with RTT received after warm-up phase) avg_rtt, m2_rtt, rtt_max and rtt_min are computed from.
+ */
+struct rh_cast_stats {
+	double		avg_rtt;
+	double		m2_rtt;
+	double		rtt_max;
+	double		rtt_min;
+	uint64_t	no_dups;
+	uint64_t	no_received;
+	uint64_t	no_rtt;
+	char		pad[AR_ALIGN - 4 * sizeof(double) - 3 * sizeof(uint64_t)];
+};
+
+/*
+ * Remote host info item, client info part, statistics of warm-up phase for one cast type
+ */
+struct rh_item_wu {
+	double		avg_rtt;
+	double		m2_rtt;
+	double		rtt_max;
+	double		rtt_min;
+	double		win_avg_rtt;
+	double		win_m2_rtt;
+	double		win_prev_std_dev;
+	uint64_t	no_received;
+	int		finished;
+	int		win_items;
+};
+
+/*
+ * Remote host info item, client info part, server side statistics reported by server. Last report
+ * of current session is stored in ses, sum of values from previous sessions is stored in *_base
+ * fields. rev_answered and rev_received are number of answers sent by server and received by
+ * client at time of last report for given cast type.
+ */
+struct rh_item_ss {
+	struct tlv_server_stats ses;
+	uint64_t	answered_base;
+	uint64_t	fwd_expected_base;
+	uint64_t	fwd_received_base;
+	uint64_t	rev_answered[2];
+	uint64_t	rev_received[2];
+	int		isset;
+};
+
+/*
+ * Remote host info item, client info part, statistics of one flow in multipath mode. Flow of
+ * query is given by its sequence number (seq % no_flows). RTT statistics contain only packets
+ * which are not part of warm-up phase. tclass is traffic class of flow or -1 if flow doesn't have
+ * traffic class.
+ */
+struct rh_item_flow {
+	double		avg_rtt[2];
+	double		m2_rtt[2];
+	uint64_t	no_received[2];
+	uint64_t	no_rtt[2];
+	uint64_t	no_sent;
+	int		tclass;
+};
+
+/*
+ * Remote host info item, client info part, statistics of one test profile (see proffunc.h).
+ * Queries of profile have own sequence numbers (seq_num) and answers are recognized by Profile
+ * option, so statistics of profiles don't affect each other. RTT statistics are in ns. run_sent is
+ * number of queries sent in run number run.
+ */
+struct rh_item_prof {
+	double		avg_rtt[2];
+	double		m2_rtt[2];
+	double		rtt_max[2];
+	double		rtt_min[2];
+	uint64_t	no_received[2];
+	uint64_t	no_sent;
+	uint64_t	run;
+	uint64_t	run_sent;
+	uint32_t	seq_num;
+};
+
+/*
+ * Remote host info item, client info part. ses_id is session id of current session (ses_id_len
+ * is 0 if session was not established yet). txtime_next is departure time of next query in txtime
+ * mode (see omping_send_client_sched). pacer_pending is number of query rounds waiting in egress
+ * pacer queue and pacer_ts is time when oldest of them was queued. report_stats is snapshot of
+ * receive statistics for next collector report (taken by stats thread, if enabled) and
+ * report_sent is number of answerable queries at time when snapshot was requested.
  */
 struct rh_item_ci {
 	enum		rh_client_state state;
 	char		client_id[CLIENTID_LEN];
+	char		ses_id[SESSIONID_LEN];
+	struct rh_item_wu warmup[2];
+	struct rh_item_ss srv_stats;
+	struct lb_item	mcast_loss;
+	struct tlv_peer_stats report_stats;
+	struct timeval	est_ts;
+	struct timeval	first_init_ts;
 	struct timeval	last_init_ts;
 	struct timeval	last_query_ts;
+	struct timeval	pacer_ts;
+	struct timeval	unreach_ts;
+	struct rh_cast_stats *cast_stats;
+	struct rh_item_flow *flows;
+	struct rh_item_prof *profiles;
 	char		*server_info;
-	char		*ses_id;
 	uint32_t	*dup_buffer[2];
 	size_t		server_info_len;
 	size_t		ses_id_len;
-	double		avg_rtt[2];
-	double		m2_rtt[2];
-	double		rtt_max[2];
-	double		rtt_min[2];
+	double		est_time;
 	uint64_t	no_err_msgs;
-	uint64_t	no_dups[2];
-	uint64_t	no_received[2];
 	uint64_t	no_sent;
+	uint64_t	no_throttled;
+	uint64_t	no_unreach;
+	uint64_t	txtime_next;
+	uint32_t	rtt_hist[2][TLV_RTT_HIST_BUCKETS];
 	uint32_t	first_mcast_seq;
 	uint32_t	lru_seq_num; /* Last Received Unicast seq number */
+	uint32_t	report_sent;
 	uint32_t	seq_num;
+	uint32_t	ses_throttled;
 	int		dup_buf_items;
+	int		init_interval;
+	int		no_flows;
+	int		no_inits;
+	int		pacer_pending;
 	int		seq_num_overflow;
+	int		unreach_backoff;
 };
 
 /*
- * Remote host info item, server info part
+ * Remote host info item, server info part. Server keeps one item for every client, so item is kept
+ * small. Rate limit parameters are same for all clients, so only theoretical arrival time of GCRA
+ * is stored in gcra_tat. Client id is stored only as hash (cid_hash), session id (ses_id) is
+ * random for every session of every client. Times are stored as low 32 bits of time in ms and
+ * flags (RH_SIF_*) say which of them are set. jitter is interarrival jitter in us and
+ * last_transit is difference between receiving time and client timestamp of last query in us
+ * (negative if client clock is ahead of server clock).
  */
+#define RH_SIF_CID_SET		0x01
+#define RH_SIF_INIT_SET		0x02
+#define RH_SIF_STATS_SET	0x04
+#define RH_SIF_TRANSIT_SET	0x08
+
 struct rh_item_si {
-	enum			rh_server_state state;
-	char			ses_id[SESSIONID_LEN];
-	struct gcra_item	gcra;
-	struct timeval		last_init_ts;
+	char		ses_id[SESSIONID_LEN];
+	uint64_t	gcra_tat;
+	int64_t		last_transit;
+	float		jitter;
+	uint32_t	cid_hash;
+	uint32_t	first_seq;
+	uint32_t	last_init_ms;
+	uint32_t	last_stats_ms;
+	uint32_t	last_throttled_seq;
+	uint32_t	max_seq;
+	uint32_t	no_answered;
+	uint32_t	no_received;
+	uint32_t	no_throttled;
+	uint8_t		flags;
+	uint8_t		state;
 };
 
 /*
- * Remote host info item. This is intended to use with TAILQ list.
+ * Remote host info item. This is intended to use with TAILQ list. Items (together with their
+ * duplicate buffers and flows) are allocated from arena, so state of all remote hosts is stored
+ * contiguously. id is dense index of remote host (order of item in list) used as index to array
+ * of hot statistics.
  */
 struct rh_item {
 	struct ai_item	*addr;
 	struct rh_item_ci client_info;
 	struct rh_item_si server_info;
 	TAILQ_ENTRY(rh_item) entries;
+	unsigned int	id;
 };
 
 /*
@@ -116,17 +251,89 @@ struct rh_item {
  */
 TAILQ_HEAD(rh_list, rh_item);
 
+/*
+ * Server info table used by server op_mode instead of remote host list, so server doesn't keep
+ * client part of remote host info. Items, address keys (address without port, key_len bytes
+ * each) and open addressing hash table with linear probing (bucket contains index of item plus
+ * one, 0 is empty bucket) are three arrays allocated from arena. All addresses are of family.
+ */
+struct rh_si_table {
+	struct rh_item_si	*items;
+	unsigned char		*keys;
+	uint32_t		*buckets;
+	size_t			key_len;
+	unsigned int		no_buckets;
+	unsigned int		no_items;
+	int			family;
+};
+
+extern uint64_t		rh_ci_answerable(const struct rh_item_ci *ci, uint64_t sent);
+
+extern void		rh_ci_fill_peer_stats(const struct rh_item_ci *ci,
+    struct tlv_peer_stats *peer_stats);
+
+extern void		rh_ci_flow_received(struct rh_item_ci *ci, int cast_index, uint32_t seq,
+    int rtt_set, double rtt);
+
+extern void		rh_ci_flow_sent(struct rh_item_ci *ci, uint32_t seq);
+
 extern int		rh_ci_is_dup_packet(const struct rh_item_ci *ci, uint32_t seq,
     int cast_index);
 
-extern struct rh_item	*rh_list_add_item(struct rh_list *rh_list, struct ai_item *addr,
-    int dup_buf_items, int rate_limit_time);
+extern void		rh_ci_prof_received(struct rh_item_ci *ci, int profile, int cast_index,
+    int rtt_set, double rtt);
+
+extern void		rh_ci_srv_stats_new_session(struct rh_item_ci *ci);
+
+extern void		rh_ci_srv_stats_update(struct rh_item_ci *ci, int cast_index,
+    const struct tlv_server_stats *server_stats);
+
+extern void		rh_ci_rtt_hist_add(struct rh_item_ci *ci, int cast_index, double rtt);
+
+
+extern int		rh_ci_warmup_update(struct rh_item_ci *ci, int cast_index, double rtt,
+    struct timeval rp_timestamp, int warmup_time);
+
+extern size_t		rh_item_alloc_size(int dup_buf_items);
+
+extern int		rh_si_is_retrans(const struct rh_item_si *si, const char *client_id,
+    size_t client_id_len);
+
+extern int		rh_si_new_session(struct rh_item_si *si, const char *client_id,
+    size_t client_id_len, struct timeval rp_timestamp, unsigned int min_init_time);
+
+extern void		rh_si_stats_update(struct rh_item_si *si, uint32_t seq,
+    int client_tstamp_isset, struct timeval client_tstamp, struct timeval rp_timestamp);
+
+extern size_t		rh_si_table_alloc_size(unsigned int no_items, int family);
+
+extern void		rh_si_table_create(struct rh_si_table *table, struct ar_arena *arena,
+    struct aii_list *remote_addrs);
+
+extern struct rh_item_si	*rh_si_table_find(const struct rh_si_table *table,
+    const struct sockaddr *sa);
+
+extern size_t		rh_si_table_mem_size(const struct rh_si_table *table);
+
+extern void		rh_si_table_put_to_finish_state(struct rh_si_table *table);
+
+extern struct rh_item	*rh_list_add_item(struct rh_list *rh_list, struct ar_arena *arena,
+    struct rh_cast_stats *cast_stats, struct ai_item *addr, int dup_buf_items);
+
+extern struct rh_cast_stats	*rh_list_alloc_cast_stats(struct ar_arena *arena,
+    unsigned int no_items);
+
+extern void		 rh_list_create(struct rh_list *rh_list, struct ar_arena *arena,
+    struct rh_cast_stats *cast_stats, struct aii_list *remote_addrs, int dup_buf_items);
+
+extern int		 rh_list_alloc_flows(struct rh_list *rh_list, struct ar_arena *arena,
+    int no_flows, const int *tclasses);
 
-extern void		 rh_list_create(struct rh_list *rh_list, struct aii_list *remote_addrs,
-    int dup_buf_items, int rate_limit_time);
+extern int		 rh_list_alloc_profiles(struct rh_list *rh_list, struct ar_arena *arena,
+    int no_profiles);
 
 extern struct rh_item	*rh_list_find(struct rh_list *rh_list, const struct sockaddr *sa);
-extern void		 rh_list_free(struct rh_list *rh_list);
+extern void		 rh_list_free(struct rh_list *rh_list, struct ar_arena *arena);
 
 extern void		 rh_list_gen_cid(struct rh_list *rh_list,
     const struct ai_item *local_addr);
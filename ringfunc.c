@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+ * FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Author: agent <agent@local>
+ */
+
+#include <sys/types.h>
+
+#include <err.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ringfunc.h"
+
+/*
+ * Close ring. Consumer waiting in ring_wait is woken up and ring_wait returns -1 after all items
+ * are consumed.
+ */
+void
+ring_close(struct ring *ring)
+{
+
+	pthread_mutex_lock(&ring->mutex);
+	ring->closed = 1;
+	pthread_cond_signal(&ring->cond);
+	pthread_mutex_unlock(&ring->mutex);
+}
+
+/*
+ * Remove oldest item (returned by ring_front) from ring. Must be called only by consumer and only
+ * if ring is not empty.
+ */
+void
+ring_consume(struct ring *ring)
+{
+
+	__atomic_store_n(&ring->tail.val, ring->tail.val + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Create ring with at least size items (size is rounded up to power of two) of item_size size.
+ */
+void
+ring_create(struct ring *ring, unsigned int size, size_t item_size)
+{
+
+	memset(ring, 0, sizeof(*ring));
+
+	for (ring->size = 1; ring->size < size; ring->size <<= 1)
+		;
+
+	ring->item_size = item_size;
+	ring->items = (char *)malloc(ring->size * item_size);
+	if (ring->items == NULL) {
+		errx(1, "Can't alloc memory");
+	}
+
+	if (pthread_mutex_init(&ring->mutex, NULL) != 0 ||
+	    pthread_cond_init(&ring->cond, NULL) != 0) {
+		errx(1, "Can't initialize ring");
+	}
+}
+
+/*
+ * Free memory of ring. Nobody may use ring after this call.
+ */
+void
+ring_free(struct ring *ring)
+{
+
+	pthread_cond_destroy(&ring->cond);
+	pthread_mutex_destroy(&ring->mutex);
+
+	free(ring->items);
+	ring->items = NULL;
+}
+
+/*
+ * Return pointer to oldest item in ring or NULL if ring is empty. Item stays in ring (so producer
+ * can't overwrite it) until ring_consume is called. Must be called only by consumer.
+ */
+void *
+ring_front(struct ring *ring)
+{
+	uint64_t tail;
+
+	tail = ring->tail.val;
+
+	if (__atomic_load_n(&ring->head.val, __ATOMIC_ACQUIRE) == tail) {
+		return (NULL);
+	}
+
+	return (ring->items + (tail & (ring->size - 1)) * ring->item_size);
+}
+
+/*
+ * Test if all items pushed to ring were consumed. Function returns 1 if ring is empty, otherwise 0.
+ */
+int
+ring_is_empty(struct ring *ring)
+{
+
+	return (__atomic_load_n(&ring->head.val, __ATOMIC_SEQ_CST) ==
+	    __atomic_load_n(&ring->tail.val, __ATOMIC_SEQ_CST));
+}
+
+/*
+ * Test if there is no free space in ring. Must be called only by producer. Function returns 1 if
+ * ring is full, otherwise 0.
+ */
+int
+ring_is_full(struct ring *ring)
+{
+
+	return (ring->head.val - __atomic_load_n(&ring->tail.val, __ATOMIC_ACQUIRE) >= ring->size);
+}
+
+/*
+ * Push copy of item to ring and wake up consumer if it's waiting. Must be called only by producer.
+ * Function returns 0 on success or -1 if ring is full (item is dropped and counted in
+ * no_overflows).
+ */
+int
+ring_push(struct ring *ring, const void *item)
+{
+	uint64_t head;
+
+	head = ring->head.val;
+
+	if (head - __atomic_load_n(&ring->tail.val, __ATOMIC_ACQUIRE) >= ring->size) {
+		ring->no_overflows++;
+
+		return (-1);
+	}
+
+	memcpy(ring->items + (head & (ring->size - 1)) * ring->item_size, item, ring->item_size);
+
+	/*
+	 * Store of head must be visible before waiting flag is tested, otherwise wakeup of
+	 * consumer which is just going to sleep may be lost
+	 */
+	__atomic_store_n(&ring->head.val, head + 1, __ATOMIC_SEQ_CST);
+
+	if (__atomic_load_n(&ring->waiting, __ATOMIC_SEQ_CST)) {
+		pthread_mutex_lock(&ring->mutex);
+		pthread_cond_signal(&ring->cond);
+		pthread_mutex_unlock(&ring->mutex);
+	}
+
+	return (0);
+}
+
+/*
+ * Wait until ring is not empty or closed. Must be called only by consumer.
+ * Function returns 0 if ring contains item, or -1 if ring is closed and empty.
+ */
+int
+ring_wait(struct ring *ring)
+{
+	int res;
+
+	pthread_mutex_lock(&ring->mutex);
+
+	__atomic_store_n(&ring->waiting, 1, __ATOMIC_SEQ_CST);
+
+	while (ring_is_empty(ring) && !ring->closed) {
+		pthread_cond_wait(&ring->cond, &ring->mutex);
+	}
+
+	__atomic_store_n(&ring->waiting, 0, __ATOMIC_SEQ_CST);
+
+	res = (ring_is_empty(ring) ? -1 : 0);
+
+	pthread_mutex_unlock(&ring->mutex);
+
+	return (res);
+}
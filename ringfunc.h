@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+ * FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Author: agent <agent@local>
+ */
+
+#ifndef _RINGFUNC_H_
+#define _RINGFUNC_H_
+
+#include <sys/types.h>
+
+#include <inttypes.h>
+#include <pthread.h>
+
+#include "arfunc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Structures definition
+ */
+
+/*
+ * Index of ring padded to whole cache line, so producer and consumer don't share cache line
+ */
+struct ring_idx {
+	uint64_t	val;
+	char		pad[AR_ALIGN - sizeof(uint64_t)];
+};
+
+/*
+ * Lock-free single producer single consumer ring of fixed size items. head is number of items
+ * pushed (written only by producer) and tail is number of items consumed (written only by
+ * consumer). size is number of items (power of two) and item_size is size of one item.
+ * no_overflows is number of items which were not pushed because ring was full. Mutex and cond are
+ * used only for wakeup of consumer waiting on empty ring (waiting is set) and for close.
+ */
+struct ring {
+	struct ring_idx	head;
+	struct ring_idx	tail;
+	pthread_cond_t	cond;
+	pthread_mutex_t	mutex;
+	char		*items;
+	size_t		item_size;
+	uint64_t	no_overflows;
+	unsigned int	size;
+	int		closed;
+	int		waiting;
+};
+
+/*
+ * Prototypes
+ */
+extern void	 ring_close(struct ring *ring);
+
+extern void	 ring_consume(struct ring *ring);
+
+extern void	 ring_create(struct ring *ring, unsigned int size, size_t item_size);
+
+extern void	 ring_free(struct ring *ring);
+
+extern void	*ring_front(struct ring *ring);
+
+extern int	 ring_is_empty(struct ring *ring);
+
+extern int	 ring_is_full(struct ring *ring);
+
+extern int	 ring_push(struct ring *ring, const void *item);
+
+extern int	 ring_wait(struct ring *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RINGFUNC_H_ */
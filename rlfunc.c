@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+ * FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Author: agent <agent@local>
+ */
+
+#include <sys/types.h>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include <err.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "addrfunc.h"
+#include "gcra.h"
+#include "rlfunc.h"
+
+/*
+ * Create rate limit table. rl_table is pointer to table to initialize, size is number of hash
+ * buckets. interval and burst are GCRA parameters of one bucket (see gcra_init) and aggr_interval
+ * with aggr_burst are parameters of aggregate limit. Memory is allocated only once, so table has
+ * constant size regardless of number of sources.
+ */
+void
+rl_table_create(struct rl_table *rl_table, unsigned int size, uint64_t interval,
+    unsigned int burst, uint64_t aggr_interval, unsigned int aggr_burst)
+{
+	unsigned int i;
+
+	memset(rl_table, 0, sizeof(*rl_table));
+
+	rl_table->items = (struct gcra_item *)malloc(sizeof(struct gcra_item) * size);
+	if (rl_table->items == NULL) {
+		errx(1, "Can't alloc memory");
+	}
+
+	for (i = 0; i < size; i++) {
+		gcra_init(&rl_table->items[i], interval, burst);
+	}
+
+	gcra_init(&rl_table->aggr, aggr_interval, aggr_burst);
+
+	rl_table->size = size;
+}
+
+/*
+ * Free memory allocated by rate limit table rl_table.
+ */
+void
+rl_table_free(struct rl_table *rl_table)
+{
+
+	free(rl_table->items);
+	rl_table->items = NULL;
+	rl_table->size = 0;
+}
+
+/*
+ * Test if packet from/to sa at time tv conforms both to limit of bucket of sa and to aggregate
+ * limit. Sources with colliding hashes share one bucket.
+ * Function returns 1 if packet is conforming, otherwise 0. Counters of table are updated.
+ */
+int
+rl_table_rl(struct rl_table *rl_table, const struct sockaddr *sa, struct timeval tv)
+{
+	struct gcra_item *item;
+
+	item = &rl_table->items[af_sa_hash(sa) % rl_table->size];
+
+	if (gcra_rl_hier(item, &rl_table->aggr, tv) != 1) {
+		rl_table->no_limited++;
+
+		return (0);
+	}
+
+	rl_table->no_passed++;
+
+	return (1);
+}
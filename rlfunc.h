@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+ * FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Author: agent <agent@local>
+ */
+
+#ifndef _RLFUNC_H_
+#define _RLFUNC_H_
+
+#include <sys/types.h>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include <inttypes.h>
+
+#include "gcra.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Rate limit table. Fixed size hash table of GCRA items indexed by source address hash plus
+ * one aggregate GCRA item shared by all sources.
+ */
+struct rl_table {
+	struct gcra_item	aggr;
+	struct gcra_item	*items;
+	uint64_t		no_limited;
+	uint64_t		no_passed;
+	unsigned int		size;
+};
+
+extern void	rl_table_create(struct rl_table *rl_table, unsigned int size,
+    uint64_t interval, unsigned int burst, uint64_t aggr_interval, unsigned int aggr_burst);
+
+extern void	rl_table_free(struct rl_table *rl_table);
+
+extern int	rl_table_rl(struct rl_table *rl_table, const struct sockaddr *sa,
+    struct timeval tv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RLFUNC_H_ */
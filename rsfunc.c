@@ -18,6 +18,13 @@
  * Author: Jan Friesse <jfriesse@redhat.com>
  */
 
+#ifdef __linux__
+/*
+ * Needed for recvmmsg and sendmmsg
+ */
+#define _GNU_SOURCE
+#endif
+
 #include <sys/types.h>
 
 #include <sys/socket.h>
@@ -27,6 +34,10 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
+#ifdef __linux__
+#include <linux/errqueue.h>
+#endif
+
 #include <err.h>
 #include <errno.h>
 #include <netdb.h>
@@ -35,28 +46,241 @@
 
 #include "addrfunc.h"
 #include "logging.h"
+#include "pacefunc.h"
+#include "pktfunc.h"
 #include "rsfunc.h"
 #include "util.h"
+#include "xskfunc.h"
+
+/*
+ * Size of buffer for ancillary data of received message
+ */
+#define RS_CMSG_BUF_SIZE	CMSG_SPACE(1024)
+
+/*
+ * Size of buffer for ancillary data of sent message (traffic class and departure time)
+ */
+#define RS_SEND_CMSG_BUF_SIZE	(CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(uint64_t)))
+
+static void	rs_parse_cmsgs(struct msghdr *msg_hdr, uint8_t *ttl, struct timeval *timestamp);
+
+static int	rs_receive_error_res(void);
+
+static int	rs_send_error_res(void);
+
+static void	rs_send_msghdr_init(struct msghdr *msg_hdr, struct iovec *msg_iovec,
+    char *cmsg_buf, size_t cmsg_buf_len, const struct rs_send_msg *msg);
+
+static void	rs_socket_close(void);
+
+static int	rs_socket_open(const int *socks, int no_socks);
+
+static int	rs_socket_recv_batch(int sock, struct rs_msg *msgs, int no_msgs);
+
+static int	rs_socket_send_batch(int sock, const struct rs_send_msg *msgs, int no_msgs);
+
+static int	rs_socket_wait(const int *socks, int no_socks, int timeout, int spin,
+    int *sock_events);
+
+/*
+ * Portable socket backend. It uses poll, recvmsg (recvmmsg on Linux) and sendmsg (sendmmsg on
+ * Linux).
+ */
+const struct rs_backend rs_socket_backend = {
+	.name = "socket",
+#ifdef SO_TIMESTAMP
+	.ts_source = "kernel (SO_TIMESTAMP)",
+#else
+	.ts_source = "gettimeofday",
+#endif
+	.close = rs_socket_close,
+	.open = rs_socket_open,
+	.recv_batch = rs_socket_recv_batch,
+	.send_batch = rs_socket_send_batch,
+	.wait = rs_socket_wait,
+	.optional = 0,
+};
+
+/*
+ * NULL terminated list of available backends. First one is default.
+ */
+static const struct rs_backend *rs_backends[] = {
+	&rs_socket_backend,
+	&pkt_backend,
+	&xsk_backend,
+	NULL
+};
+
+/*
+ * Currently selected backend
+ */
+static const struct rs_backend *rs_cur_backend = &rs_socket_backend;
+
+/*
+ * Token bucket charged by every sent message or NULL if egress pacing is disabled
+ */
+static struct pace_bucket *rs_pacer = NULL;
+
+/*
+ * Close currently selected backend.
+ */
+void
+rs_backend_close(void)
+{
+
+	rs_cur_backend->close();
+}
+
+/*
+ * Return name of currently selected backend.
+ */
+const char *
+rs_backend_name(void)
+{
+
+	return (rs_cur_backend->name);
+}
+
+/*
+ * Open currently selected backend. socks is array of no_socks sockets (same as passed later to
+ * rs_poll_timeout). If optional backend can't be opened, socket backend is selected and opened
+ * instead.
+ * Function returns 0 on success, 1 if socket backend is used instead of optional backend (errno
+ * is set by failed backend), otherwise -1.
+ */
+int
+rs_backend_open(const int *socks, int no_socks)
+{
+	int saved_errno;
+
+	if (rs_cur_backend->open(socks, no_socks) == 0) {
+		return (0);
+	}
+
+	if (!rs_cur_backend->optional) {
+		return (-1);
+	}
+
+	DEBUG_PRINTF("Can't open %s backend, using %s backend", rs_cur_backend->name,
+	    rs_socket_backend.name);
+
+	saved_errno = errno;
+	rs_cur_backend = &rs_socket_backend;
+
+	if (rs_cur_backend->open(socks, no_socks) != 0) {
+		return (-1);
+	}
+
+	errno = saved_errno;
+
+	return (1);
+}
+
+/*
+ * Select backend with name name. Function must be called before rs_backend_open.
+ * Function returns 0 on success or -1 if backend with given name doesn't exist.
+ */
+int
+rs_backend_set(const char *name)
+{
+	int i;
+
+	for (i = 0; rs_backends[i] != NULL; i++) {
+		if (strcmp(rs_backends[i]->name, name) == 0) {
+			rs_cur_backend = rs_backends[i];
+
+			return (0);
+		}
+	}
+
+	return (-1);
+}
+
+/*
+ * Return description of source of receive timestamps of currently selected backend.
+ */
+const char *
+rs_backend_ts_source(void)
+{
+
+	return (rs_cur_backend->ts_source);
+}
+
+/*
+ * Parse ancillary data of received message msg_hdr. ttl is filled by TTL from packet (or 0 if no
+ * such information is available). timestamp (if not NULL) is filled either by SCM_TIMESTAMP
+ * directly from packet (if supported) or by current time.
+ */
+static void
+rs_parse_cmsgs(struct msghdr *msg_hdr, uint8_t *ttl, struct timeval *timestamp)
+{
+	struct cmsghdr *cmsg;
+	int ittl;
+	int timestamp_set;
+
+	ittl = 0;
+	timestamp_set = 0;
+
+	for (cmsg = CMSG_FIRSTHDR(msg_hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(msg_hdr, cmsg)) {
+		switch (cmsg->cmsg_level) {
+		case SOL_SOCKET:
+#ifdef SCM_TIMESTAMP
+			if (cmsg->cmsg_type == SCM_TIMESTAMP &&
+			    cmsg->cmsg_len >= sizeof(struct timeval) && timestamp != NULL) {
+				memcpy(timestamp, CMSG_DATA(cmsg), sizeof(struct timeval));
+				timestamp_set = 1;
+			}
+#endif
+		case IPPROTO_IP:
+			if (cmsg->cmsg_type == IP_TTL && cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+				memcpy(&ittl, CMSG_DATA(cmsg), sizeof(ittl));
+			}
+#ifdef IP_RECVTTL
+			if (cmsg->cmsg_type == IP_RECVTTL && cmsg->cmsg_len > 1) {
+				ittl = *(uint8_t *)CMSG_DATA(cmsg);
+			}
+#endif
+			break;
+		case IPPROTO_IPV6:
+			if (cmsg->cmsg_type == IPV6_HOPLIMIT && cmsg->cmsg_len ==
+			    CMSG_LEN(sizeof(int))) {
+				memcpy(&ittl, CMSG_DATA(cmsg), sizeof(ittl));
+			}
+			break;
+		}
+	}
+
+	*ttl = (uint8_t)ittl;
+
+	if (!timestamp_set && timestamp != NULL) {
+		*timestamp = util_get_time();
+	}
+}
 
 /*
  * Wrapper on top of poll. This poll stores old timestamp so it's possible to put always same
  * timeout but correct timeout is computed from old_tstamp and current time. In other words, this
  * function will always after timeout expire return timeout (0) not depending on number of times
  * this function was called.
- * unicast_socket and multicast_socket are two sockets, timeout is absolute timeout (after this
- * value, function returns 0) and old_tstamp is internal state variable (on first call value
- * must be zeroed).
- * Function return bit field (unicast_socket - bit 1, multicast_socket - bit 2) if something was
- * read, 0 on timeout, -1 on fail (use errno) and -2 on interrupt.
+ * socks is array of no_socks sockets (negative items are ignored), timeout is absolute timeout
+ * (after this value, function returns 0), max_poll_timeout is maximum time to wait in one call
+ * (or -1 for no limit). If spin is set, sockets are polled without sleeping until event arrives
+ * or time expires (this trades CPU time for lower wakeup latency). old_tstamp is internal state
+ * variable (on first call value must be zeroed). sock_events is array of no_socks items which is
+ * filled by bit field of RS_EV_READ (socket is readable) and RS_EV_ERR (on systems with socket
+ * error queue, error queue contains message, use rs_receive_err). Waiting itself is done by
+ * currently selected backend.
+ * Function returns number of sockets with some event, 0 on timeout, -1 on fail (use errno), -2 on
+ * interrupt and -3 if max_poll_timeout expired but timeout not.
  */
 int
-rs_poll_timeout(int unicast_socket, int multicast_socket, int timeout, struct timeval *old_tstamp)
+rs_poll_timeout(const int *socks, int no_socks, int timeout, int max_poll_timeout, int spin,
+    struct timeval *old_tstamp, int *sock_events)
 {
-	struct pollfd pfds[2];
 	struct timeval cur_time;
 	int poll_timeout;
 	int poll_res;
-	int res;
+	int timeout_limited;
 
 	cur_time = util_get_time();
 
@@ -75,52 +299,131 @@ rs_poll_timeout(int unicast_socket, int multicast_socket, int timeout, struct ti
 		poll_timeout = 0;
 	}
 
-	memset(pfds, 0, sizeof(struct pollfd) * 2);
-
-	pfds[0].fd = unicast_socket;
-	pfds[0].events = POLLIN;
-
-	pfds[1].fd = multicast_socket;
-	pfds[1].events = POLLIN;
+	timeout_limited = 0;
+	if (max_poll_timeout >= 0 && poll_timeout > max_poll_timeout) {
+		poll_timeout = max_poll_timeout;
+		timeout_limited = 1;
+	}
 
-	poll_res = poll(pfds, 2, poll_timeout);
+	poll_res = rs_cur_backend->wait(socks, no_socks, poll_timeout, spin, sock_events);
 
 	if (poll_res == 0) {
-		memset(old_tstamp, 0, sizeof(*old_tstamp));
+		if (timeout_limited) {
+			return (-3);
+		}
 
-		return (0);
+		memset(old_tstamp, 0, sizeof(*old_tstamp));
 	}
 
-	if (poll_res == -1) {
+	return (poll_res);
+}
+
+/*
+ * Read one message from socket error queue. sock is socket to read from. dst_addr is filled by
+ * destination address of packet which caused error and err_no is filled by errno value of error
+ * (ECONNREFUSED for port unreachable, EHOSTUNREACH, ...). icmp_origin is set to 1 if error was
+ * caused by received ICMP message, otherwise (local error) to 0.
+ * Function returns 1 if error was read, 0 if error queue is empty (or not supported by OS), -2 on
+ * EINTR or -1 on different error.
+ */
+int
+rs_receive_err(int sock, struct sockaddr_storage *dst_addr, int *err_no, int *icmp_origin)
+{
+#ifdef MSG_ERRQUEUE
+	char cmsg_buf[CMSG_SPACE(1024)];
+	char msg[MAX_ERR_MSG_SIZE];
+	struct cmsghdr *cmsg;
+	struct iovec msg_iovec;
+	struct msghdr msg_hdr;
+	struct sock_extended_err see;
+	ssize_t recv_size;
+	int see_set;
+
+	memset(&msg_iovec, 0, sizeof(msg_iovec));
+	msg_iovec.iov_base = msg;
+	msg_iovec.iov_len = sizeof(msg);
+
+	memset(dst_addr, 0, sizeof(*dst_addr));
+
+	memset(&msg_hdr, 0, sizeof(msg_hdr));
+	msg_hdr.msg_name = dst_addr;
+	msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+	msg_hdr.msg_iov = &msg_iovec;
+	msg_hdr.msg_iovlen = 1;
+	msg_hdr.msg_control = cmsg_buf;
+	msg_hdr.msg_controllen = sizeof(cmsg_buf);
+
+	recv_size = recvmsg(sock, &msg_hdr, MSG_ERRQUEUE | MSG_DONTWAIT);
+
+	if (recv_size == -1) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			return (0);
+		}
+
 		if (errno == EINTR) {
-			DEBUG2_PRINTF("poll error - EINTR");
+			DEBUG2_PRINTF("recvmsg MSG_ERRQUEUE error - EINTR");
 			return (-2);
-		} else {
-			DEBUG2_PRINTF("poll error - errno = %d", errno);
-			return (-1);
 		}
-	}
 
-	if (pfds[0].revents & POLLERR || pfds[0].revents & POLLHUP || pfds[0].revents & POLLNVAL) {
-		DEBUG2_PRINTF("poll error. pfds[0] revents = %d", pfds[0].revents);
+		DEBUG2_PRINTF("recvmsg MSG_ERRQUEUE error - errno = %d", errno);
 		return (-1);
 	}
 
-	if (pfds[1].revents & POLLERR || pfds[1].revents & POLLHUP || pfds[1].revents & POLLNVAL) {
-		DEBUG2_PRINTF("poll error. pfds[1] revents = %d", pfds[1].revents);
-		return (-1);
+	see_set = 0;
+
+	for (cmsg = CMSG_FIRSTHDR(&msg_hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg_hdr, cmsg)) {
+		if ((cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_RECVERR) ||
+		    (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+			if (cmsg->cmsg_len >= CMSG_LEN(sizeof(see))) {
+				memcpy(&see, CMSG_DATA(cmsg), sizeof(see));
+				see_set = 1;
+			}
+		}
 	}
 
-	res = 0;
-	if (pfds[0].revents & POLLIN) {
-		res |= 1;
+	if (!see_set) {
+		DEBUG2_PRINTF("recvmsg MSG_ERRQUEUE - no extended error");
+		*err_no = 0;
+		*icmp_origin = 0;
+
+		return (1);
 	}
 
-	if (pfds[1].revents & POLLIN) {
-		res |= 2;
+	*err_no = see.ee_errno;
+	*icmp_origin = (see.ee_origin == SO_EE_ORIGIN_ICMP || see.ee_origin == SO_EE_ORIGIN_ICMP6);
+
+	DEBUG2_PRINTF("recvmsg MSG_ERRQUEUE - errno %u, origin %u, type %u, code %u",
+	    see.ee_errno, see.ee_origin, see.ee_type, see.ee_code);
+
+	return (1);
+#else
+	return (0);
+#endif
+}
+
+/*
+ * Convert errno of failed recvmsg (or recvmmsg) to return code.
+ * Function returns -2 on EINTR, -3 on one of EHOSTUNREACH | ENETDOWN | EHOSTDOWN | ECONNRESET |
+ * ECONNREFUSED, or -1 on different error.
+ */
+static int
+rs_receive_error_res(void)
+{
+
+	if (errno == EINTR) {
+		DEBUG2_PRINTF("recvmsg error - EINTR");
+		return (-2);
 	}
 
-	return (res);
+	if (errno == EHOSTUNREACH || errno == EHOSTDOWN || errno == ENETDOWN ||
+	    errno == ECONNRESET || errno == ECONNREFUSED) {
+		DEBUG2_PRINTF("recvmsg error - EHOSTUNREACH || EHOSTDOWN || ENETDOWN ||"
+		    " ECONNRESET || ECONNREFUSED");
+		return (-3);
+	}
+
+	DEBUG2_PRINTF("recvmsg error - errno = %d", errno);
+	return (-1);
 }
 
 /*
@@ -131,22 +434,16 @@ rs_poll_timeout(int unicast_socket, int multicast_socket, int timeout, struct ti
  * either by SCM_TIMESTAMP directly from packet (if supported) or current get gettimeofday.
  * NULL can be passed as timestamp pointer.
  * Return number of received bytes, or -2 on EINTR, -3 on one of EHOSTUNREACH | ENETDOWN |
- * EHOSTDOWN | ECONNRESET, -4 if message is truncated, or -1 on different error.
+ * EHOSTDOWN | ECONNRESET | ECONNREFUSED, -4 if message is truncated, or -1 on different error.
  */
 ssize_t
 rs_receive_msg(int sock, struct sockaddr_storage *from_addr, char *msg, size_t msg_len,
     uint8_t *ttl, struct timeval *timestamp)
 {
-	char cmsg_buf[CMSG_SPACE(1024)];
-	struct cmsghdr *cmsg;
+	char cmsg_buf[RS_CMSG_BUF_SIZE];
 	struct iovec msg_iovec;
 	struct msghdr msg_hdr;
 	ssize_t recv_size;
-	int ittl;
-	int timestamp_set;
-
-	ittl = 0;
-	timestamp_set = 0;
 
 	memset(&msg_iovec, 0, sizeof(msg_iovec));
 	msg_iovec.iov_base = msg;
@@ -163,20 +460,7 @@ rs_receive_msg(int sock, struct sockaddr_storage *from_addr, char *msg, size_t m
 	recv_size = recvmsg(sock, &msg_hdr, 0);
 
 	if (recv_size == -1) {
-		if (errno == EINTR) {
-			DEBUG2_PRINTF("recvmsg error - EINTR");
-			return (-2);
-		}
-
-		if (errno == EHOSTUNREACH || errno == EHOSTDOWN || errno == ENETDOWN ||
-		    errno == ECONNRESET) {
-			DEBUG2_PRINTF("recvmsg error - EHOSTUNREACH || EHOSTDOWN || ENETDOWN ||"
-			    " ECONNRESET");
-			return (-3);
-		}
-
-		DEBUG2_PRINTF("recvmsg error - errno = %d", errno);
-		return (-1);
+		return (rs_receive_error_res());
 	}
 
 	if (msg_hdr.msg_flags & MSG_TRUNC || msg_hdr.msg_flags & MSG_CTRUNC) {
@@ -184,79 +468,482 @@ rs_receive_msg(int sock, struct sockaddr_storage *from_addr, char *msg, size_t m
 		return (-4);
 	}
 
-	for (cmsg = CMSG_FIRSTHDR(&msg_hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg_hdr, cmsg)) {
-		switch (cmsg->cmsg_level) {
-		case SOL_SOCKET:
-#ifdef SCM_TIMESTAMP
-			if (cmsg->cmsg_type == SCM_TIMESTAMP &&
-			    cmsg->cmsg_len >= sizeof(struct timeval) && timestamp != NULL) {
-				memcpy(timestamp, CMSG_DATA(cmsg), sizeof(struct timeval));
-				timestamp_set = 1;
-			}
-#endif
-		case IPPROTO_IP:
-			if (cmsg->cmsg_type == IP_TTL && cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
-				memcpy(&ittl, CMSG_DATA(cmsg), sizeof(ittl));
-			}
-#ifdef IP_RECVTTL
-			if (cmsg->cmsg_type == IP_RECVTTL && cmsg->cmsg_len > 1) {
-				ittl = *(uint8_t *)CMSG_DATA(cmsg);
-			}
-#endif
-			break;
-		case IPPROTO_IPV6:
-			if (cmsg->cmsg_type == IPV6_HOPLIMIT && cmsg->cmsg_len ==
-			    CMSG_LEN(sizeof(int))) {
-				memcpy(&ittl, CMSG_DATA(cmsg), sizeof(ittl));
-			}
-			break;
+	rs_parse_cmsgs(&msg_hdr, ttl, timestamp);
+
+	return (recv_size);
+}
+
+/*
+ * Receive batch of messages from socket. sock is socket to read from and msgs is array of no_msgs
+ * (at most RS_MAX_BATCH_MSGS) messages with msg and msg_len set by caller. Other items of msgs are
+ * filled in same way as rs_receive_msg fills its arguments and recv_size is set to number of
+ * received bytes or -4 if message is truncated. On systems with recvmmsg, all waiting messages (up
+ * to no_msgs) are read by one call without blocking, otherwise one message is read (and socket
+ * should be readable).
+ * Function returns number of received messages (0 if no message is waiting), -2 on EINTR, -3 on
+ * one of EHOSTUNREACH | ENETDOWN | EHOSTDOWN | ECONNRESET | ECONNREFUSED or -1 on different error.
+ */
+int
+rs_receive_msgs(int sock, struct rs_msg *msgs, int no_msgs)
+{
+
+	return (rs_cur_backend->recv_batch(sock, msgs, no_msgs));
+}
+
+/*
+ * Convert errno of failed sendto (or sendmsg) to return code.
+ * Function returns -2 on EINTR, -3 on one of EHOSTDOWN | ENETDOWN | EHOSTUNREACH | ENOBUFS |
+ * ENETUNREACH | ECONNREFUSED, or -1 on different error.
+ */
+static int
+rs_send_error_res(void)
+{
+
+	if (errno == EINTR) {
+		DEBUG2_PRINTF("sendto error - EINTR");
+		return (-2);
+	}
+
+	if (errno == EHOSTUNREACH || errno == EHOSTDOWN || errno == ENETDOWN ||
+	    errno == ENOBUFS || errno == ENETUNREACH || errno == ECONNREFUSED) {
+		DEBUG2_PRINTF("sendto error - EHOSTUNREACH || EHOSTDOWN || ENETDOWN ||"
+		    "ENOBUFS || ENETUNREACH || ECONNREFUSED");
+		return (-3);
+	}
+
+	DEBUG2_PRINTF("sendto error - errno = %d", errno);
+	return (-1);
+}
+
+/*
+ * Initialize msg_hdr (with msg_iovec) for sending of message msg. cmsg_buf is buffer with
+ * cmsg_buf_len size (at least RS_SEND_CMSG_BUF_SIZE) used for traffic class ancillary data if
+ * msg->tclass is not negative and for departure time (SCM_TXTIME) if msg->txtime is set.
+ */
+static void
+rs_send_msghdr_init(struct msghdr *msg_hdr, struct iovec *msg_iovec, char *cmsg_buf,
+    size_t cmsg_buf_len, const struct rs_send_msg *msg)
+{
+	struct cmsghdr *cmsg;
+
+	memset(msg_hdr, 0, sizeof(*msg_hdr));
+
+	msg_iovec->iov_base = (void *)msg->msg;
+	msg_iovec->iov_len = msg->msg_len;
+
+	msg_hdr->msg_name = (void *)msg->to;
+	msg_hdr->msg_namelen = af_sas_len(msg->to);
+	msg_hdr->msg_iov = msg_iovec;
+	msg_hdr->msg_iovlen = 1;
+
+	if (msg->tclass < 0 && msg->txtime == 0) {
+		return ;
+	}
+
+	memset(cmsg_buf, 0, cmsg_buf_len);
+
+	msg_hdr->msg_control = cmsg_buf;
+	msg_hdr->msg_controllen = 0;
+
+	cmsg = (struct cmsghdr *)cmsg_buf;
+
+	if (msg->tclass >= 0) {
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+
+		if (msg->to->ss_family == AF_INET6) {
+			cmsg->cmsg_level = IPPROTO_IPV6;
+			cmsg->cmsg_type = IPV6_TCLASS;
+		} else {
+			cmsg->cmsg_level = IPPROTO_IP;
+			cmsg->cmsg_type = IP_TOS;
 		}
+
+		memcpy(CMSG_DATA(cmsg), &msg->tclass, sizeof(msg->tclass));
+
+		msg_hdr->msg_controllen += CMSG_SPACE(sizeof(int));
+		cmsg = (struct cmsghdr *)(cmsg_buf + msg_hdr->msg_controllen);
 	}
 
-	*ttl = (uint8_t)ittl;
+#ifdef SCM_TXTIME
+	if (msg->txtime != 0) {
+		cmsg->cmsg_len = CMSG_LEN(sizeof(msg->txtime));
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_TXTIME;
 
-	if (!timestamp_set && timestamp != NULL) {
-		*timestamp = util_get_time();
+		memcpy(CMSG_DATA(cmsg), &msg->txtime, sizeof(msg->txtime));
+
+		msg_hdr->msg_controllen += CMSG_SPACE(sizeof(msg->txtime));
 	}
+#endif
 
-	return (recv_size);
+	if (msg_hdr->msg_controllen == 0) {
+		msg_hdr->msg_control = NULL;
+	}
 }
 
 /*
- * Thin wrapper on top of sendto. sock is socket, msg is message with msg_size length to send and to
- * is address where to send message.
+ * Send batch of messages by currently selected backend. sock is socket to send messages on and
+ * msgs is array of no_msgs messages. Messages are sent in order, sending stops on first error.
+ * Sent messages (including IP and UDP headers) are charged to egress pacer if set.
+ * Function returns number of sent messages (no_msgs) or same error as rs_sendto.
+ */
+int
+rs_send_msgs(int sock, const struct rs_send_msg *msgs, int no_msgs)
+{
+	struct timeval tv;
+	int i;
+	int res;
+
+	if (rs_cur_backend->send_batch == NULL) {
+		res = rs_socket_send_batch(sock, msgs, no_msgs);
+	} else {
+		res = rs_cur_backend->send_batch(sock, msgs, no_msgs);
+	}
+
+	if (rs_pacer != NULL && res > 0) {
+		tv = util_get_time();
+
+		for (i = 0; i < res; i++) {
+			pace_charge(rs_pacer, msgs[i].msg_len + (msgs[i].to->ss_family == AF_INET6 ?
+			    PACE_IP6_OVERHEAD : PACE_IP4_OVERHEAD), tv);
+		}
+	}
+
+	return (res);
+}
+
+/*
+ * Set egress pacer. pb is token bucket charged by all messages sent by rs_send_msgs or NULL to
+ * disable charging.
+ */
+void
+rs_pacer_set(struct pace_bucket *pb)
+{
+
+	rs_pacer = pb;
+}
+
+/*
+ * Send one message by currently selected backend. sock is socket, msg is message with msg_size
+ * length to send and to is address where to send message.
  * Return number of sent bytes or -2 on EINTR, -3 on one of EHOSTDOWN | ENETDOWN | EHOSTUNREACH |
- * ENOBUFS or -1 on some different error (sent != msg_size).
+ * ENOBUFS | ENETUNREACH | ECONNREFUSED or -1 on some different error (sent != msg_size).
  */
 ssize_t
 rs_sendto(int sock, const char *msg, size_t msg_size, const struct sockaddr_storage *to)
 {
+
+	return (rs_sendto_tclass(sock, msg, msg_size, to, -1));
+}
+
+/*
+ * Same as rs_sendto but message is sent with traffic class tclass (IPv4 TOS or IPv6 Traffic
+ * Class) passed as ancillary data, so it overrides traffic class of socket. If tclass is
+ * negative, traffic class of socket is used.
+ * Return values are same as for rs_sendto.
+ */
+ssize_t
+rs_sendto_tclass(int sock, const char *msg, size_t msg_size, const struct sockaddr_storage *to,
+    int tclass)
+{
+	struct rs_send_msg send_msg;
+	int res;
+
+	send_msg.to = to;
+	send_msg.msg = msg;
+	send_msg.msg_len = msg_size;
+	send_msg.tclass = tclass;
+	send_msg.txtime = 0;
+
+	res = rs_send_msgs(sock, &send_msg, 1);
+	if (res < 0) {
+		return (res);
+	}
+
+	return (msg_size);
+}
+
+/*
+ * Same as rs_sendto but message is passed to kernel with departure time txtime (SCM_TXTIME) in ns
+ * of clock set by sfset_txtime. Qdisc (fq or etf) then holds message until txtime. If txtime is 0,
+ * message is sent immediately.
+ * Return values are same as for rs_sendto.
+ */
+ssize_t
+rs_sendto_txtime(int sock, const char *msg, size_t msg_size, const struct sockaddr_storage *to,
+    uint64_t txtime)
+{
+	struct rs_send_msg send_msg;
+	int res;
+
+	send_msg.to = to;
+	send_msg.msg = msg;
+	send_msg.msg_len = msg_size;
+	send_msg.tclass = -1;
+	send_msg.txtime = txtime;
+
+	res = rs_send_msgs(sock, &send_msg, 1);
+	if (res < 0) {
+		return (res);
+	}
+
+	return (msg_size);
+}
+
+/*
+ * Close function of socket backend. Backend has no state, so nothing is done.
+ */
+static void
+rs_socket_close(void)
+{
+
+}
+
+/*
+ * Open function of socket backend. Sockets are used directly, so nothing is done.
+ * Function always returns 0.
+ */
+static int
+rs_socket_open(const int *socks, int no_socks)
+{
+
+	(void)socks;
+	(void)no_socks;
+
+	return (0);
+}
+
+/*
+ * Receive batch of messages (recv_batch function of socket backend). Arguments and return values
+ * are same as for rs_receive_msgs.
+ */
+static int
+rs_socket_recv_batch(int sock, struct rs_msg *msgs, int no_msgs)
+{
+#ifdef __linux__
+	char cmsg_bufs[RS_MAX_BATCH_MSGS][RS_CMSG_BUF_SIZE];
+	struct iovec msg_iovecs[RS_MAX_BATCH_MSGS];
+	struct mmsghdr mmsg_hdrs[RS_MAX_BATCH_MSGS];
+	struct msghdr *msg_hdr;
+	int i;
+	int res;
+
+	if (no_msgs > RS_MAX_BATCH_MSGS) {
+		no_msgs = RS_MAX_BATCH_MSGS;
+	}
+
+	memset(mmsg_hdrs, 0, sizeof(mmsg_hdrs[0]) * no_msgs);
+
+	for (i = 0; i < no_msgs; i++) {
+		msg_iovecs[i].iov_base = msgs[i].msg;
+		msg_iovecs[i].iov_len = msgs[i].msg_len;
+
+		msg_hdr = &mmsg_hdrs[i].msg_hdr;
+		msg_hdr->msg_name = &msgs[i].from_addr;
+		msg_hdr->msg_namelen = sizeof(struct sockaddr_storage);
+		msg_hdr->msg_iov = &msg_iovecs[i];
+		msg_hdr->msg_iovlen = 1;
+		msg_hdr->msg_control = cmsg_bufs[i];
+		msg_hdr->msg_controllen = sizeof(cmsg_bufs[i]);
+	}
+
+	res = recvmmsg(sock, mmsg_hdrs, no_msgs, MSG_DONTWAIT, NULL);
+
+	if (res == -1) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			return (0);
+		}
+
+		return (rs_receive_error_res());
+	}
+
+	for (i = 0; i < res; i++) {
+		msg_hdr = &mmsg_hdrs[i].msg_hdr;
+
+		if (msg_hdr->msg_flags & MSG_TRUNC || msg_hdr->msg_flags & MSG_CTRUNC) {
+			DEBUG2_PRINTF("recvmmsg error - MSG_TRUNC | MSG_CTRUNC");
+			msgs[i].recv_size = -4;
+			continue;
+		}
+
+		msgs[i].data = msgs[i].msg;
+		msgs[i].recv_size = mmsg_hdrs[i].msg_len;
+		rs_parse_cmsgs(msg_hdr, &msgs[i].ttl, &msgs[i].timestamp);
+	}
+
+	return (res);
+#else
+	if (no_msgs < 1) {
+		return (0);
+	}
+
+	msgs[0].data = msgs[0].msg;
+	msgs[0].recv_size = rs_receive_msg(sock, &msgs[0].from_addr, msgs[0].msg, msgs[0].msg_len,
+	    &msgs[0].ttl, &msgs[0].timestamp);
+
+	if (msgs[0].recv_size < 0 && msgs[0].recv_size != -4) {
+		return ((int)msgs[0].recv_size);
+	}
+
+	return (1);
+#endif
+}
+
+/*
+ * Send batch of messages (send_batch function of socket backend). Arguments and return values
+ * are same as for rs_send_msgs. On Linux, messages are sent by sendmmsg, otherwise one by one
+ * by sendmsg.
+ */
+static int
+rs_socket_send_batch(int sock, const struct rs_send_msg *msgs, int no_msgs)
+{
+	char cmsg_bufs[RS_MAX_BATCH_MSGS][RS_SEND_CMSG_BUF_SIZE];
+	struct iovec msg_iovecs[RS_MAX_BATCH_MSGS];
+#ifdef __linux__
+	struct mmsghdr mmsg_hdrs[RS_MAX_BATCH_MSGS];
+#else
+	struct msghdr msg_hdr;
+#endif
 	ssize_t sent;
+	int i;
+	int no_batch;
+	int no_sent;
+#ifdef __linux__
+	int res;
+#endif
+
+	no_sent = 0;
 
-	sent = sendto(sock, msg, msg_size, 0, (struct sockaddr *)to, af_sas_len(to));
+	while (no_sent < no_msgs) {
+		no_batch = no_msgs - no_sent;
+		if (no_batch > RS_MAX_BATCH_MSGS) {
+			no_batch = RS_MAX_BATCH_MSGS;
+		}
+
+#ifdef __linux__
+		memset(mmsg_hdrs, 0, sizeof(mmsg_hdrs[0]) * no_batch);
+
+		for (i = 0; i < no_batch; i++) {
+			rs_send_msghdr_init(&mmsg_hdrs[i].msg_hdr, &msg_iovecs[i], cmsg_bufs[i],
+			    sizeof(cmsg_bufs[i]), &msgs[no_sent + i]);
+		}
+
+		res = sendmmsg(sock, mmsg_hdrs, no_batch, 0);
+		if (res == -1) {
+			return (rs_send_error_res());
+		}
 
-	if (sent == -1) {
+		for (i = 0; i < res; i++) {
+			sent = mmsg_hdrs[i].msg_len;
+
+			if ((size_t)sent != msgs[no_sent + i].msg_len) {
+				DEBUG2_PRINTF("sendto error - sent != msg_size");
+
+				return (-1);
+			}
+		}
+
+		no_batch = res;
+#else
+		for (i = 0; i < no_batch; i++) {
+			rs_send_msghdr_init(&msg_hdr, &msg_iovecs[i], cmsg_bufs[i],
+			    sizeof(cmsg_bufs[i]), &msgs[no_sent + i]);
+
+			sent = sendmsg(sock, &msg_hdr, 0);
+			if (sent == -1) {
+				return (rs_send_error_res());
+			}
+
+			if ((size_t)sent != msgs[no_sent + i].msg_len) {
+				DEBUG2_PRINTF("sendto error - sent != msg_size");
+
+				return (-1);
+			}
+		}
+#endif
+		no_sent += no_batch;
+	}
+
+	return (no_sent);
+}
+
+/*
+ * Wait for events on sockets (wait function of socket backend) by poll. Arguments and return
+ * values are same as for rs_poll_timeout, but timeout is relative time to wait and -3 is never
+ * returned.
+ */
+static int
+rs_socket_wait(const int *socks, int no_socks, int timeout, int spin, int *sock_events)
+{
+	struct pollfd pfds[RS_MAX_POLL_SOCKS];
+	struct timeval start_time;
+	int i;
+	int poll_res;
+	int res;
+
+	if (no_socks > RS_MAX_POLL_SOCKS) {
+		DEBUG_PRINTF("Internal error - too many sockets to poll");
+		errx(1, "Internal error - too many sockets to poll");
+	}
+
+	memset(pfds, 0, sizeof(struct pollfd) * no_socks);
+
+	for (i = 0; i < no_socks; i++) {
+		pfds[i].fd = socks[i];
+		pfds[i].events = POLLIN;
+	}
+
+	if (spin) {
+		start_time = util_get_time();
+
+		do {
+			poll_res = poll(pfds, no_socks, 0);
+		} while (poll_res == 0 &&
+		    (int)util_time_absdiff(start_time, util_get_time()) < timeout);
+	} else {
+		poll_res = poll(pfds, no_socks, timeout);
+	}
+
+	if (poll_res == 0) {
+		return (0);
+	}
+
+	if (poll_res == -1) {
 		if (errno == EINTR) {
-			DEBUG2_PRINTF("sendto error - EINTR");
+			DEBUG2_PRINTF("poll error - EINTR");
 			return (-2);
+		} else {
+			DEBUG2_PRINTF("poll error - errno = %d", errno);
+			return (-1);
 		}
+	}
 
-		if (errno == EHOSTUNREACH || errno == EHOSTDOWN || errno == ENETDOWN ||
-		    errno == ENOBUFS) {
-			DEBUG2_PRINTF("sendto error - EHOSTUNREACH || EHOSTDOWN || ENETDOWN ||"
-			    "ENOBUFS");
-			return (-3);
+	res = 0;
+
+	for (i = 0; i < no_socks; i++) {
+		sock_events[i] = 0;
+
+#ifdef MSG_ERRQUEUE
+		if (pfds[i].revents & POLLERR) {
+			pfds[i].revents &= ~POLLERR;
+			sock_events[i] |= RS_EV_ERR;
 		}
+#endif
 
-		DEBUG2_PRINTF("sendto error - errno = %d", errno);
-		return (-1);
-	}
+		if (pfds[i].revents & POLLERR || pfds[i].revents & POLLHUP ||
+		    pfds[i].revents & POLLNVAL) {
+			DEBUG2_PRINTF("poll error. pfds[%d] revents = %d", i, pfds[i].revents);
+			return (-1);
+		}
 
-	if ((size_t)sent != msg_size) {
-		DEBUG2_PRINTF("sendto error - sent != msg_size");
+		if (pfds[i].revents & POLLIN) {
+			sock_events[i] |= RS_EV_READ;
+		}
 
-		return (-1);
+		if (sock_events[i] != 0) {
+			res++;
+		}
 	}
 
-	return (sent);
+	return (res);
 }
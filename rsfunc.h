@@ -21,19 +21,126 @@
 #ifndef _RSFUNC_H_
 #define _RSFUNC_H_
 
+#include "pacefunc.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-extern int	rs_poll_timeout(int unicast_socket, int multicast_socket, int timeout,
-    struct timeval *old_tstamp);
+/*
+ * Size of buffer for reading of original packet from socket error queue. Only beginning of packet
+ * is needed.
+ */
+#define MAX_ERR_MSG_SIZE	512
+
+/*
+ * Maximum number of sockets rs_poll_timeout can wait on
+ */
+#define RS_MAX_POLL_SOCKS	64
+
+/*
+ * Events stored by rs_poll_timeout for every socket
+ */
+#define RS_EV_READ		0x01
+#define RS_EV_ERR		0x02
+
+/*
+ * Maximum number of messages received by one call of rs_receive_msgs
+ */
+#define RS_MAX_BATCH_MSGS	32
+
+/*
+ * Message received by rs_receive_msgs. msg is buffer with msg_len size (set by caller),
+ * from_addr is address of source, timestamp is receive timestamp, ttl is TTL from packet and
+ * recv_size is number of received bytes (or -4 if message is truncated). data points to received
+ * message. It's either msg or (for zero-copy backends) memory of backend, which is valid only
+ * until next rs_poll_timeout call.
+ */
+struct rs_msg {
+	struct sockaddr_storage	from_addr;
+	struct timeval		timestamp;
+	const char		*data;
+	char			*msg;
+	size_t			msg_len;
+	ssize_t			recv_size;
+	uint8_t			ttl;
+};
+
+/*
+ * Message sent by rs_send_msgs. msg is message with msg_len length, to is address where to send
+ * message and tclass is traffic class of message (negative value means traffic class of socket).
+ * txtime is departure time of message (see rs_sendto_txtime) or 0 if message is sent immediately.
+ */
+struct rs_send_msg {
+	const struct sockaddr_storage *to;
+	const char	*msg;
+	size_t		msg_len;
+	uint64_t	txtime;
+	int		tclass;
+};
+
+/*
+ * Transport backend. Backend receives and sends messages on sockets created by sfset functions.
+ * name is name used for selection by rs_backend_set and ts_source is description of source of
+ * receive timestamps. open is called with array of sockets to poll on (before first wait) and
+ * returns 0 on success or -1 on fail, close frees resources of backend. wait has same arguments
+ * and return values as rs_poll_timeout, but timeout is relative and never limited (-3 is returned
+ * if wait should be called again). recv_batch has same arguments and return values as
+ * rs_receive_msgs and send_batch as rs_send_msgs. Receive only backends set send_batch to NULL
+ * and messages are then sent by socket backend. If open of optional backend fails, socket backend
+ * is used instead.
+ */
+struct rs_backend {
+	const char	*name;
+	const char	*ts_source;
+	void		(*close)(void);
+	int		(*open)(const int *socks, int no_socks);
+	int		(*recv_batch)(int sock, struct rs_msg *msgs, int no_msgs);
+	int		(*send_batch)(int sock, const struct rs_send_msg *msgs, int no_msgs);
+	int		(*wait)(const int *socks, int no_socks, int timeout, int spin,
+	    int *sock_events);
+	int		optional;
+};
+
+/*
+ * Portable socket backend
+ */
+extern const struct rs_backend	rs_socket_backend;
+
+extern void	rs_backend_close(void);
+
+extern const char	*rs_backend_name(void);
+
+extern int	rs_backend_open(const int *socks, int no_socks);
+
+extern int	rs_backend_set(const char *name);
+
+extern const char	*rs_backend_ts_source(void);
+
+extern void	rs_pacer_set(struct pace_bucket *pb);
+
+extern int	rs_poll_timeout(const int *socks, int no_socks, int timeout,
+    int max_poll_timeout, int spin, struct timeval *old_tstamp, int *sock_events);
+
+extern int	rs_receive_err(int sock, struct sockaddr_storage *dst_addr, int *err_no,
+    int *icmp_origin);
 
 extern ssize_t	rs_receive_msg(int sock, struct sockaddr_storage *from_addr, char *msg,
     size_t msg_len, uint8_t *ttl, struct timeval *timestamp);
 
+extern int	rs_receive_msgs(int sock, struct rs_msg *msgs, int no_msgs);
+
+extern int	rs_send_msgs(int sock, const struct rs_send_msg *msgs, int no_msgs);
+
 extern ssize_t	rs_sendto(int sock, const char *msg, size_t msg_size,
     const struct sockaddr_storage *to);
 
+extern ssize_t	rs_sendto_tclass(int sock, const char *msg, size_t msg_size,
+    const struct sockaddr_storage *to, int tclass);
+
+extern ssize_t	rs_sendto_txtime(int sock, const char *msg, size_t msg_size,
+    const struct sockaddr_storage *to, uint64_t txtime);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+ * FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Author: agent <agent@local>
+ */
+
+#ifdef __linux__
+/*
+ * Needed for sched_setaffinity and CPU_SET macros
+ */
+#define _GNU_SOURCE
+#endif
+
+#include <sys/types.h>
+
+#include <sys/mman.h>
+
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+#include <errno.h>
+#include <inttypes.h>
+#include <sched.h>
+#include <string.h>
+
+#include "logging.h"
+#include "rtfunc.h"
+#include "util.h"
+
+/*
+ * Touch RT_PREFAULT_STACK_SIZE bytes of stack, so pages are mapped (and locked by mlockall)
+ * before they are needed by main loop.
+ */
+static void
+rt_prefault_stack(void)
+{
+	volatile unsigned char stack[RT_PREFAULT_STACK_SIZE];
+	size_t i;
+
+	for (i = 0; i < sizeof(stack); i += 512) {
+		stack[i] = 0;
+	}
+}
+
+/*
+ * Lock all current and future pages of process in memory and pre-fault stack, so main loop never
+ * waits for page fault.
+ * Function returns 0 on success, otherwise -1 (and errno is set).
+ */
+int
+rt_lock_memory(void)
+{
+
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) == -1) {
+		DEBUG_PRINTF("mlockall failed");
+
+		return (-1);
+	}
+
+	rt_prefault_stack();
+
+	return (0);
+}
+
+/*
+ * Pin process to CPU cpu.
+ * Function returns 0 on success, otherwise -1 (and errno is set). errno is set to ENOTSUP on
+ * systems without support of CPU affinity.
+ */
+int
+rt_set_cpu(int cpu)
+{
+#ifdef __linux__
+	cpu_set_t cpu_set;
+
+	if (cpu < 0 || cpu >= CPU_SETSIZE) {
+		errno = EINVAL;
+
+		return (-1);
+	}
+
+	CPU_ZERO(&cpu_set);
+	CPU_SET(cpu, &cpu_set);
+
+	if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) == -1) {
+		DEBUG_PRINTF("sched_setaffinity failed");
+
+		return (-1);
+	}
+
+	return (0);
+#else
+	DEBUG_PRINTF("CPU affinity is not supported");
+	errno = ENOTSUP;
+
+	return (-1);
+#endif
+}
+
+/*
+ * Set SCHED_FIFO scheduler with priority prio for process.
+ * Function returns 0 on success, otherwise -1 (and errno is set).
+ */
+int
+rt_set_fifo(int prio)
+{
+	struct sched_param param;
+
+	memset(&param, 0, sizeof(param));
+	param.sched_priority = prio;
+
+	if (sched_setscheduler(0, SCHED_FIFO, &param) == -1) {
+		DEBUG_PRINTF("sched_setscheduler failed");
+
+		return (-1);
+	}
+
+	return (0);
+}
+
+/*
+ * Set timer slack of process to slack ns. Kernel may delay expiration of timers (poll timeout) by
+ * up to slack, so wakeups of omping are coalesced with wakeups of other processes.
+ * Function returns 0 on success, otherwise -1 (and errno is set). errno is set to ENOTSUP on
+ * systems without support of timer slack.
+ */
+int
+rt_set_timer_slack(uint64_t slack)
+{
+#ifdef PR_SET_TIMERSLACK
+	if (prctl(PR_SET_TIMERSLACK, (unsigned long)slack, 0, 0, 0) == -1) {
+		DEBUG_PRINTF("prctl PR_SET_TIMERSLACK failed");
+
+		return (-1);
+	}
+
+	return (0);
+#else
+	DEBUG_PRINTF("Timer slack is not supported");
+	errno = ENOTSUP;
+
+	return (-1);
+#endif
+}
+
+/*
+ * Add delay (in ns) to self-jitter statistics stats.
+ */
+void
+rt_stats_add(struct rt_stats *stats, double delay)
+{
+
+	stats->no_samples++;
+	util_ov_update(&stats->avg_delay, &stats->m2_delay, delay, stats->no_samples);
+
+	if (delay > stats->max_delay) {
+		stats->max_delay = delay;
+	}
+}
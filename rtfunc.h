@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+ * FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Author: agent <agent@local>
+ */
+
+#ifndef _RTFUNC_H_
+#define _RTFUNC_H_
+
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Size of stack (in bytes) which is pre-faulted by rt_lock_memory
+ */
+#define RT_PREFAULT_STACK_SIZE	(256 * 1024)
+
+/*
+ * Default, minimal and maximal SCHED_FIFO priority which can be set by user
+ */
+#define RT_DEF_FIFO_PRIO	50
+#define RT_MIN_FIFO_PRIO	1
+#define RT_MAX_FIFO_PRIO	99
+
+/*
+ * Structures definition
+ */
+
+/*
+ * Real-time options. cpu is CPU to pin process to (or -1), fifo_prio is SCHED_FIFO priority (or
+ * 0 for default scheduler), mlock is boolean which enables locking of memory, busy_poll is
+ * SO_BUSY_POLL time in us (or 0) and spin is boolean which enables spinning on sockets instead of
+ * sleeping in poll. enabled is set if any of options is set.
+ */
+struct rt_opts {
+	int	busy_poll;
+	int	cpu;
+	int	enabled;
+	int	fifo_prio;
+	int	mlock;
+	int	spin;
+};
+
+/*
+ * Self-jitter statistics. Every sample is delay (in ns) between kernel receive timestamp of packet
+ * and time when omping got packet. avg_delay and m2_delay are online mean and M2 of delays,
+ * max_delay is maximum delay and no_samples is number of samples.
+ */
+struct rt_stats {
+	double		avg_delay;
+	double		m2_delay;
+	double		max_delay;
+	uint64_t	no_samples;
+};
+
+/*
+ * Prototypes
+ */
+extern int		rt_lock_memory(void);
+
+extern int		rt_set_cpu(int cpu);
+
+extern int		rt_set_fifo(int prio);
+
+extern int		rt_set_timer_slack(uint64_t slack);
+
+extern void		rt_stats_add(struct rt_stats *stats, double delay);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RTFUNC_H_ */
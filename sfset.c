@@ -26,8 +26,13 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
+#ifdef __linux__
+#include <linux/net_tstamp.h>
+#endif
+
 #include <err.h>
 #include <errno.h>
+#include <limits.h>
 #include <netdb.h>
 #include <string.h>
 
@@ -117,6 +122,47 @@ sfset_broadcast(int sock, int enable)
 	return (0);
 }
 
+/*
+ * Enable busy polling of socket. busy_poll is time in us to busy poll device queue on blocking
+ * receive or poll. Preferred busy polling (interrupts of device queue are deferred while
+ * application keeps busy polling) is also enabled if supported.
+ * Function returns 0 on success, otherwise -1 (errno is set to ENOTSUP if busy polling is not
+ * supported by OS).
+ */
+int
+sfset_busy_poll(int sock, int busy_poll)
+{
+#ifdef SO_BUSY_POLL
+#ifdef SO_PREFER_BUSY_POLL
+	int opt;
+#endif
+
+	if (setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &busy_poll, sizeof(busy_poll)) == -1) {
+		DEBUG_PRINTF("setsockopt SO_BUSY_POLL failed");
+
+		return (-1);
+	}
+
+#ifdef SO_PREFER_BUSY_POLL
+	opt = 1;
+
+	if (setsockopt(sock, SOL_SOCKET, SO_PREFER_BUSY_POLL, &opt, sizeof(opt)) == -1) {
+		/*
+		 * Older kernels don't know option. Plain busy polling is still enabled.
+		 */
+		DEBUG_PRINTF("setsockopt SO_PREFER_BUSY_POLL failed");
+	}
+#endif
+
+	return (0);
+#else
+	DEBUG_PRINTF("SO_BUSY_POLL is not supported");
+	errno = ENOTSUP;
+
+	return (-1);
+#endif
+}
+
 /*
  * Set ipv6 only flag to socket. Function works only for socket with family AF_INET6.
  * Function returns 0 on success, otherwise -1.
@@ -143,6 +189,38 @@ sfset_ipv6only(const struct sockaddr *sa, int sock)
 	return (0);
 }
 
+/*
+ * Set maximum pacing rate of socket. rate is rate in bytes per second. Kernel then spreads packets
+ * of socket in time, so they are not sent in bursts (requires fq qdisc for UDP sockets).
+ * Function returns 0 on success, otherwise -1 (errno is set to ENOTSUP if pacing is not supported
+ * by OS).
+ */
+int
+sfset_max_pacing_rate(int sock, uint64_t rate)
+{
+#ifdef SO_MAX_PACING_RATE
+	unsigned int opt;
+
+	/*
+	 * ~0 means unlimited rate
+	 */
+	opt = (rate < UINT_MAX ? (unsigned int)rate : UINT_MAX - 1);
+
+	if (setsockopt(sock, SOL_SOCKET, SO_MAX_PACING_RATE, &opt, sizeof(opt)) == -1) {
+		DEBUG_PRINTF("setsockopt SO_MAX_PACING_RATE failed");
+
+		return (-1);
+	}
+
+	return (0);
+#else
+	DEBUG_PRINTF("SO_MAX_PACING_RATE is not supported");
+	errno = ENOTSUP;
+
+	return (-1);
+#endif
+}
+
 /*
  * Set interface to use for sending multicast packets. local_addr is interface from which packets
  * will be send. sock is socket to set option and local_ifname is name of interface with local_addr
@@ -227,6 +305,50 @@ sfset_mcast_loop(const struct sockaddr *mcast_addr, int sock, int enable)
 	return (0);
 }
 
+/*
+ * Set option to queue extended errors (asynchronous ICMP errors) to socket error queue. sa is
+ * sockaddr used for address family and sock is socket to use.
+ * Function returns 0 on success. -2 is returned on systems, where IP_RECVERR is not available,
+ * otherwise -1 is returned.
+ */
+int
+sfset_recverr(const struct sockaddr *sa, int sock)
+{
+	int opt;
+
+	opt = 1;
+
+	switch (sa->sa_family) {
+	case AF_INET:
+#ifdef IP_RECVERR
+		if (setsockopt(sock, IPPROTO_IP, IP_RECVERR, &opt, sizeof(opt)) == -1) {
+			DEBUG_PRINTF("setsockopt IP_RECVERR failed");
+
+			return (-1);
+		}
+#else
+		return (-2);
+#endif
+		break;
+	case AF_INET6:
+#ifdef IPV6_RECVERR
+		if (setsockopt(sock, IPPROTO_IPV6, IPV6_RECVERR, &opt, sizeof(opt)) == -1) {
+			DEBUG_PRINTF("setsockopt IPV6_RECVERR failed");
+
+			return (-1);
+		}
+#else
+		return (-2);
+#endif
+		break;
+	default:
+		DEBUG_PRINTF("Unknown sockaddr family");
+		errx(1, "Unknown sockaddr family");
+	}
+
+	return (0);
+}
+
 /*
  * Set option to receive TTL inside packet information (recvmsg). sa is sockaddr used for address
  * family and sock is socket to use.
@@ -304,6 +426,44 @@ sfset_reuse(int sock)
 	return (0);
 }
 
+/*
+ * Set traffic class (IPv4 TOS or IPv6 Traffic Class) of packets sent by socket sock. sa is sockaddr
+ * used for address family and tclass is value of traffic class (DSCP is stored in upper 6 bits).
+ * Function returns 0 on success, otherwise -1.
+ */
+int
+sfset_tclass(const struct sockaddr *sa, int sock, int tclass)
+{
+
+	switch (sa->sa_family) {
+	case AF_INET:
+		if (setsockopt(sock, IPPROTO_IP, IP_TOS, &tclass, sizeof(tclass)) == -1) {
+			DEBUG_PRINTF("setsockopt IP_TOS failed");
+
+			return (-1);
+		}
+		break;
+	case AF_INET6:
+#ifdef IPV6_TCLASS
+		if (setsockopt(sock, IPPROTO_IPV6, IPV6_TCLASS, &tclass, sizeof(tclass)) == -1) {
+			DEBUG_PRINTF("setsockopt IPV6_TCLASS failed");
+
+			return (-1);
+		}
+#else
+		DEBUG_PRINTF("IPV6_TCLASS is not supported");
+
+		return (-1);
+#endif
+		break;
+	default:
+		DEBUG_PRINTF("Unknown sockaddr family");
+		errx(1, "Unknown sockaddr family");
+	}
+
+	return (0);
+}
+
 /*
  * Enable receiving of timestamp for socket.
  * Function returns 0 on success, otherwise -1.
@@ -384,3 +544,34 @@ sfset_ttl(const struct sockaddr *sa, enum sf_cast_type cast_type, int sock, uint
 
 	return (0);
 }
+
+/*
+ * Enable scheduled transmission (SO_TXTIME) for socket. Messages with departure time (SCM_TXTIME
+ * ancillary data) are then held by qdisc until departure time. clock_id is clock used for
+ * departure times (CLOCK_MONOTONIC for fq qdisc or CLOCK_TAI for etf qdisc).
+ * Function returns 0 on success, otherwise -1 (errno is set to ENOTSUP if scheduled transmission
+ * is not supported by OS).
+ */
+int
+sfset_txtime(int sock, int clock_id)
+{
+#ifdef SO_TXTIME
+	struct sock_txtime txtime;
+
+	memset(&txtime, 0, sizeof(txtime));
+	txtime.clockid = clock_id;
+
+	if (setsockopt(sock, SOL_SOCKET, SO_TXTIME, &txtime, sizeof(txtime)) == -1) {
+		DEBUG_PRINTF("setsockopt SO_TXTIME failed");
+
+		return (-1);
+	}
+
+	return (0);
+#else
+	DEBUG_PRINTF("SO_TXTIME is not supported");
+	errno = ENOTSUP;
+
+	return (-1);
+#endif
+}
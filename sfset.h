@@ -35,17 +35,23 @@ extern int	sfset_buf_size(int sock, int snd_buf, int buf_size, int *new_buf_size
     int force_buf_size);
 
 extern int	sfset_broadcast(int sock, int enable);
+extern int	sfset_busy_poll(int sock, int busy_poll);
 extern int	sfset_ipv6only(const struct sockaddr *sa, int sock);
+extern int	sfset_max_pacing_rate(int sock, uint64_t rate);
 extern int	sfset_mcast_if(const struct sockaddr *local_addr, int sock,
     const char *local_ifname);
 
 extern int	sfset_mcast_loop(const struct sockaddr *mcast_addr, int sock, int enable);
+extern int	sfset_recverr(const struct sockaddr *sa, int sock);
 extern int	sfset_recvttl(const struct sockaddr *sa, int sock);
 extern int	sfset_reuse(int sock);
+extern int	sfset_tclass(const struct sockaddr *sa, int sock, int tclass);
 extern int	sfset_timestamp(int sock);
 extern int	sfset_ttl(const struct sockaddr *sa, enum sf_cast_type cast_type, int sock,
     uint8_t ttl);
 
+extern int	sfset_txtime(int sock, int clock_id);
+
 #ifdef __cplusplus
 }
 #endif
@@ -219,7 +219,7 @@ sf_create_udp_socket(const struct sockaddr *sa)
  * to allocate for receiving packets. bind_port is port to bind. It can be set to NULL, and then
  * port from local_addr is used. If real pointer is used, and value is 0, random port is choosen and
  * real port is returned there. Other value will bind port to given value. Port is in network
- * format.
+ * format. If supported by OS, asynchronous ICMP errors are queued to socket error queue.
  * Return -1 on failure, otherwise socket file descriptor is returned.
  */
 int
@@ -242,6 +242,10 @@ sf_create_unicast_socket(const struct sockaddr *local_addr, uint8_t ttl, int mca
 		return (-1);
 	}
 
+	if (sfset_recverr(local_addr, sock) == -1) {
+		return (-1);
+	}
+
 	if (mcast_send) {
 		switch (transport_method) {
 		case SF_TM_ASM:
@@ -98,12 +98,61 @@ tlv_add_actual_ts(char *msg, size_t msg_len, size_t *pos, enum tlv_opt_type opt)
 }
 
 /*
- * Add TLV with actual client time stamp
+ * Add TLV with client time stamp. tstamp is time stamp to add or NULL for actual time stamp.
  */
 int
-tlv_add_client_tstamp(char *msg, size_t msg_len, size_t *pos)
+tlv_add_client_tstamp(char *msg, size_t msg_len, size_t *pos, const struct timeval *tstamp)
 {
-	return (tlv_add_actual_ts(msg, msg_len, pos, TLV_OPT_TYPE_CLIENT_TSTAMP));
+	struct timeval tv;
+
+	if (tstamp == NULL) {
+		return (tlv_add_actual_ts(msg, msg_len, pos, TLV_OPT_TYPE_CLIENT_TSTAMP));
+	}
+
+	tv = *tstamp;
+
+	return (tlv_add_ts(msg, msg_len, pos, TLV_OPT_TYPE_CLIENT_TSTAMP, &tv));
+}
+
+/*
+ * Add TLV with runs of lost multicast packets. Value consists of first and end sequence number of
+ * finalized range (32-bit), number of lost packets not fitting into runs (16-bit) and runs, each
+ * consisting of sequence number of first lost packet (32-bit) and length of run (16-bit).
+ * Everything is in network byte order.
+ */
+int
+tlv_add_loss_runs(char *msg, size_t msg_len, size_t *pos, const struct tlv_loss_runs *loss_runs)
+{
+	char value[2 * sizeof(uint32_t) + sizeof(uint16_t) +
+	    TLV_LOSS_MAX_RUNS * (sizeof(uint32_t) + sizeof(uint16_t))];
+	size_t val_pos;
+	uint32_t u32;
+	uint16_t u16;
+	int i;
+
+	u32 = htonl(loss_runs->first_seq);
+	memcpy(value, &u32, sizeof(u32));
+	val_pos = sizeof(u32);
+
+	u32 = htonl(loss_runs->end_seq);
+	memcpy(value + val_pos, &u32, sizeof(u32));
+	val_pos += sizeof(u32);
+
+	u16 = htons(loss_runs->no_overflow);
+	memcpy(value + val_pos, &u16, sizeof(u16));
+	val_pos += sizeof(u16);
+
+	for (i = 0; i < loss_runs->no_runs && i < TLV_LOSS_MAX_RUNS; i++) {
+		u32 = htonl(loss_runs->runs[i].seq);
+		memcpy(value + val_pos, &u32, sizeof(u32));
+		val_pos += sizeof(u32);
+
+		u16 = htons(loss_runs->runs[i].len);
+		memcpy(value + val_pos, &u16, sizeof(u16));
+		val_pos += sizeof(u16);
+	}
+
+	return (tlv_add(msg, msg_len, pos, TLV_OPT_TYPE_LOSS_RUNS, val_pos, value));
 }
 
 /*
@@ -124,6 +173,19 @@ tlv_add_mcast_prefix(char *msg, size_t msg_len, size_t *pos, const struct sockad
 	return (tlv_add_sas(msg, msg_len, pos, TLV_OPT_TYPE_MCAST_PREFIX, sas, 1));
 }
 
+/*
+ * Add TLV with multicast sequence number. This is sequence number of multicast packet counted
+ * over all multicast packets of sender (regardless of client).
+ */
+int
+tlv_add_mcast_seq(char *msg, size_t msg_len, size_t *pos, uint32_t seq)
+{
+	uint32_t nseq;
+
+	nseq = htonl(seq);
+	return (tlv_add(msg, msg_len, pos, TLV_OPT_TYPE_MCAST_SEQ, sizeof(nseq), &nseq));
+}
+
 /*
  * Add TLV with option request option. Options are passed in opts array with opts_len length.
  */
@@ -151,6 +213,94 @@ tlv_add_opt_request(char *msg, size_t msg_len, size_t *pos, uint16_t *opts, size
 	return (tlv_add(msg, msg_len, pos, TLV_OPT_TYPE_OPT_REQUEST, val_len, value));
 }
 
+/*
+ * Add TLV with summary of one peer. Value consists of IANA address family, address, number of
+ * sent packets, number of received unicast and multicast packets, average unicast and multicast
+ * RTT in us (all 32-bit) and unicast and multicast RTT histograms (16-bit per bucket). Everything
+ * is in network byte order.
+ */
+int
+tlv_add_peer_summary(char *msg, size_t msg_len, size_t *pos,
+    const struct tlv_peer_summary *peer_summary)
+{
+	char value[2 + 16 + 5 * sizeof(uint32_t) + 2 * TLV_RTT_HIST_BUCKETS * sizeof(uint16_t)];
+	const struct tlv_peer_stats *stats;
+	const void *addr_pointer;
+	size_t addr_len;
+	size_t val_pos;
+	uint32_t u32s[5];
+	uint16_t af;
+	uint16_t u16;
+	int i, j;
+
+	switch (peer_summary->addr.ss_family) {
+	case AF_INET:
+		af = AF_IANA_IP;
+		addr_len = sizeof(struct in_addr);
+		addr_pointer = &((const struct sockaddr_in *)&peer_summary->addr)->sin_addr;
+		break;
+	case AF_INET6:
+		af = AF_IANA_IP6;
+		addr_len = sizeof(struct in6_addr);
+		addr_pointer = &((const struct sockaddr_in6 *)&peer_summary->addr)->sin6_addr;
+		break;
+	default:
+		DEBUG_PRINTF("Unknown sas family %d", peer_summary->addr.ss_family);
+		errx(1, "Unknown sas family %d", peer_summary->addr.ss_family);
+	}
+
+	stats = &peer_summary->stats;
+
+	af = htons(af);
+	memcpy(value, &af, sizeof(af));
+	val_pos = sizeof(af);
+
+	memcpy(value + val_pos, addr_pointer, addr_len);
+	val_pos += addr_len;
+
+	u32s[0] = stats->no_sent;
+	u32s[1] = stats->no_received[0];
+	u32s[2] = stats->no_received[1];
+	u32s[3] = stats->avg_rtt_us[0];
+	u32s[4] = stats->avg_rtt_us[1];
+
+	for (i = 0; i < 5; i++) {
+		u32s[i] = htonl(u32s[i]);
+		memcpy(value + val_pos, &u32s[i], sizeof(uint32_t));
+		val_pos += sizeof(uint32_t);
+	}
+
+	for (i = 0; i < 2; i++) {
+		for (j = 0; j < TLV_RTT_HIST_BUCKETS; j++) {
+			u16 = htons(stats->rtt_hist[i][j]);
+			memcpy(value + val_pos, &u16, sizeof(u16));
+			val_pos += sizeof(u16);
+		}
+	}
+
+	return (tlv_add(msg, msg_len, pos, TLV_OPT_TYPE_PEER_SUMMARY, val_pos, value));
+}
+
+/*
+ * Add TLV with number of test profile of query (see proffunc.h) followed by pad_len zero bytes of
+ * padding. Option is copied to answers, so answers are recognized as answers of profile and they
+ * have same size as query.
+ */
+int
+tlv_add_profile(char *msg, size_t msg_len, size_t *pos, uint8_t profile, size_t pad_len)
+{
+	char value[PROF_MAX_SIZE];
+
+	if (pad_len + 1 > sizeof(value)) {
+		return (-1);
+	}
+
+	value[0] = (char)profile;
+	memset(value + 1, 0, pad_len);
+
+	return (tlv_add(msg, msg_len, pos, TLV_OPT_TYPE_PROFILE, pad_len + 1, value));
+}
+
 /*
  * Add TLV with sockaddr_storage ip address. If store_prefix_len is set, prefix length of address
  * (always full prefix) is also stored.
@@ -229,6 +379,33 @@ tlv_add_server_info(char *msg, size_t msg_len, size_t *pos, const char *server_i
 	    server_info));
 }
 
+/*
+ * Add TLV with server side statistics of queries received from client. Values are stored in
+ * order received, answered, first seq, max seq and jitter (in us), every one as 32-bit number in
+ * network byte order.
+ */
+int
+tlv_add_server_stats(char *msg, size_t msg_len, size_t *pos,
+    const struct tlv_server_stats *server_stats)
+{
+	char value[5 * sizeof(uint32_t)];
+	uint32_t u32s[5];
+	int i;
+
+	u32s[0] = server_stats->no_received;
+	u32s[1] = server_stats->no_answered;
+	u32s[2] = server_stats->first_seq;
+	u32s[3] = server_stats->max_seq;
+	u32s[4] = server_stats->jitter_us;
+
+	for (i = 0; i < 5; i++) {
+		u32s[i] = htonl(u32s[i]);
+		memcpy(value + i * sizeof(uint32_t), &u32s[i], sizeof(uint32_t));
+	}
+
+	return (tlv_add(msg, msg_len, pos, TLV_OPT_TYPE_SERVER_STATS, sizeof(value), value));
+}
+
 /*
  * Add TLV with actual server timestamp
  */
@@ -258,6 +435,35 @@ tlv_add_ts(char *msg, size_t msg_len, size_t *pos, enum tlv_opt_type opt, struct
 	return (tlv_add(msg, msg_len, pos, opt, sizeof(value), value));
 }
 
+/*
+ * Add TLV with number of queries not answered because of rate limit. count is total number of
+ * throttled queries in current session and last_seq is sequence number of last throttled query.
+ */
+int
+tlv_add_throttled(char *msg, size_t msg_len, size_t *pos, uint32_t count, uint32_t last_seq)
+{
+	char value[8];
+	uint32_t u32;
+
+	u32 = htonl(count);
+	memcpy(value, &u32, sizeof(u32));
+
+	u32 = htonl(last_seq);
+	memcpy(value + sizeof(u32), &u32, sizeof(u32));
+
+	return (tlv_add(msg, msg_len, pos, TLV_OPT_TYPE_THROTTLED, sizeof(value), value));
+}
+
+/*
+ * Add TLV with traffic class (IPv4 TOS or IPv6 Traffic Class) of query. Answers to query are sent
+ * with same traffic class.
+ */
+int
+tlv_add_traffic_class(char *msg, size_t msg_len, size_t *pos, uint8_t tclass)
+{
+	return (tlv_add_u8(msg, msg_len, pos, TLV_OPT_TYPE_TRAFFIC_CLASS, tclass));
+}
+
 /*
  * Add server's TTL TLV
  */
@@ -366,6 +572,63 @@ tlv_iter_item_copy(const struct tlv_iterator *tlv_iter, char *new_msg, size_t ne
 	return (0);
 }
 
+/*
+ * Decode loss runs item currently pointed by iterator tlv_iter to loss_runs.
+ * Function returns 0 on success, or -1 if item is malformed.
+ */
+int
+tlv_iter_loss_runs(const struct tlv_iterator *tlv_iter, struct tlv_loss_runs *loss_runs)
+{
+	const char *data;
+	size_t run_len;
+	size_t val_pos;
+	uint32_t u32;
+	uint16_t len;
+	uint16_t u16;
+	int i;
+
+	data = tlv_iter_get_data(tlv_iter);
+	len = tlv_iter_get_len(tlv_iter);
+	run_len = sizeof(uint32_t) + sizeof(uint16_t);
+
+	if (len < 2 * sizeof(uint32_t) + sizeof(uint16_t)) {
+		return (-1);
+	}
+
+	len -= 2 * sizeof(uint32_t) + sizeof(uint16_t);
+	if (len % run_len != 0 || len / run_len > TLV_LOSS_MAX_RUNS) {
+		return (-1);
+	}
+
+	memset(loss_runs, 0, sizeof(*loss_runs));
+
+	memcpy(&u32, data, sizeof(u32));
+	loss_runs->first_seq = ntohl(u32);
+	val_pos = sizeof(u32);
+
+	memcpy(&u32, data + val_pos, sizeof(u32));
+	loss_runs->end_seq = ntohl(u32);
+	val_pos += sizeof(u32);
+
+	memcpy(&u16, data + val_pos, sizeof(u16));
+	loss_runs->no_overflow = ntohs(u16);
+	val_pos += sizeof(u16);
+
+	loss_runs->no_runs = len / run_len;
+
+	for (i = 0; i < loss_runs->no_runs; i++) {
+		memcpy(&u32, data + val_pos, sizeof(u32));
+		loss_runs->runs[i].seq = ntohl(u32);
+		val_pos += sizeof(u32);
+
+		memcpy(&u16, data + val_pos, sizeof(u16));
+		loss_runs->runs[i].len = ntohs(u16);
+		val_pos += sizeof(u16);
+	}
+
+	return (0);
+}
+
 /*
  * Move iterator to the next item. Returns 0 when move was successful, or -1 if end of the message
  * was reached.
@@ -391,6 +654,87 @@ tlv_iter_next(struct tlv_iterator *tlv_iter)
 	return (0);
 }
 
+/*
+ * Decode peer summary item currently pointed by iterator tlv_iter to peer_summary. Port of
+ * address is set to 0.
+ * Function returns 0 on success, or -1 if item is malformed.
+ */
+int
+tlv_iter_peer_summary(const struct tlv_iterator *tlv_iter, struct tlv_peer_summary *peer_summary)
+{
+	struct tlv_peer_stats *stats;
+	const char *data;
+	size_t addr_len;
+	size_t val_pos;
+	uint32_t u32s[5];
+	uint16_t af;
+	uint16_t u16;
+	int i, j;
+
+	data = tlv_iter_get_data(tlv_iter);
+
+	if (tlv_iter_get_len(tlv_iter) < sizeof(af)) {
+		return (-1);
+	}
+
+	memcpy(&af, data, sizeof(af));
+	af = ntohs(af);
+
+	memset(peer_summary, 0, sizeof(*peer_summary));
+
+	switch (af) {
+	case AF_IANA_IP:
+		addr_len = sizeof(struct in_addr);
+		break;
+	case AF_IANA_IP6:
+		addr_len = sizeof(struct in6_addr);
+		break;
+	default:
+		return (-1);
+	}
+
+	if (tlv_iter_get_len(tlv_iter) != sizeof(af) + addr_len + 5 * sizeof(uint32_t) +
+	    2 * TLV_RTT_HIST_BUCKETS * sizeof(uint16_t)) {
+		return (-1);
+	}
+
+	val_pos = sizeof(af);
+
+	if (af == AF_IANA_IP) {
+		peer_summary->addr.ss_family = AF_INET;
+		memcpy(&((struct sockaddr_in *)&peer_summary->addr)->sin_addr, data + val_pos,
+		    addr_len);
+	} else {
+		peer_summary->addr.ss_family = AF_INET6;
+		memcpy(&((struct sockaddr_in6 *)&peer_summary->addr)->sin6_addr, data + val_pos,
+		    addr_len);
+	}
+	val_pos += addr_len;
+
+	for (i = 0; i < 5; i++) {
+		memcpy(&u32s[i], data + val_pos, sizeof(uint32_t));
+		u32s[i] = ntohl(u32s[i]);
+		val_pos += sizeof(uint32_t);
+	}
+
+	stats = &peer_summary->stats;
+	stats->no_sent = u32s[0];
+	stats->no_received[0] = u32s[1];
+	stats->no_received[1] = u32s[2];
+	stats->avg_rtt_us[0] = u32s[3];
+	stats->avg_rtt_us[1] = u32s[4];
+
+	for (i = 0; i < 2; i++) {
+		for (j = 0; j < TLV_RTT_HIST_BUCKETS; j++) {
+			memcpy(&u16, data + val_pos, sizeof(u16));
+			stats->rtt_hist[i][j] = ntohs(u16);
+			val_pos += sizeof(u16);
+		}
+	}
+
+	return (0);
+}
+
 /*
  * Compare msg item pointed by iterator of MCAST_PREFIX type with sockaddr address
  */
@@ -480,6 +824,13 @@ tlv_opt_type_to_str(enum tlv_opt_type opt)
 	case TLV_OPT_TYPE_MCAST_PREFIX: res = "Multicast Prefix"; break;
 	case TLV_OPT_TYPE_SES_ID: res = "Session ID"; break;
 	case TLV_OPT_TYPE_SERVER_TSTAMP: res = "Server Timestamp"; break;
+	case TLV_OPT_TYPE_THROTTLED: res = "Throttled"; break;
+	case TLV_OPT_TYPE_SERVER_STATS: res = "Server Statistics"; break;
+	case TLV_OPT_TYPE_PEER_SUMMARY: res = "Peer Summary"; break;
+	case TLV_OPT_TYPE_MCAST_SEQ: res = "Multicast Sequence Number"; break;
+	case TLV_OPT_TYPE_LOSS_RUNS: res = "Loss Runs"; break;
+	case TLV_OPT_TYPE_TRAFFIC_CLASS: res = "Traffic Class"; break;
+	case TLV_OPT_TYPE_PROFILE: res = "Profile"; break;
 	default: res = "Unknown"; break;
 	}
 
@@ -22,6 +22,7 @@
 #define _TLV_H_
 
 #include <sys/socket.h>
+#include <sys/time.h>
 
 #include <netinet/in.h>
 
@@ -57,6 +58,76 @@ enum tlv_opt_type {
 	TLV_OPT_TYPE_MCAST_PREFIX	= 10,
 	TLV_OPT_TYPE_SES_ID		= 11,
 	TLV_OPT_TYPE_SERVER_TSTAMP	= 12,
+	TLV_OPT_TYPE_THROTTLED		= 13,
+	TLV_OPT_TYPE_SERVER_STATS	= 14,
+	TLV_OPT_TYPE_PEER_SUMMARY	= 15,
+	TLV_OPT_TYPE_MCAST_SEQ		= 16,
+	TLV_OPT_TYPE_LOSS_RUNS		= 17,
+	TLV_OPT_TYPE_TRAFFIC_CLASS	= 18,
+	TLV_OPT_TYPE_PROFILE		= 19,
+};
+
+/*
+ * Number of buckets of RTT histogram in peer summary. Bucket 0 contains RTT < 32 us, bucket i
+ * contains RTT in range <2^(i + 4), 2^(i + 5)) us and last bucket contains everything bigger.
+ */
+#define TLV_RTT_HIST_BUCKETS	12
+
+/*
+ * Maximum number of runs of lost packets in one Loss Runs option
+ */
+#define TLV_LOSS_MAX_RUNS	16
+
+/*
+ * Run of len consecutive lost packets starting with seq
+ */
+struct tlv_loss_run {
+	uint32_t	seq;
+	uint16_t	len;
+};
+
+/*
+ * Multicast packets of one sender (identified by sender multicast sequence number) finalized by
+ * receiver in range <first_seq, end_seq). runs are lost packets in range. no_overflow is number of
+ * lost packets which didn't fit into runs.
+ */
+struct tlv_loss_runs {
+	struct tlv_loss_run	runs[TLV_LOSS_MAX_RUNS];
+	uint32_t		end_seq;
+	uint32_t		first_seq;
+	uint16_t		no_overflow;
+	uint8_t			no_runs;
+};
+
+/*
+ * Statistics of one peer as seen by reporting node (index 0 is unicast, 1 is multicast)
+ */
+struct tlv_peer_stats {
+	uint32_t	avg_rtt_us[2];
+	uint32_t	no_received[2];
+	uint32_t	no_sent;
+	uint16_t	rtt_hist[2][TLV_RTT_HIST_BUCKETS];
+};
+
+/*
+ * Peer summary carried in stats report message
+ */
+struct tlv_peer_summary {
+	struct sockaddr_storage	addr;
+	struct tlv_loss_runs	loss;
+	struct tlv_peer_stats	stats;
+	int			loss_isset;
+};
+
+/*
+ * Server side statistics of queries received from one client in current session
+ */
+struct tlv_server_stats {
+	uint32_t	first_seq;
+	uint32_t	jitter_us;
+	uint32_t	max_seq;
+	uint32_t	no_answered;
+	uint32_t	no_received;
 };
 
 /*
@@ -74,7 +145,11 @@ struct tlv_iterator {
 extern int	tlv_add(char *msg, size_t msg_len, size_t *pos, enum tlv_opt_type opt_type,
     uint16_t opt_len, const void *value);
 
-extern int	tlv_add_client_tstamp(char *msg, size_t msg_len, size_t *pos);
+extern int	tlv_add_client_tstamp(char *msg, size_t msg_len, size_t *pos,
+    const struct timeval *tstamp);
+
+extern int	tlv_add_loss_runs(char *msg, size_t msg_len, size_t *pos,
+    const struct tlv_loss_runs *loss_runs);
 
 extern int	tlv_add_mcast_grp(char *msg, size_t msg_len, size_t *pos,
     const struct sockaddr_storage *sas);
@@ -82,16 +157,33 @@ extern int	tlv_add_mcast_grp(char *msg, size_t msg_len, size_t *pos,
 extern int	tlv_add_mcast_prefix(char *msg, size_t msg_len, size_t *pos,
     const struct sockaddr_storage *sas);
 
+extern int	tlv_add_mcast_seq(char *msg, size_t msg_len, size_t *pos, uint32_t seq);
+
 extern int	tlv_add_opt_request(char *msg, size_t msg_len, size_t *pos, uint16_t *opts,
     size_t opts_len);
 
+extern int	tlv_add_peer_summary(char *msg, size_t msg_len, size_t *pos,
+    const struct tlv_peer_summary *peer_summary);
+
+extern int	tlv_add_profile(char *msg, size_t msg_len, size_t *pos, uint8_t profile,
+    size_t pad_len);
+
 extern int	tlv_add_seq_num(char *msg, size_t msg_len, size_t *pos, uint32_t seq);
 
 extern int	tlv_add_server_info(char *msg, size_t msg_len, size_t *pos,
     const char *server_info);
 
+extern int	tlv_add_server_stats(char *msg, size_t msg_len, size_t *pos,
+    const struct tlv_server_stats *server_stats);
+
 extern int	tlv_add_server_tstamp(char *msg, size_t msg_len, size_t *pos);
 
+extern int	tlv_add_throttled(char *msg, size_t msg_len, size_t *pos, uint32_t count,
+    uint32_t last_seq);
+
+extern int	tlv_add_traffic_class(char *msg, size_t msg_len, size_t *pos,
+    uint8_t tclass);
+
 extern int	tlv_add_ttl(char *msg, size_t msg_len, size_t *pos, uint8_t ttl);
 
 extern int	tlv_add_version(char *msg, size_t msg_len, size_t *pos);
@@ -107,8 +199,14 @@ extern void	tlv_iter_init(const char *msg, size_t msg_len, struct tlv_iterator *
 extern int	tlv_iter_item_copy(const struct tlv_iterator *tlv_iter, char *new_msg,
     size_t new_msg_len,    size_t *pos);
 
+extern int	tlv_iter_loss_runs(const struct tlv_iterator *tlv_iter,
+    struct tlv_loss_runs *loss_runs);
+
 extern int	tlv_iter_next(struct tlv_iterator *tlv_iter);
 
+extern int	tlv_iter_peer_summary(const struct tlv_iterator *tlv_iter,
+    struct tlv_peer_summary *peer_summary);
+
 extern int	tlv_iter_pref_eq(const struct tlv_iterator *tlv_iter,
     const struct sockaddr_storage *sas);
 
@@ -122,6 +122,21 @@ util_cygwin_gettimeofday(struct timeval *tv, struct timezone *tz)
 }
 #endif /* __CYGWIN__ */
 
+/*
+ * Return current time of clock clock_id in ns. 0 is returned if clock can't be read.
+ */
+uint64_t
+util_clock_ns(int clock_id)
+{
+	struct timespec ts;
+
+	if (clock_gettime((clockid_t)clock_id, &ts) == -1) {
+		return (0);
+	}
+
+	return ((uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec);
+}
+
 /*
  * Returns absolute value of n
  */
@@ -323,6 +338,20 @@ util_time_double_absdiff_us(struct timeval t1, struct timeval t2)
 	return (dt1 - dt2);
 }
 
+/*
+ * Return timeval structure from number of nanoseconds ns
+ */
+struct timeval
+util_ns_to_tv(uint64_t ns)
+{
+	struct timeval tv;
+
+	tv.tv_sec = ns / 1000000000;
+	tv.tv_usec = (ns % 1000000000) / 1000;
+
+	return (tv);
+}
+
 /*
  * Return standard deviation based on m2 value and number of items n. Value is rounded to 0.001.
  */
@@ -374,6 +403,26 @@ util_packet_loss_percent(uint64_t packet_sent, uint64_t packet_received)
 	return (loss);
 }
 
+/*
+ * Return value randomized by +- jitter_pct percent of value. Returned value is never smaller then
+ * 0.
+ */
+int
+util_rand_jitter(int value, int jitter_pct)
+{
+	long int range;
+	long int res;
+
+	range = (long int)value * jitter_pct / 100;
+	if (range <= 0) {
+		return (value);
+	}
+
+	res = value - range + random() % (2 * range + 1);
+
+	return (res < 0 ? 0 : (int)res);
+}
+
 /*
  * Return number of miliseconds from timeval structure
  */
@@ -387,6 +436,19 @@ util_tv_to_ms(struct timeval t1)
 	return (u64);
 }
 
+/*
+ * Return number of nanoseconds from timeval structure
+ */
+uint64_t
+util_tv_to_ns(struct timeval t1)
+{
+	uint64_t u64;
+
+	u64 = (uint64_t)t1.tv_usec * 1000 + (uint64_t)t1.tv_sec * 1000000000;
+
+	return (u64);
+}
+
 /*
  * Return absolute difference between two unsigned 64-bit integers
  */
@@ -49,6 +49,7 @@ enum { SESSIONID_LEN = (4 + 12) };
 /*
  * Functions
  */
+extern uint64_t		util_clock_ns(int clock_id);
 extern double		util_fabs(double n);
 extern void		util_gen_cid(char *client_id, const struct ai_item *local_addr);
 extern void		util_gen_sid(char *session_id);
@@ -58,11 +59,14 @@ extern uint64_t		util_time_absdiff(struct timeval t1, struct timeval t2);
 extern double		util_time_double_absdiff(struct timeval t1, struct timeval t2);
 extern double		util_time_double_absdiff_ns(struct timeval t1, struct timeval t2);
 extern double		util_time_double_absdiff_us(struct timeval t1, struct timeval t2);
+extern struct timeval	util_ns_to_tv(uint64_t ns);
 extern double		util_ov_std_dev(double m2, uint64_t n);
 extern void		util_ov_update(double *mean, double *m2, double x, uint64_t n);
 extern double		util_ov_variance(double m2, uint64_t n);
 extern int		util_packet_loss_percent(uint64_t packet_sent, uint64_t packet_received);
+extern int		util_rand_jitter(int value, int jitter_pct);
 extern uint64_t		util_tv_to_ms(struct timeval t1);
+extern uint64_t		util_tv_to_ns(struct timeval t1);
 extern uint64_t		util_u64_absdiff(uint64_t u1, uint64_t u2);
 extern uint32_t		util_u64sqrt(uint64_t n);
 
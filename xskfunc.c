@@ -0,0 +1,960 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE
+ * FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Author: agent <agent@local>
+ */
+
+#include <sys/types.h>
+
+#include <sys/socket.h>
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <errno.h>
+#include <inttypes.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <linux/bpf.h>
+#include <linux/if_ether.h>
+#include <linux/if_link.h>
+#include <linux/if_xdp.h>
+
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <poll.h>
+#include <stddef.h>
+#include <unistd.h>
+#endif
+
+#include "addrfunc.h"
+#include "logging.h"
+#include "pktfunc.h"
+#include "util.h"
+#include "xskfunc.h"
+
+#if defined(__linux__) && defined(AF_XDP) && defined(SOL_XDP) && \
+    defined(XDP_UMEM_PGOFF_FILL_RING) && defined(BPF_F_XDP_HAS_FRAGS) && defined(__NR_bpf)
+#define XSK_SUPPORTED
+#endif
+
+#ifdef XSK_SUPPORTED
+/*
+ * UMEM frames. Every frame holds one packet.
+ */
+#define XSK_FRAME_SIZE		2048
+#define XSK_NO_FRAMES		4096
+
+/*
+ * Size of rings (must be power of 2). Fill ring can hold all frames. Completion ring is not used
+ * (nothing is sent) but it must exist.
+ */
+#define XSK_COMP_RING_SIZE	64
+#define XSK_FILL_RING_SIZE	XSK_NO_FRAMES
+#define XSK_RX_RING_SIZE	2048
+
+/*
+ * Maximum number of descriptors taken from RX ring at once
+ */
+#define XSK_MAX_BATCH		64
+
+/*
+ * Maximum number of instructions of XDP program. Program has fixed part, one instruction per
+ * port and redirect and pass parts.
+ */
+#define XSK_PROG_PORTS_INSN	24
+#define XSK_MAX_PROG_INSNS	(XSK_PROG_PORTS_INSN + RS_MAX_POLL_SOCKS + 9)
+
+/*
+ * Construct one eBPF instruction
+ */
+#define XSK_INSN(c, d, s, o, i)	((struct bpf_insn){ .code = (c), .dst_reg = (d), \
+    .src_reg = (s), .off = (o), .imm = (i) })
+
+/*
+ * Ring shared with kernel. map is mmaped memory with map_len length, producer and consumer are
+ * indexes in map, descs are descriptors and mask is size of ring minus one.
+ */
+struct xsk_ring {
+	char		*map;
+	uint32_t	*consumer;
+	uint32_t	*producer;
+	void		*descs;
+	size_t		map_len;
+	uint32_t	mask;
+};
+
+/*
+ * State of XDP backend. socks is array of no_socks sockets of omping (same as passed to wait),
+ * cursors are indexes of next descriptors of batch to check for every socket and sock_readable is
+ * set if socket itself is readable (packet was not redirected to AF_XDP socket). Batch is
+ * no_batch descriptors of RX ring starting on batch_cons index and received at batch_tstamp.
+ * umem is memory of frames with umem_len length. fd is AF_XDP socket bound to ifindex interface,
+ * map_fd is XSKMAP, prog_fd is XDP program and link_fd is link attaching program to interface.
+ * no_sock_msgs and no_xsk_msgs are numbers of messages received from sockets and from AF_XDP
+ * socket.
+ */
+struct xsk_state {
+	struct pkt_sock socks[RS_MAX_POLL_SOCKS];
+	uint32_t	cursors[RS_MAX_POLL_SOCKS];
+	int		sock_readable[RS_MAX_POLL_SOCKS];
+	struct xsk_ring	comp_ring;
+	struct xsk_ring	fill_ring;
+	struct xsk_ring	rx_ring;
+	struct timeval	batch_tstamp;
+	char		*umem;
+	uint64_t	no_sock_msgs;
+	uint64_t	no_xsk_msgs;
+	size_t		umem_len;
+	uint32_t	batch_cons;
+	uint32_t	no_batch;
+	int		fd;
+	int		ifindex;
+	int		link_fd;
+	int		map_fd;
+	int		no_socks;
+	int		prog_fd;
+};
+
+static struct xsk_state xsk_state = { .fd = -1, .link_fd = -1, .map_fd = -1, .prog_fd = -1 };
+#endif
+
+/*
+ * Function prototypes
+ */
+#ifdef XSK_SUPPORTED
+static int	xsk_batch_acquire(void);
+
+static void	xsk_batch_release(void);
+
+static int	xsk_bpf(int cmd, union bpf_attr *attr);
+#endif
+
+static void	xsk_close(void);
+
+#ifdef XSK_SUPPORTED
+static void	xsk_free(void);
+
+static int	xsk_ifindex(void);
+#endif
+
+static int	xsk_open(const int *socks, int no_socks);
+
+#ifdef XSK_SUPPORTED
+static int	xsk_parse(uint32_t desc_i, struct sockaddr_storage *dst_addr,
+    struct rs_msg *msg);
+
+static int	xsk_prog_load(void);
+#endif
+
+static int	xsk_recv_batch(int sock, struct rs_msg *msgs, int no_msgs);
+
+#ifdef XSK_SUPPORTED
+static int	xsk_ring_mmap(struct xsk_ring *ring, const struct xdp_ring_offset *off,
+    off_t pgoff, uint32_t size, size_t desc_size);
+
+static int	xsk_umem_create(void);
+#endif
+
+static int	xsk_wait(const int *socks, int no_socks, int timeout, int spin,
+    int *sock_events);
+
+/*
+ * XDP backend. XDP program (attached in generic mode) redirects UDP packets for ports of omping
+ * sockets received on queue 0 of interface to AF_XDP socket. Messages are parsed directly in UMEM
+ * frames taken from RX ring in batches. Packets which are not redirected are received by sockets.
+ * Messages are sent by socket backend. Backend needs CAP_NET_ADMIN and CAP_NET_RAW (or
+ * CAP_BPF). If backend can't be opened, socket backend is used.
+ */
+const struct rs_backend xsk_backend = {
+	.name = "xdp",
+	.ts_source = "gettimeofday (per batch)",
+	.close = xsk_close,
+	.open = xsk_open,
+	.recv_batch = xsk_recv_batch,
+	.send_batch = NULL,
+	.wait = xsk_wait,
+	.optional = 1,
+};
+
+#ifdef XSK_SUPPORTED
+/*
+ * Take batch of descriptors from RX ring. Packets of batch are assigned to sockets (cursor and
+ * no_pending of every socket are set).
+ * Function returns 1 if batch was taken, otherwise 0.
+ */
+static int
+xsk_batch_acquire(void)
+{
+	struct sockaddr_storage dst_addr;
+	uint32_t cons;
+	uint32_t i;
+	uint32_t prod;
+	int sock_i;
+
+	cons = *xsk_state.rx_ring.consumer;
+	prod = __atomic_load_n(xsk_state.rx_ring.producer, __ATOMIC_ACQUIRE);
+
+	if (prod == cons) {
+		return (0);
+	}
+
+	xsk_state.batch_cons = cons;
+	xsk_state.no_batch = prod - cons;
+	if (xsk_state.no_batch > XSK_MAX_BATCH) {
+		xsk_state.no_batch = XSK_MAX_BATCH;
+	}
+
+	xsk_state.batch_tstamp = util_get_time();
+
+	for (sock_i = 0; sock_i < xsk_state.no_socks; sock_i++) {
+		xsk_state.cursors[sock_i] = xsk_state.no_batch;
+		xsk_state.socks[sock_i].no_pending = 0;
+	}
+
+	for (i = 0; i < xsk_state.no_batch; i++) {
+		if (xsk_parse(i, &dst_addr, NULL) == 0) {
+			sock_i = pkt_socks_find(xsk_state.socks, xsk_state.no_socks, &dst_addr);
+
+			if (sock_i >= 0) {
+				if (xsk_state.cursors[sock_i] == xsk_state.no_batch) {
+					xsk_state.cursors[sock_i] = i;
+				}
+
+				xsk_state.socks[sock_i].no_pending++;
+			}
+		}
+	}
+
+	return (1);
+}
+
+/*
+ * Return frames of current batch to fill ring and release descriptors of batch in RX ring.
+ */
+static void
+xsk_batch_release(void)
+{
+	const struct xdp_desc *descs;
+	uint64_t *fill_descs;
+	uint32_t fill_prod;
+	uint32_t i;
+
+	descs = xsk_state.rx_ring.descs;
+	fill_descs = xsk_state.fill_ring.descs;
+	fill_prod = *xsk_state.fill_ring.producer;
+
+	for (i = 0; i < xsk_state.no_batch; i++) {
+		fill_descs[(fill_prod + i) & xsk_state.fill_ring.mask] =
+		    descs[(xsk_state.batch_cons + i) & xsk_state.rx_ring.mask].addr &
+		    ~((uint64_t)XSK_FRAME_SIZE - 1);
+	}
+
+	__atomic_store_n(xsk_state.fill_ring.producer, fill_prod + xsk_state.no_batch,
+	    __ATOMIC_RELEASE);
+	__atomic_store_n(xsk_state.rx_ring.consumer, xsk_state.batch_cons + xsk_state.no_batch,
+	    __ATOMIC_RELEASE);
+
+	xsk_state.no_batch = 0;
+}
+
+/*
+ * Wrapper on top of bpf syscall. cmd is command and attr are its attributes.
+ * Function returns result of syscall (-1 on error with errno set).
+ */
+static int
+xsk_bpf(int cmd, union bpf_attr *attr)
+{
+
+	return (syscall(__NR_bpf, cmd, attr, sizeof(*attr)));
+}
+#endif
+
+/*
+ * Close XDP backend. XDP program is detached from interface. Statistics are displayed in verbose
+ * mode.
+ */
+static void
+xsk_close(void)
+{
+#ifdef XSK_SUPPORTED
+	struct xdp_statistics stats;
+	socklen_t stats_len;
+
+	if (xsk_state.fd == -1) {
+		return ;
+	}
+
+	stats_len = sizeof(stats);
+	if (getsockopt(xsk_state.fd, SOL_XDP, XDP_STATISTICS, &stats, &stats_len) == 0) {
+		VERBOSE_PRINTF("XDP backend: %"PRIu64" messages from AF_XDP socket, %"PRIu64
+		    " from sockets, %"PRIu64" dropped by full ring", xsk_state.no_xsk_msgs,
+		    xsk_state.no_sock_msgs, (uint64_t)stats.rx_ring_full);
+	}
+
+	xsk_free();
+#endif
+}
+
+#ifdef XSK_SUPPORTED
+/*
+ * Free all resources of XDP backend (also partly opened one).
+ */
+static void
+xsk_free(void)
+{
+	struct xsk_ring *rings[3];
+	int i;
+
+	if (xsk_state.link_fd != -1) {
+		close(xsk_state.link_fd);
+	}
+
+	if (xsk_state.prog_fd != -1) {
+		close(xsk_state.prog_fd);
+	}
+
+	if (xsk_state.map_fd != -1) {
+		close(xsk_state.map_fd);
+	}
+
+	rings[0] = &xsk_state.comp_ring;
+	rings[1] = &xsk_state.fill_ring;
+	rings[2] = &xsk_state.rx_ring;
+
+	for (i = 0; i < 3; i++) {
+		if (rings[i]->map != NULL) {
+			munmap(rings[i]->map, rings[i]->map_len);
+		}
+	}
+
+	if (xsk_state.fd != -1) {
+		close(xsk_state.fd);
+	}
+
+	if (xsk_state.umem != NULL) {
+		munmap(xsk_state.umem, xsk_state.umem_len);
+	}
+
+	memset(&xsk_state, 0, sizeof(xsk_state));
+	xsk_state.fd = xsk_state.link_fd = xsk_state.map_fd = xsk_state.prog_fd = -1;
+}
+
+/*
+ * Find interface with address of first unicast socket.
+ * Function returns interface index or 0 if no such interface exists (errno is set).
+ */
+static int
+xsk_ifindex(void)
+{
+	struct ifaddrs *ifa;
+	struct ifaddrs *ifa_list;
+	int i;
+	int res;
+
+	res = 0;
+
+	if (getifaddrs(&ifa_list) == -1) {
+		return (0);
+	}
+
+	for (i = 0; i < xsk_state.no_socks && res == 0; i++) {
+		if (xsk_state.socks[i].mcast) {
+			continue;
+		}
+
+		for (ifa = ifa_list; ifa != NULL && res == 0; ifa = ifa->ifa_next) {
+			if (ifa->ifa_addr == NULL || (ifa->ifa_addr->sa_family != AF_INET &&
+			    ifa->ifa_addr->sa_family != AF_INET6)) {
+				continue;
+			}
+
+			if (af_sockaddr_eq(ifa->ifa_addr,
+			    AF_CAST_SA(&xsk_state.socks[i].bound_addr))) {
+				res = if_nametoindex(ifa->ifa_name);
+			}
+		}
+	}
+
+	freeifaddrs(ifa_list);
+
+	if (res == 0) {
+		errno = ENODEV;
+	}
+
+	return (res);
+}
+#endif
+
+/*
+ * Open XDP backend. socks is array of no_socks sockets. AF_XDP socket with UMEM is bound to queue 0
+ * of interface with address of first unicast socket and XDP program is attached to interface in
+ * generic (skb) mode.
+ * Function returns 0 on success, otherwise -1 (errno is set).
+ */
+static int
+xsk_open(const int *socks, int no_socks)
+{
+#ifdef XSK_SUPPORTED
+	struct sockaddr_xdp sxdp;
+	union bpf_attr attr;
+	uint32_t key;
+	int saved_errno;
+
+	xsk_free();
+
+	if (pkt_socks_init(xsk_state.socks, socks, no_socks) == -1) {
+		return (-1);
+	}
+
+	xsk_state.no_socks = no_socks;
+
+	xsk_state.ifindex = xsk_ifindex();
+	if (xsk_state.ifindex == 0) {
+		DEBUG_PRINTF("Can't find interface for AF_XDP socket");
+		return (-1);
+	}
+
+	xsk_state.fd = socket(AF_XDP, SOCK_RAW, 0);
+	if (xsk_state.fd == -1) {
+		DEBUG_PRINTF("Can't create AF_XDP socket");
+		goto error_free;
+	}
+
+	if (xsk_umem_create() == -1) {
+		goto error_free;
+	}
+
+	memset(&sxdp, 0, sizeof(sxdp));
+	sxdp.sxdp_family = AF_XDP;
+	sxdp.sxdp_ifindex = xsk_state.ifindex;
+	sxdp.sxdp_queue_id = 0;
+	sxdp.sxdp_flags = XDP_COPY;
+
+	if (bind(xsk_state.fd, (struct sockaddr *)&sxdp, sizeof(sxdp)) == -1) {
+		DEBUG_PRINTF("Can't bind AF_XDP socket");
+		goto error_free;
+	}
+
+	memset(&attr, 0, sizeof(attr));
+	attr.map_type = BPF_MAP_TYPE_XSKMAP;
+	attr.key_size = sizeof(uint32_t);
+	attr.value_size = sizeof(uint32_t);
+	attr.max_entries = 1;
+
+	xsk_state.map_fd = xsk_bpf(BPF_MAP_CREATE, &attr);
+	if (xsk_state.map_fd == -1) {
+		DEBUG_PRINTF("Can't create XSKMAP");
+		goto error_free;
+	}
+
+	key = 0;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.map_fd = xsk_state.map_fd;
+	attr.key = (uint64_t)(uintptr_t)&key;
+	attr.value = (uint64_t)(uintptr_t)&xsk_state.fd;
+
+	if (xsk_bpf(BPF_MAP_UPDATE_ELEM, &attr) == -1) {
+		DEBUG_PRINTF("Can't insert AF_XDP socket to XSKMAP");
+		goto error_free;
+	}
+
+	xsk_state.prog_fd = xsk_prog_load();
+	if (xsk_state.prog_fd == -1) {
+		DEBUG_PRINTF("Can't load XDP program");
+		goto error_free;
+	}
+
+	memset(&attr, 0, sizeof(attr));
+	attr.link_create.prog_fd = xsk_state.prog_fd;
+	attr.link_create.target_ifindex = xsk_state.ifindex;
+	attr.link_create.attach_type = BPF_XDP;
+	attr.link_create.flags = XDP_FLAGS_SKB_MODE;
+
+	xsk_state.link_fd = xsk_bpf(BPF_LINK_CREATE, &attr);
+	if (xsk_state.link_fd == -1) {
+		DEBUG_PRINTF("Can't attach XDP program to interface");
+		goto error_free;
+	}
+
+	DEBUG_PRINTF("AF_XDP socket bound to queue 0 of interface %d", xsk_state.ifindex);
+
+	return (0);
+
+error_free:
+	saved_errno = errno;
+	xsk_free();
+	errno = saved_errno;
+
+	return (-1);
+#else
+	errno = ENOSYS;
+
+	return (-1);
+#endif
+}
+
+#ifdef XSK_SUPPORTED
+/*
+ * Parse packet of descriptor with desc_i index in current batch. Arguments and return values are
+ * same as for pkt_parse_udp, but msg timestamp is set to time when batch was taken.
+ */
+static int
+xsk_parse(uint32_t desc_i, struct sockaddr_storage *dst_addr, struct rs_msg *msg)
+{
+	const struct xdp_desc *desc;
+	const unsigned char *frame;
+
+	desc = &((const struct xdp_desc *)xsk_state.rx_ring.descs)[(xsk_state.batch_cons +
+	    desc_i) & xsk_state.rx_ring.mask];
+
+	if (desc->len < PKT_ETH_HDR_LEN) {
+		memset(dst_addr, 0, sizeof(*dst_addr));
+
+		return (-1);
+	}
+
+	frame = (const unsigned char *)xsk_state.umem + desc->addr;
+
+	if (pkt_parse_udp(frame + PKT_ETH_HDR_LEN, desc->len - PKT_ETH_HDR_LEN,
+	    xsk_state.ifindex, dst_addr, msg) == -1) {
+		return (-1);
+	}
+
+	if (msg != NULL) {
+		msg->timestamp = xsk_state.batch_tstamp;
+	}
+
+	return (0);
+}
+
+/*
+ * Load XDP program. Program redirects IPv4 (without options and not fragmented) and IPv6
+ * (without extension headers) UDP packets with destination port equal to port of some omping
+ * socket to AF_XDP socket in XSKMAP (if packet was received on queue with AF_XDP socket). Other
+ * packets are passed to network stack.
+ * Function returns file descriptor of program or -1 on error (errno is set).
+ */
+static int
+xsk_prog_load(void)
+{
+	struct bpf_insn insns[XSK_MAX_PROG_INSNS];
+	union bpf_attr attr;
+	uint16_t port;
+	int i;
+	int j;
+	int no_ports;
+	int pass_i;
+	int redirect_i;
+
+	no_ports = 0;
+
+	for (i = 0; i < xsk_state.no_socks; i++) {
+		port = af_sa_port(AF_CAST_SA(&xsk_state.socks[i].bound_addr));
+
+		for (j = 0; j < no_ports; j++) {
+			if (insns[XSK_PROG_PORTS_INSN + j].imm == port) {
+				break;
+			}
+		}
+
+		if (j == no_ports) {
+			insns[XSK_PROG_PORTS_INSN + no_ports++].imm = port;
+		}
+	}
+
+	redirect_i = XSK_PROG_PORTS_INSN + no_ports + 1;
+	pass_i = redirect_i + 6;
+
+	/*
+	 * r6 = ctx, r2 = data, r3 = data_end. Check Ethernet, IPv4 and UDP header length.
+	 */
+	insns[0] = XSK_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_6, BPF_REG_1, 0, 0);
+	insns[1] = XSK_INSN(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, BPF_REG_1,
+	    offsetof(struct xdp_md, data), 0);
+	insns[2] = XSK_INSN(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_3, BPF_REG_1,
+	    offsetof(struct xdp_md, data_end), 0);
+	insns[3] = XSK_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0, 0);
+	insns[4] = XSK_INSN(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0,
+	    PKT_ETH_HDR_LEN + 20 + PKT_UDP_HDR_LEN);
+	insns[5] = XSK_INSN(BPF_JMP | BPF_JGT | BPF_X, BPF_REG_4, BPF_REG_3, pass_i - 6, 0);
+	insns[6] = XSK_INSN(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_5, BPF_REG_2, 12, 0);
+	insns[7] = XSK_INSN(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_5, 0, 17 - 8, htons(ETH_P_IP));
+
+	/*
+	 * IPv4. Load destination port
+	 */
+	insns[8] = XSK_INSN(BPF_LDX | BPF_MEM | BPF_B, BPF_REG_5, BPF_REG_2, PKT_ETH_HDR_LEN, 0);
+	insns[9] = XSK_INSN(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_5, 0, pass_i - 10, 0x45);
+	insns[10] = XSK_INSN(BPF_LDX | BPF_MEM | BPF_B, BPF_REG_5, BPF_REG_2,
+	    PKT_ETH_HDR_LEN + 9, 0);
+	insns[11] = XSK_INSN(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_5, 0, pass_i - 12, IPPROTO_UDP);
+	insns[12] = XSK_INSN(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_5, BPF_REG_2,
+	    PKT_ETH_HDR_LEN + 6, 0);
+	insns[13] = XSK_INSN(BPF_ALU64 | BPF_AND | BPF_K, BPF_REG_5, 0, 0, htons(0x3fff));
+	insns[14] = XSK_INSN(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_5, 0, pass_i - 15, 0);
+	insns[15] = XSK_INSN(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_5, BPF_REG_2,
+	    PKT_ETH_HDR_LEN + 20 + 2, 0);
+	insns[16] = XSK_INSN(BPF_JMP | BPF_JA, 0, 0, XSK_PROG_PORTS_INSN - 17, 0);
+
+	/*
+	 * IPv6. Check header length and load destination port
+	 */
+	insns[17] = XSK_INSN(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_5, 0, pass_i - 18,
+	    htons(ETH_P_IPV6));
+	insns[18] = XSK_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0, 0);
+	insns[19] = XSK_INSN(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0,
+	    PKT_ETH_HDR_LEN + PKT_IPV6_HDR_LEN + PKT_UDP_HDR_LEN);
+	insns[20] = XSK_INSN(BPF_JMP | BPF_JGT | BPF_X, BPF_REG_4, BPF_REG_3, pass_i - 21, 0);
+	insns[21] = XSK_INSN(BPF_LDX | BPF_MEM | BPF_B, BPF_REG_5, BPF_REG_2,
+	    PKT_ETH_HDR_LEN + 6, 0);
+	insns[22] = XSK_INSN(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_5, 0, pass_i - 23, IPPROTO_UDP);
+	insns[23] = XSK_INSN(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_5, BPF_REG_2,
+	    PKT_ETH_HDR_LEN + PKT_IPV6_HDR_LEN + 2, 0);
+
+	/*
+	 * Ports (stored in network byte order, same as loaded from packet)
+	 */
+	for (i = XSK_PROG_PORTS_INSN; i < redirect_i - 1; i++) {
+		insns[i] = XSK_INSN(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_5, 0, redirect_i - (i + 1),
+		    insns[i].imm);
+	}
+
+	insns[redirect_i - 1] = XSK_INSN(BPF_JMP | BPF_JA, 0, 0, pass_i - redirect_i, 0);
+
+	/*
+	 * return bpf_redirect_map(xskmap, ctx->rx_queue_index, XDP_PASS)
+	 */
+	insns[redirect_i] = XSK_INSN(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0,
+	    xsk_state.map_fd);
+	insns[redirect_i + 1] = XSK_INSN(0, 0, 0, 0, 0);
+	insns[redirect_i + 2] = XSK_INSN(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, BPF_REG_6,
+	    offsetof(struct xdp_md, rx_queue_index), 0);
+	insns[redirect_i + 3] = XSK_INSN(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_3, 0, 0, XDP_PASS);
+	insns[redirect_i + 4] = XSK_INSN(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map);
+	insns[redirect_i + 5] = XSK_INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0);
+
+	/*
+	 * return XDP_PASS
+	 */
+	insns[pass_i] = XSK_INSN(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, XDP_PASS);
+	insns[pass_i + 1] = XSK_INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0);
+
+	memset(&attr, 0, sizeof(attr));
+	attr.prog_type = BPF_PROG_TYPE_XDP;
+	attr.insns = (uint64_t)(uintptr_t)insns;
+	attr.insn_cnt = pass_i + 2;
+	attr.license = (uint64_t)(uintptr_t)"ISC";
+
+	return (xsk_bpf(BPF_PROG_LOAD, &attr));
+}
+#endif
+
+/*
+ * Receive batch of messages for socket sock (recv_batch function of XDP backend). Messages from
+ * current batch of RX ring are returned first (data points directly to UMEM frame), then messages
+ * waiting on socket itself. Arguments and return values are same as for rs_receive_msgs.
+ */
+static int
+xsk_recv_batch(int sock, struct rs_msg *msgs, int no_msgs)
+{
+#ifdef XSK_SUPPORTED
+	struct sockaddr_storage dst_addr;
+	struct pkt_sock *psock;
+	uint32_t desc_i;
+	int no_recv;
+	int res;
+	int sock_i;
+
+	for (sock_i = 0; sock_i < xsk_state.no_socks; sock_i++) {
+		if (xsk_state.socks[sock_i].sock == sock) {
+			break;
+		}
+	}
+
+	if (sock_i == xsk_state.no_socks) {
+		return (0);
+	}
+
+	psock = &xsk_state.socks[sock_i];
+	desc_i = xsk_state.cursors[sock_i];
+	no_recv = 0;
+
+	while (psock->no_pending > 0 && no_recv < no_msgs && desc_i < xsk_state.no_batch) {
+		if (xsk_parse(desc_i, &dst_addr, &msgs[no_recv]) == 0 &&
+		    pkt_socks_find(xsk_state.socks, xsk_state.no_socks, &dst_addr) == sock_i) {
+			psock->no_pending--;
+			no_recv++;
+		}
+
+		desc_i++;
+	}
+
+	if (desc_i >= xsk_state.no_batch) {
+		/*
+		 * End of batch. Batch must be released even if some packet was not received.
+		 */
+		psock->no_pending = 0;
+	}
+
+	xsk_state.cursors[sock_i] = desc_i;
+	xsk_state.no_xsk_msgs += no_recv;
+
+	if (no_recv < no_msgs && xsk_state.sock_readable[sock_i]) {
+		xsk_state.sock_readable[sock_i] = 0;
+
+		res = rs_socket_backend.recv_batch(sock, &msgs[no_recv], no_msgs - no_recv);
+		if (res < 0) {
+			return (no_recv > 0 ? no_recv : res);
+		}
+
+		xsk_state.no_sock_msgs += res;
+		no_recv += res;
+	}
+
+	return (no_recv);
+#else
+	return (0);
+#endif
+}
+
+#ifdef XSK_SUPPORTED
+/*
+ * Map ring of AF_XDP socket. off are offsets of ring returned by XDP_MMAP_OFFSETS, pgoff is offset
+ * of ring in socket, size is number of descriptors and desc_size is size of one descriptor.
+ * Function returns 0 on success, otherwise -1 (errno is set).
+ */
+static int
+xsk_ring_mmap(struct xsk_ring *ring, const struct xdp_ring_offset *off, off_t pgoff,
+    uint32_t size, size_t desc_size)
+{
+	char *map;
+
+	ring->map_len = off->desc + size * desc_size;
+
+	map = mmap(NULL, ring->map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	    xsk_state.fd, pgoff);
+	if (map == MAP_FAILED) {
+		return (-1);
+	}
+
+	ring->map = map;
+	ring->producer = (uint32_t *)(map + off->producer);
+	ring->consumer = (uint32_t *)(map + off->consumer);
+	ring->descs = map + off->desc;
+	ring->mask = size - 1;
+
+	return (0);
+}
+
+/*
+ * Create UMEM of AF_XDP socket and its rings, create RX ring and put all frames to fill ring.
+ * Function returns 0 on success, otherwise -1 (errno is set).
+ */
+static int
+xsk_umem_create(void)
+{
+	struct xdp_mmap_offsets off;
+	struct xdp_umem_reg mr;
+	socklen_t off_len;
+	uint64_t *fill_descs;
+	uint32_t i;
+	int size;
+
+	xsk_state.umem_len = (size_t)XSK_FRAME_SIZE * XSK_NO_FRAMES;
+	xsk_state.umem = mmap(NULL, xsk_state.umem_len, PROT_READ | PROT_WRITE,
+	    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (xsk_state.umem == MAP_FAILED) {
+		xsk_state.umem = NULL;
+		DEBUG_PRINTF("Can't allocate UMEM");
+		return (-1);
+	}
+
+	memset(&mr, 0, sizeof(mr));
+	mr.addr = (uint64_t)(uintptr_t)xsk_state.umem;
+	mr.len = xsk_state.umem_len;
+	mr.chunk_size = XSK_FRAME_SIZE;
+
+	if (setsockopt(xsk_state.fd, SOL_XDP, XDP_UMEM_REG, &mr, sizeof(mr)) == -1) {
+		DEBUG_PRINTF("Can't register UMEM");
+		return (-1);
+	}
+
+	size = XSK_FILL_RING_SIZE;
+	if (setsockopt(xsk_state.fd, SOL_XDP, XDP_UMEM_FILL_RING, &size, sizeof(size)) == -1) {
+		return (-1);
+	}
+
+	size = XSK_COMP_RING_SIZE;
+	if (setsockopt(xsk_state.fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &size,
+	    sizeof(size)) == -1) {
+		return (-1);
+	}
+
+	size = XSK_RX_RING_SIZE;
+	if (setsockopt(xsk_state.fd, SOL_XDP, XDP_RX_RING, &size, sizeof(size)) == -1) {
+		return (-1);
+	}
+
+	off_len = sizeof(off);
+	if (getsockopt(xsk_state.fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &off_len) == -1) {
+		return (-1);
+	}
+
+	if (xsk_ring_mmap(&xsk_state.rx_ring, &off.rx, XDP_PGOFF_RX_RING, XSK_RX_RING_SIZE,
+	    sizeof(struct xdp_desc)) == -1 ||
+	    xsk_ring_mmap(&xsk_state.fill_ring, &off.fr, XDP_UMEM_PGOFF_FILL_RING,
+	    XSK_FILL_RING_SIZE, sizeof(uint64_t)) == -1 ||
+	    xsk_ring_mmap(&xsk_state.comp_ring, &off.cr, XDP_UMEM_PGOFF_COMPLETION_RING,
+	    XSK_COMP_RING_SIZE, sizeof(uint64_t)) == -1) {
+		DEBUG_PRINTF("Can't map AF_XDP rings");
+		return (-1);
+	}
+
+	fill_descs = xsk_state.fill_ring.descs;
+
+	for (i = 0; i < XSK_NO_FRAMES; i++) {
+		fill_descs[i] = (uint64_t)i * XSK_FRAME_SIZE;
+	}
+
+	__atomic_store_n(xsk_state.fill_ring.producer, XSK_NO_FRAMES, __ATOMIC_RELEASE);
+
+	return (0);
+}
+#endif
+
+/*
+ * Wait for events (wait function of XDP backend). Arguments and return values are same as for
+ * socket backend. Socket is readable if current batch of RX ring contains packets for it or if
+ * socket itself is readable. Batch is released when all its packets were received. -3 is
+ * returned if batch contains no packet for any socket.
+ */
+static int
+xsk_wait(const int *socks, int no_socks, int timeout, int spin, int *sock_events)
+{
+#ifdef XSK_SUPPORTED
+	struct pollfd pfds[RS_MAX_POLL_SOCKS + 1];
+	struct timeval start_time;
+	int i;
+	int poll_res;
+	int poll_timeout;
+	int res;
+
+	if (xsk_state.no_batch > 0) {
+		for (i = 0; i < xsk_state.no_socks; i++) {
+			if (xsk_state.socks[i].no_pending > 0) {
+				break;
+			}
+		}
+
+		if (i == xsk_state.no_socks) {
+			xsk_batch_release();
+		}
+	}
+
+	if (xsk_state.no_batch == 0) {
+		xsk_batch_acquire();
+	}
+
+	memset(pfds, 0, sizeof(struct pollfd) * (no_socks + 1));
+
+	pfds[0].fd = xsk_state.fd;
+	pfds[0].events = POLLIN;
+
+	for (i = 0; i < no_socks; i++) {
+		pfds[i + 1].fd = socks[i];
+		pfds[i + 1].events = POLLIN;
+	}
+
+	poll_timeout = (xsk_state.no_batch > 0 ? 0 : timeout);
+
+	if (spin) {
+		start_time = util_get_time();
+
+		do {
+			poll_res = poll(pfds, no_socks + 1, 0);
+		} while (poll_res == 0 &&
+		    (int)util_time_absdiff(start_time, util_get_time()) < poll_timeout);
+	} else {
+		poll_res = poll(pfds, no_socks + 1, poll_timeout);
+	}
+
+	if (poll_res == -1) {
+		if (errno == EINTR) {
+			DEBUG2_PRINTF("poll error - EINTR");
+			return (-2);
+		} else {
+			DEBUG2_PRINTF("poll error - errno = %d", errno);
+			return (-1);
+		}
+	}
+
+	if (poll_res == 0 && xsk_state.no_batch == 0) {
+		return (0);
+	}
+
+	if (pfds[0].revents & POLLERR || pfds[0].revents & POLLHUP ||
+	    pfds[0].revents & POLLNVAL) {
+		DEBUG2_PRINTF("poll error. AF_XDP socket revents = %d", pfds[0].revents);
+		return (-1);
+	}
+
+	if (xsk_state.no_batch == 0) {
+		xsk_batch_acquire();
+	}
+
+	res = 0;
+
+	for (i = 0; i < no_socks; i++) {
+		sock_events[i] = 0;
+
+#ifdef MSG_ERRQUEUE
+		if (pfds[i + 1].revents & POLLERR) {
+			pfds[i + 1].revents &= ~POLLERR;
+			sock_events[i] |= RS_EV_ERR;
+		}
+#endif
+
+		if (pfds[i + 1].revents & POLLERR || pfds[i + 1].revents & POLLHUP ||
+		    pfds[i + 1].revents & POLLNVAL) {
+			DEBUG2_PRINTF("poll error. pfds[%d] revents = %d", i + 1,
+			    pfds[i + 1].revents);
+			return (-1);
+		}
+
+		xsk_state.sock_readable[i] = (pfds[i + 1].revents & POLLIN ? 1 : 0);
+
+		if (xsk_state.sock_readable[i] || (xsk_state.no_batch > 0 &&
+		    xsk_state.socks[i].no_pending > 0)) {
+			sock_events[i] |= RS_EV_READ;
+		}
+
+		if (sock_events[i] != 0) {
+			res++;
+		}
+	}
+
+	return (res > 0 ? res : -3);
+#else
+	return (-1);
+#endif
+}